@@ -0,0 +1,67 @@
+// Interface for settings pages loaded by hypr-control at runtime.
+//
+// A module is a shared object next to a metadata sidecar, e.g.
+//
+//   ~/.local/share/hypr-control/pages/kiosk.so
+//   ~/.local/share/hypr-control/pages/kiosk.page
+//
+// The sidecar is a key file read at startup; the shared object is only
+// opened the first time its page is shown:
+//
+//   [Page]
+//   Name=kiosk
+//   Title=Kiosk
+//   Icon=system-lock-screen-symbolic
+//   Module=kiosk.so
+//   Options=input:touchpad:enabled;cursor:inactive_timeout
+//
+// The module exports HYPR_CONTROL_PAGE_SYMBOL, returning a HyprControlPage
+// whose abi field is HYPR_CONTROL_PAGE_ABI.
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HYPR_CONTROL_PAGE_ABI 1
+#define HYPR_CONTROL_PAGE_SYMBOL "hypr_control_page"
+
+enum HyprControlBindingKind {
+  HYPR_CONTROL_BIND_SWITCH,
+  HYPR_CONTROL_BIND_RANGE,
+  HYPR_CONTROL_BIND_COMBO,
+};
+
+// Services the app provides to a page while it is being built and used.
+typedef struct {
+  unsigned abi;
+  // Applies "key value" like the built-in pages do, honouring staged mode.
+  void (*apply)(const char *command);
+  // Returns the current value of an option; free it with g_free().
+  char *(*get_option)(const char *key);
+  // Registers a control so config edits, staging and discard update it.
+  // `values` lists the option value for each combo item, NULL-terminated;
+  // switches may pass {"false", "true"} or NULL for boolean options.
+  void (*bind)(const char *key, enum HyprControlBindingKind kind,
+               GtkWidget *control, const char *const *values);
+} HyprControlHost;
+
+typedef struct {
+  unsigned abi;
+  const char *name;
+  const char *title;
+  const char *icon_name;
+  // Option keys the page changes, NULL-terminated; used for search.
+  const char *const *options;
+  // Returns the page widget, usually an AdwPreferencesPage.
+  GtkWidget *(*build)(const HyprControlHost *host);
+} HyprControlPage;
+
+typedef const HyprControlPage *(*HyprControlPageEntry)(void);
+
+#ifdef __cplusplus
+}
+#endif
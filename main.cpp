@@ -1,72 +1,409 @@
+#include "hypr-control-page.h"
 #include <adwaita.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <xkbcommon/xkbcommon.h>
 #include <algorithm>
 #include <array>
+#include <cctype>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iomanip>
+#include <iterator>
+#include <list>
+#include <locale>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
-static std::string exec_output(const std::string &cmd) {
-  std::array<char, 128> buffer;
-  std::string result;
-  std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"),
-                                                pclose);
-  if (!pipe)
-    return "";
-  while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-    result += buffer.data();
+#ifndef HYPR_CONTROL_PAGE_DIR
+#define HYPR_CONTROL_PAGE_DIR "/usr/local/lib/hypr-control/pages"
+#endif
+
+#ifdef HYPR_CONTROL_INSTRUMENT
+// Builds configured with -DHYPR_CONTROL_INSTRUMENT=ON count what each
+// handler and page build costs. Counters are per thread, so a scope only
+// sees work done on its own thread: a request queued for a worker counts as
+// IPC, but its socket syscalls land on the worker.
+enum InstrumentCounter {
+  COUNT_ALLOCS,
+  COUNT_ALLOC_BYTES,
+  COUNT_SPAWNS,
+  COUNT_IPC,
+  COUNT_SYSCALLS,
+  COUNT_KINDS
+};
+
+static const char *const instrument_counter_names[COUNT_KINDS] = {
+    "allocs", "alloc_bytes", "spawns", "ipc", "syscalls"};
+
+static thread_local uint64_t instrument_counts[COUNT_KINDS];
+static thread_local int instrument_paused;
+
+void *operator new(std::size_t size) {
+  if (!instrument_paused) {
+    ++instrument_counts[COUNT_ALLOCS];
+    instrument_counts[COUNT_ALLOC_BYTES] += size;
+  }
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+struct InstrumentStats {
+  const char *name;
+  uint64_t calls;
+  std::array<uint64_t, COUNT_KINDS> last;
+  std::array<uint64_t, COUNT_KINDS> max;
+  std::array<uint64_t, COUNT_KINDS> total;
+};
+
+// Scopes are only opened on the main thread.
+static std::vector<InstrumentStats> instrument_stats;
+
+struct InstrumentScope {
+  explicit InstrumentScope(const char *name) : name(name) {
+    std::copy(std::begin(instrument_counts), std::end(instrument_counts),
+              start.begin());
+  }
+
+  ~InstrumentScope() {
+    std::array<uint64_t, COUNT_KINDS> delta;
+    for (int i = 0; i < COUNT_KINDS; ++i)
+      delta[i] = instrument_counts[i] - start[i];
+
+    ++instrument_paused;
+    auto it = std::find_if(
+        instrument_stats.begin(), instrument_stats.end(),
+        [this](const InstrumentStats &s) { return !strcmp(s.name, name); });
+    if (it == instrument_stats.end())
+      it = instrument_stats.insert(it, {name, 0, {}, {}, {}});
+    ++it->calls;
+    for (int i = 0; i < COUNT_KINDS; ++i) {
+      it->last[i] = delta[i];
+      it->max[i] = std::max(it->max[i], delta[i]);
+      it->total[i] += delta[i];
+    }
+    --instrument_paused;
+  }
+
+  const char *name;
+  std::array<uint64_t, COUNT_KINDS> start;
+};
+
+#define INSTRUMENT_SCOPE(name) InstrumentScope instrument_scope_(name)
+#define INSTRUMENT_COUNT(kind, n) (instrument_counts[kind] += (n))
+#else
+#define INSTRUMENT_SCOPE(name)
+#define INSTRUMENT_COUNT(kind, n)
+#endif
+
+struct WorkerPool {
+  explicit WorkerPool(unsigned threads) {
+    for (unsigned i = 0; i < threads; ++i)
+      workers.emplace_back([this] { run(); });
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(std::move(task));
+    }
+    cv.notify_one();
   }
-  while (!result.empty() && (result.back() == '\n' || result.back() == '\r')) {
-    result.pop_back();
+
+private:
+  void run() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty())
+          return;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
   }
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping = false;
+};
+
+static WorkerPool &worker_pool() {
+  static WorkerPool pool(4);
+  return pool;
+}
+
+static gboolean run_main_task(gpointer data) {
+  auto *task = static_cast<std::function<void()> *>(data);
+  (*task)();
+  delete task;
+  return G_SOURCE_REMOVE;
+}
+
+static void run_on_main(std::function<void()> task) {
+  g_idle_add(run_main_task, new std::function<void()>(std::move(task)));
+}
+
+static std::string hypr_socket_request(const std::string &request);
+
+// Requests started by prefetch_request() before the page builders run. Only
+// touched from the main thread; workers just fulfil the promise.
+static std::unordered_map<std::string, std::shared_future<std::string>>
+    prefetched_replies;
+
+static void prefetch_request(const std::string &request) {
+  if (prefetched_replies.count(request))
+    return;
+  auto promise = std::make_shared<std::promise<std::string>>();
+  prefetched_replies[request] = promise->get_future().share();
+  worker_pool().submit([request, promise] {
+    promise->set_value(hypr_socket_request(request));
+  });
+}
+
+static std::string request_output(const std::string &request) {
+  auto it = prefetched_replies.find(request);
+  if (it == prefetched_replies.end())
+    return hypr_socket_request(request);
+  std::string result = it->second.get();
+  prefetched_replies.erase(it);
   return result;
 }
 
-static std::string get_hyprland_option(const std::string &option) {
-  std::string cmd = "hyprctl getoption " + option;
-  std::string output = exec_output(cmd);
-  if (output.empty())
-    return "";
+enum OptionValueType {
+  OPTION_UNKNOWN,
+  OPTION_INT,
+  OPTION_FLOAT,
+  OPTION_STRING,
+  OPTION_VEC2
+};
 
-  
-  std::stringstream ss(output);
-  std::string line;
-  if (!std::getline(ss, line))
-    return "";
+// Numeric types keep their text form in s as well, for string readers.
+struct OptionValue {
+  OptionValueType type = OPTION_UNKNOWN;
+  int64_t i = 0;
+  double f = 0;
+  std::array<double, 2> vec = {};
+  std::string s;
+};
+
+// An entry is fresh while its generation matches option_cache_generation,
+// so bumping the counter invalidates every entry at once. While our own
+// writes are in flight, value holds the optimistic value and confirmed the
+// last one the compositor accepted.
+struct OptionCacheEntry {
+  std::string key;
+  uint32_t generation = 0;
+  uint32_t pending_writes = 0;
+  OptionValue value;
+  OptionValue confirmed;
+};
 
-  size_t colon_pos = line.find(':');
-  if (colon_pos != std::string::npos && colon_pos + 2 < line.length()) {
-    return line.substr(colon_pos + 2);
+static std::vector<OptionCacheEntry> option_cache;
+static std::unordered_map<std::string, uint32_t> option_ids;
+static uint32_t option_cache_generation = 1;
+
+static uint32_t option_id(const std::string &key) {
+  auto it = option_ids.find(key);
+  if (it != option_ids.end())
+    return it->second;
+  uint32_t id = option_cache.size();
+  option_cache.emplace_back();
+  option_cache.back().key = key;
+  option_ids.emplace(key, id);
+  return id;
+}
+
+static OptionValue parse_option_value(OptionValueType type,
+                                      const std::string &text) {
+  OptionValue value;
+  value.s = text;
+  const char *begin = text.c_str();
+  char *end = nullptr;
+
+  if (type == OPTION_UNKNOWN) {
+    std::strtoll(begin, &end, 10);
+    if (!text.empty() && *end == '\0') {
+      type = OPTION_INT;
+    } else {
+      std::strtod(begin, &end);
+      type = !text.empty() && *end == '\0' ? OPTION_FLOAT : OPTION_STRING;
+    }
   }
-  return "";
+
+  value.type = type;
+  switch (type) {
+  case OPTION_INT:
+    value.i = text == "true"    ? 1
+              : text == "false" ? 0
+                                : std::strtoll(begin, nullptr, 10);
+    value.f = value.i;
+    break;
+  case OPTION_FLOAT:
+    value.f = std::strtod(begin, nullptr);
+    value.i = std::llround(value.f);
+    break;
+  case OPTION_VEC2:
+    if (std::sscanf(begin, "[%lf, %lf]", &value.vec[0], &value.vec[1]) != 2)
+      std::sscanf(begin, "%lf %lf", &value.vec[0], &value.vec[1]);
+    break;
+  default:
+    break;
+  }
+  return value;
 }
 
-static double get_float_option(const std::string &option, double def_val) {
-  std::string s = get_hyprland_option(option);
-  if (s.empty())
-    return def_val;
-  try {
-    return std::stod(s);
-  } catch (...) {
-    return def_val;
+// Compares option values as text, treating numbers that differ only in
+// formatting ("0.5" and "0.500000", "true" and "1") as equal.
+static bool option_text_equal(const std::string &a, const std::string &b) {
+  if (a == b)
+    return true;
+  OptionValue x = parse_option_value(OPTION_UNKNOWN, a);
+  OptionValue y = parse_option_value(OPTION_UNKNOWN, b);
+  auto numeric = [](const OptionValue &v) {
+    return v.type == OPTION_INT || v.type == OPTION_FLOAT ||
+           v.s == "true" || v.s == "false";
+  };
+  auto number = [](const OptionValue &v) {
+    return v.s == "true" ? 1.0 : v.s == "false" ? 0.0 : v.f;
+  };
+  return numeric(x) && numeric(y) && std::abs(number(x) - number(y)) < 1e-6;
+}
+
+static OptionValue fetch_option_value(const std::string &key) {
+  std::string output = request_output("getoption " + key);
+  std::string line = output.substr(0, output.find('\n'));
+  size_t colon = line.find(": ");
+  if (colon == std::string::npos)
+    return OptionValue();
+
+  std::string type_name = line.substr(0, colon);
+  OptionValueType type = type_name == "int"     ? OPTION_INT
+                         : type_name == "float" ? OPTION_FLOAT
+                         : type_name == "vec2"  ? OPTION_VEC2
+                                                : OPTION_STRING;
+  return parse_option_value(type, line.substr(colon + 2));
+}
+
+static const OptionValue &option_value(uint32_t id) {
+  OptionCacheEntry &entry = option_cache[id];
+  if (entry.generation != option_cache_generation &&
+      entry.pending_writes == 0) {
+    entry.value = entry.confirmed = fetch_option_value(entry.key);
+    entry.generation = option_cache_generation;
   }
+  return entry.value;
 }
 
-static int get_int_option(const std::string &option, int def_val) {
-  std::string s = get_hyprland_option(option);
-  if (s.empty())
-    return def_val;
-  try {
-    return std::stoi(s);
-  } catch (...) {
-    return def_val;
+static const OptionValue &option_value(const std::string &key) {
+  return option_value(option_id(key));
+}
+
+static void option_cache_fill(const std::string &key, OptionValueType type,
+                              const std::string &text) {
+  OptionCacheEntry &entry = option_cache[option_id(key)];
+  if (entry.pending_writes > 0)
+    return;
+  entry.value = entry.confirmed = parse_option_value(type, text);
+  entry.generation = option_cache_generation;
+}
+
+static uint32_t option_cache_begin_write(const std::string &key,
+                                         const std::string &text) {
+  uint32_t id = option_id(key);
+  OptionCacheEntry &entry = option_cache[id];
+  // Hyprland stores booleans as ints; don't let a first write of "true"
+  // make the entry a string.
+  OptionValueType type = entry.value.type;
+  if (type == OPTION_UNKNOWN && (text == "true" || text == "false"))
+    type = OPTION_INT;
+  entry.value = parse_option_value(type, text);
+  entry.generation = option_cache_generation;
+  ++entry.pending_writes;
+  return id;
+}
+
+static void option_cache_end_write(uint32_t id, const OptionValue &written,
+                                   bool ok) {
+  OptionCacheEntry &entry = option_cache[id];
+  --entry.pending_writes;
+  if (ok) {
+    entry.confirmed = written;
+  } else if (entry.pending_writes == 0) {
+    entry.value = entry.confirmed;
+    if (entry.confirmed.type == OPTION_UNKNOWN)
+      entry.generation = 0;
   }
 }
 
+static void on_option_cache_event(const std::string &event,
+                                  const std::string &) {
+  if (event == "configreloaded")
+    ++option_cache_generation;
+}
+
+static std::string get_hyprland_option(const std::string &option) {
+  return option_value(option).s;
+}
+
+static double get_float_option(const std::string &option, double def_val) {
+  const OptionValue &value = option_value(option);
+  if (value.type == OPTION_INT || value.type == OPTION_FLOAT)
+    return value.f;
+  return def_val;
+}
+
+static int get_int_option(const std::string &option, int def_val) {
+  const OptionValue &value = option_value(option);
+  if (value.type == OPTION_INT || value.type == OPTION_FLOAT)
+    return value.i;
+  return def_val;
+}
+
 static bool get_bool_option(const std::string &option, bool def_val) {
   return get_int_option(option, def_val) != 0;
 }
@@ -75,6 +412,291 @@ static std::string get_string_option(const std::string &option) {
   return get_hyprland_option(option);
 }
 
+// Keeps only the blocks of `binds` output that switch the keyboard layout.
+static std::string switch_layout_binds(const std::string &binds) {
+  std::string result;
+  size_t start = 0;
+  while (start < binds.size()) {
+    size_t end = binds.find("\n\n", start);
+    if (end == std::string::npos)
+      end = binds.size();
+    std::string block = binds.substr(start, end - start);
+    if (block.find("arg: hyprctl switchxkblayout") != std::string::npos)
+      result += block + "\n";
+    start = end + 2;
+  }
+  return result;
+}
+
+static const char *startup_options[] = {
+    "input:sensitivity",
+    "input:accel_profile",
+    "input:force_no_accel",
+    "input:left_handed",
+    "input:natural_scroll",
+    "input:scroll_method",
+    "input:scroll_factor",
+    "input:follow_mouse",
+    "input:float_switch_override_focus",
+    "input:special_fallthrough",
+    "cursor:inactive_timeout",
+    "cursor:zoom_factor",
+    "cursor:hide_on_key_press",
+    "cursor:hide_on_touch",
+    "input:touchpad:enabled",
+    "input:touchdevice:enabled",
+    "input:touchpad:tap-to-click",
+    "input:touchpad:tap-and-drag",
+    "input:touchpad:drag_lock",
+    "input:touchpad:clickfinger_behavior",
+    "input:touchpad:middle_button_emulation",
+    "input:touchpad:natural_scroll",
+    "input:touchpad:scroll_factor",
+    "input:touchpad:disable_while_typing",
+    "gestures:workspace_swipe",
+    "gestures:workspace_swipe_fingers",
+    "gestures:workspace_swipe_distance",
+    "gestures:workspace_swipe_invert",
+    "gestures:workspace_swipe_forever",
+    "input:kb_layout",
+    "input:kb_variant",
+    "input:kb_options",
+    "input:repeat_rate",
+    "input:repeat_delay",
+    nullptr};
+
+static void prefetch_startup_options() {
+  for (int i = 0; startup_options[i] != nullptr; ++i)
+    prefetch_request(std::string("getoption ") + startup_options[i]);
+  prefetch_request("binds");
+}
+
+static std::vector<std::string> split_json_objects(const std::string &text) {
+  std::vector<std::string> objects;
+  int depth = 0;
+  bool in_string = false;
+  bool escaped = false;
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    char c = text[i];
+    if (in_string) {
+      if (escaped)
+        escaped = false;
+      else if (c == '\\')
+        escaped = true;
+      else if (c == '"')
+        in_string = false;
+      continue;
+    }
+    if (c == '"') {
+      in_string = true;
+    } else if (c == '{') {
+      if (depth++ == 0)
+        start = i;
+    } else if (c == '}' && depth > 0) {
+      if (--depth == 0)
+        objects.push_back(text.substr(start, i - start + 1));
+    }
+  }
+  return objects;
+}
+
+static std::string stringify_json_node(JsonNode *node) {
+  if (!node || JSON_NODE_HOLDS_NULL(node))
+    return "";
+  if (JSON_NODE_HOLDS_ARRAY(node)) {
+    JsonArray *array = json_node_get_array(node);
+    std::string result;
+    for (guint i = 0; i < json_array_get_length(array); ++i) {
+      if (i > 0)
+        result += ", ";
+      result += stringify_json_node(json_array_get_element(array, i));
+    }
+    return result;
+  }
+  if (!JSON_NODE_HOLDS_VALUE(node))
+    return "";
+
+  GType type = json_node_get_value_type(node);
+  if (type == G_TYPE_BOOLEAN)
+    return json_node_get_boolean(node) ? "true" : "false";
+  if (type == G_TYPE_INT64)
+    return std::to_string(json_node_get_int(node));
+  if (type == G_TYPE_DOUBLE) {
+    std::ostringstream oss;
+    oss << json_node_get_double(node);
+    return oss.str();
+  }
+  const char *str = json_node_get_string(node);
+  return str ? str : "";
+}
+
+static std::string hypr_socket_dir() {
+  const char *runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+  const char *signature = std::getenv("HYPRLAND_INSTANCE_SIGNATURE");
+  if (!runtime_dir || !signature)
+    return "";
+  return std::string(runtime_dir) + "/hypr/" + signature;
+}
+
+static int hypr_socket_connect(const std::string &path) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    return -1;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  INSTRUMENT_COUNT(COUNT_SYSCALLS, 2);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// With HYPR_CONTROL_RECORD=<file> set, every IPC request and event is
+// appended to <file> for --replay. Records are written with a single
+// O_APPEND write, so the app and the daemon can share one file.
+static int ipc_record_fd() {
+  static int fd = [] {
+    const char *path = std::getenv("HYPR_CONTROL_RECORD");
+    if (!path || !*path)
+      return -1;
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd >= 0 && lseek(fd, 0, SEEK_END) == 0 &&
+        write(fd, "HCREC1\n", 7) < 0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }();
+  return fd;
+}
+
+// Events reach the app and the daemon alike, so only the process holding
+// the lock on the recording writes them. Another process takes over once
+// the holder exits and its lock is released.
+static bool ipc_record_owns_events() {
+  static bool owner = false;
+  int fd = ipc_record_fd();
+  if (!owner && fd >= 0)
+    owner = flock(fd, LOCK_EX | LOCK_NB) == 0;
+  return owner;
+}
+
+static void record_ipc(char kind, gint64 start, gint64 duration,
+                       const std::string &request,
+                       const std::string &response) {
+  int fd = ipc_record_fd();
+  if (fd < 0)
+    return;
+  std::string record = std::string(1, kind) + " " + std::to_string(start) +
+                       " " + std::to_string(duration) + " " +
+                       std::to_string(request.size()) + " " +
+                       std::to_string(response.size()) + "\n" + request +
+                       response;
+  if (write(fd, record.data(), record.size()) < 0)
+    g_printerr("hypr-control: failed to write IPC record\n");
+}
+
+static std::string hypr_socket_request_at(const std::string &dir,
+                                          const std::string &request) {
+  gint64 start = g_get_real_time();
+  int fd = hypr_socket_connect(dir + "/.socket.sock");
+  if (fd < 0)
+    return "";
+
+  size_t written = 0;
+  while (written < request.size()) {
+    INSTRUMENT_COUNT(COUNT_SYSCALLS, 1);
+    ssize_t n = write(fd, request.data() + written, request.size() - written);
+    if (n <= 0) {
+      close(fd);
+      return "";
+    }
+    written += n;
+  }
+  INSTRUMENT_COUNT(COUNT_SYSCALLS, 1);
+  shutdown(fd, SHUT_WR);
+
+  std::string reply;
+  std::array<char, 4096> buffer;
+  ssize_t n;
+  while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+    INSTRUMENT_COUNT(COUNT_SYSCALLS, 1);
+    reply.append(buffer.data(), n);
+  }
+  // The final read and the close.
+  INSTRUMENT_COUNT(COUNT_SYSCALLS, 2);
+  close(fd);
+  record_ipc('Q', start, g_get_real_time() - start, request, reply);
+  return reply;
+}
+
+static std::string hypr_socket_request(const std::string &request) {
+  return hypr_socket_request_at(hypr_socket_dir(), request);
+}
+
+using HyprEventHandler =
+    std::function<void(const std::string &event, const std::string &data)>;
+
+static std::vector<HyprEventHandler> hypr_event_handlers;
+static std::string hypr_event_buffer;
+static int hypr_event_fd = -1;
+
+static void start_hypr_event_listener();
+
+static gboolean reconnect_hypr_event_listener(gpointer) {
+  start_hypr_event_listener();
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean on_hypr_event_readable(gint fd, GIOCondition, gpointer) {
+  std::array<char, 4096> buffer;
+  ssize_t n = read(fd, buffer.data(), buffer.size());
+  if (n <= 0) {
+    close(fd);
+    hypr_event_fd = -1;
+    hypr_event_buffer.clear();
+    g_timeout_add_seconds(1, reconnect_hypr_event_listener, nullptr);
+    return G_SOURCE_REMOVE;
+  }
+  hypr_event_buffer.append(buffer.data(), n);
+
+  size_t start = 0;
+  size_t newline;
+  while ((newline = hypr_event_buffer.find('\n', start)) != std::string::npos) {
+    size_t separator = hypr_event_buffer.find(">>", start);
+    if (separator != std::string::npos && separator < newline) {
+      std::string event = hypr_event_buffer.substr(start, separator - start);
+      std::string data =
+          hypr_event_buffer.substr(separator + 2, newline - separator - 2);
+      if (ipc_record_owns_events())
+        record_ipc('E', g_get_real_time(), 0,
+                   hypr_event_buffer.substr(start, newline - start + 1), "");
+      for (const auto &handler : hypr_event_handlers)
+        handler(event, data);
+    }
+    start = newline + 1;
+  }
+  hypr_event_buffer.erase(0, start);
+  return G_SOURCE_CONTINUE;
+}
+
+static void start_hypr_event_listener() {
+  if (hypr_event_fd >= 0)
+    return;
+  hypr_event_fd = hypr_socket_connect(hypr_socket_dir() + "/.socket2.sock");
+  if (hypr_event_fd < 0) {
+    g_timeout_add_seconds(1, reconnect_hypr_event_listener, nullptr);
+    return;
+  }
+  g_unix_fd_add(hypr_event_fd, G_IO_IN, on_hypr_event_readable, nullptr);
+}
+
 struct LayoutInfo {
   const char *code;
   const char *name;
@@ -171,32 +793,340 @@ static GtkWidget *layout_switch_key_entry = nullptr;
 static GtkWidget *keybinds_list_box = nullptr;
 static int selected_modifier_index = 0;
 static std::string current_layout_switch_bind = "";
+static std::unordered_map<std::string, std::string> layout_variants;
+static std::vector<std::string> xkb_options;
+static std::vector<std::pair<std::string, std::string>> xkb_toggle_options;
+static GtkWidget *layout_toggle_row = nullptr;
+static std::vector<GtkWidget *> layout_keybind_rows;
+
+struct HyprInstance {
+  std::string signature;
+  std::string dir;
+  bool live = false;
+  bool failed = false;
+  std::unique_ptr<WorkerPool> executor;
+  GtkWidget *status_icon = nullptr;
+};
+
+static std::vector<std::unique_ptr<HyprInstance>> hypr_instances;
+static std::string target_instance; // empty means this session
+static bool target_all_instances = false;
+static GtkWidget *toast_overlay = nullptr;
+static GtkWidget *instance_button = nullptr;
+static AdwToast *apply_failure_toast = nullptr;
+
+static void refresh_hypr_instances() {
+  for (auto &instance : hypr_instances)
+    instance->live = false;
+
+  const char *runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+  if (!runtime_dir)
+    return;
+  std::string base = std::string(runtime_dir) + "/hypr";
+  GDir *dir = g_dir_open(base.c_str(), 0, nullptr);
+  if (!dir)
+    return;
+  while (const char *entry = g_dir_read_name(dir)) {
+    std::string path = base + "/" + entry;
+    int fd = hypr_socket_connect(path + "/.socket.sock");
+    if (fd < 0)
+      continue;
+    close(fd);
+
+    auto it = std::find_if(hypr_instances.begin(), hypr_instances.end(),
+                           [&](const std::unique_ptr<HyprInstance> &i) {
+                             return i->signature == entry;
+                           });
+    if (it == hypr_instances.end()) {
+      hypr_instances.push_back(std::make_unique<HyprInstance>());
+      hypr_instances.back()->signature = entry;
+      hypr_instances.back()->dir = path;
+      it = hypr_instances.end() - 1;
+    }
+    (*it)->live = true;
+  }
+  g_dir_close(dir);
+}
+
+static std::vector<HyprInstance *> target_hypr_instances() {
+  if (hypr_instances.empty())
+    refresh_hypr_instances();
+
+  const char *own = std::getenv("HYPRLAND_INSTANCE_SIGNATURE");
+  std::string wanted = target_instance.empty() && own ? own : target_instance;
+  std::vector<HyprInstance *> targets;
+  for (auto &instance : hypr_instances) {
+    if (!instance->live)
+      continue;
+    if (target_all_instances || instance->signature == wanted)
+      targets.push_back(instance.get());
+  }
+  // Like hyprctl, fall back to the first instance found.
+  if (targets.empty()) {
+    for (auto &instance : hypr_instances) {
+      if (instance->live) {
+        targets.push_back(instance.get());
+        break;
+      }
+    }
+  }
+  return targets;
+}
+
+static bool hypr_reply_ok(const std::string &reply) {
+  if (reply.empty())
+    return false;
+  size_t start = 0;
+  while (start < reply.size()) {
+    size_t end = reply.find("\n\n", start);
+    if (end == std::string::npos)
+      end = reply.size();
+    std::string chunk = reply.substr(start, end - start);
+    if (!chunk.empty() && chunk != "ok")
+      return false;
+    start = end + 2;
+  }
+  return true;
+}
+
+static void on_apply_failure_toast_dismissed(AdwToast *, gpointer) {
+  apply_failure_toast = nullptr;
+}
+
+static void report_instance_result(const std::string &signature,
+                                   const std::string &reply, bool ok) {
+  for (auto &instance : hypr_instances) {
+    if (instance->signature != signature)
+      continue;
+    instance->failed = !ok;
+    if (instance->status_icon)
+      gtk_image_set_from_icon_name(GTK_IMAGE(instance->status_icon),
+                                   ok ? "emblem-ok-symbolic"
+                                      : "dialog-warning-symbolic");
+  }
+  if (ok || !toast_overlay)
+    return;
+
+  std::string detail = reply.substr(0, reply.find('\n'));
+  std::string message =
+      signature.empty() ? detail
+                        : "Could not apply to " + signature.substr(0, 8) +
+                              (detail.empty() ? ": no reply" : ": " + detail);
+  if (apply_failure_toast)
+    adw_toast_dismiss(apply_failure_toast);
+  apply_failure_toast = adw_toast_new(message.c_str());
+  g_signal_connect(apply_failure_toast, "dismissed",
+                   G_CALLBACK(on_apply_failure_toast_dismissed), nullptr);
+  adw_toast_overlay_add_toast(ADW_TOAST_OVERLAY(toast_overlay),
+                              apply_failure_toast);
+}
+
+// How requests reach Hyprland. Only --bench leaves the worker queue, to
+// measure the blocking paths against it.
+enum HyprApplyMode { APPLY_ASYNC, APPLY_SYNC, APPLY_SPAWN };
+static HyprApplyMode hypr_apply_mode = APPLY_ASYNC;
+
+static std::string spawn_hyprctl(const std::string &signature,
+                                 const std::string &request) {
+  std::string commands = request.rfind("[[BATCH]]", 0) == 0
+                             ? request.substr(9)
+                             : request;
+  const char *argv[] = {"hyprctl", "--batch", commands.c_str(), nullptr};
+  g_auto(GStrv) env = g_environ_setenv(
+      g_get_environ(), "HYPRLAND_INSTANCE_SIGNATURE", signature.c_str(), TRUE);
+  g_autofree char *output = nullptr;
+  INSTRUMENT_COUNT(COUNT_SPAWNS, 1);
+  if (!g_spawn_sync(nullptr, const_cast<char **>(argv), env,
+                    G_SPAWN_SEARCH_PATH | G_SPAWN_STDERR_TO_DEV_NULL, nullptr,
+                    nullptr, &output, nullptr, nullptr, nullptr))
+    return "";
+  std::string reply = output ? output : "";
+  reply.erase(reply.find_last_not_of(" \n") + 1);
+  return reply;
+}
+
+// Each instance has its own serial executor, so writes to one instance keep
+// their order while different instances are written concurrently.
+static void dispatch_hyprctl(const std::string &request,
+                             std::function<void(bool ok)> done = nullptr) {
+  std::vector<HyprInstance *> targets = target_hypr_instances();
+  if (targets.empty()) {
+    report_instance_result("", "No running Hyprland instance found", false);
+    if (done)
+      done(false);
+    return;
+  }
+  INSTRUMENT_COUNT(COUNT_IPC, targets.size());
+
+  if (hypr_apply_mode != APPLY_ASYNC) {
+    bool ok = true;
+    for (HyprInstance *instance : targets) {
+      std::string reply =
+          hypr_apply_mode == APPLY_SYNC
+              ? hypr_socket_request_at(instance->dir, request)
+              : spawn_hyprctl(instance->signature, request);
+      bool instance_ok = hypr_reply_ok(reply);
+      report_instance_result(instance->signature, reply, instance_ok);
+      ok = ok && instance_ok;
+    }
+    if (done)
+      done(ok);
+    return;
+  }
+
+  struct Pending {
+    size_t remaining;
+    bool ok = true;
+    std::function<void(bool)> done;
+  };
+  auto pending = std::make_shared<Pending>();
+  pending->remaining = targets.size();
+  pending->done = std::move(done);
+
+  for (HyprInstance *instance : targets) {
+    if (!instance->executor)
+      instance->executor = std::make_unique<WorkerPool>(1);
+    instance->executor->submit([dir = instance->dir,
+                                signature = instance->signature, request,
+                                pending] {
+      std::string reply = hypr_socket_request_at(dir, request);
+      bool ok = hypr_reply_ok(reply);
+      run_on_main([signature, reply, ok, pending] {
+        report_instance_result(signature, reply, ok);
+        pending->ok = pending->ok && ok;
+        if (--pending->remaining == 0 && pending->done)
+          pending->done(pending->ok);
+      });
+    });
+  }
+}
+
+static void input_state_option_written(const std::string &key,
+                                       const std::string &value);
+static void all_options_value_written(const std::string &key,
+                                      const std::string &value);
+
+// Updates the option cache optimistically for each "keyword key value"
+// command and returns a callback that confirms or rolls the writes back.
+static std::function<void(bool)>
+track_option_writes(const std::vector<std::string> &commands) {
+  std::vector<std::pair<uint32_t, OptionValue>> writes;
+  for (const auto &command : commands) {
+    if (command.rfind("keyword ", 0) != 0)
+      continue;
+    size_t space = command.find(' ', 8);
+    if (space == std::string::npos)
+      continue;
+    // Options are namespaced ("input:sensitivity"); keywords such as bind,
+    // unbind, env and monitor are not options and have nothing to cache.
+    // Per-device blocks can't be read back with getoption either.
+    std::string key = command.substr(8, space - 8);
+    if (key.find(':') == std::string::npos || key.rfind("device", 0) == 0)
+      continue;
+    uint32_t id = option_cache_begin_write(key, command.substr(space + 1));
+    writes.emplace_back(id, option_cache[id].value);
+  }
+  if (writes.empty())
+    return nullptr;
+  return [writes](bool ok) {
+    for (const auto &write : writes) {
+      option_cache_end_write(write.first, write.second, ok);
+      if (!ok)
+        continue;
+      input_state_option_written(option_cache[write.first].key,
+                                 option_cache[write.first].value.s);
+      all_options_value_written(option_cache[write.first].key,
+                                option_cache[write.first].value.s);
+    }
+  };
+}
+
+static int option_apply_suppressed = 0;
+static bool staged_mode = false;
+
+static void stage_option_change(const std::string &command);
 
 static void execute_hyprctl(const std::string &command) {
-  std::string full_command = "hyprctl keyword " + command;
-  std::system(full_command.c_str());
+  if (option_apply_suppressed)
+    return;
+  if (staged_mode) {
+    stage_option_change(command);
+    return;
+  }
+  std::string request = "keyword " + command;
+  dispatch_hyprctl(request, track_option_writes({request}));
 }
 
 static void execute_hyprctl_bind(const std::string &command) {
-  std::string full_command = "hyprctl " + command;
-  std::system(full_command.c_str());
+  dispatch_hyprctl(command, track_option_writes({command}));
+}
+
+static void execute_hyprctl_batch(const std::vector<std::string> &commands) {
+  std::string batch = "[[BATCH]]";
+  for (size_t i = 0; i < commands.size(); ++i) {
+    if (i > 0)
+      batch += ";";
+    batch += commands[i];
+  }
+  dispatch_hyprctl(batch, track_option_writes(commands));
 }
 
 static void refresh_layouts_list();
 
+static std::string join_list(const std::vector<std::string> &items) {
+  std::string result;
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (i > 0)
+      result += ",";
+    result += items[i];
+  }
+  return result;
+}
+
+static std::vector<std::string> split_list(const std::string &text) {
+  std::vector<std::string> items;
+  if (text.empty() || text == "[[EMPTY]]")
+    return items;
+  std::stringstream ss(text);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    item.erase(0, item.find_first_not_of(" \t"));
+    items.push_back(item);
+  }
+  return items;
+}
+
+using OptionValues = std::vector<std::pair<std::string, std::string>>;
+
+static OptionValues keyboard_layout_values() {
+  std::vector<std::string> layouts = selected_layouts;
+  if (layouts.empty())
+    layouts.push_back("us");
+  std::vector<std::string> variants;
+  for (const auto &layout : layouts) {
+    auto variant = layout_variants.find(layout);
+    variants.push_back(variant != layout_variants.end() ? variant->second
+                                                        : "");
+  }
+  return {{"input:kb_layout", join_list(layouts)},
+          {"input:kb_variant", join_list(variants)},
+          {"input:kb_options", join_list(xkb_options)}};
+}
+
+// Layouts, variants and options are sent together so the keymap is
+// recompiled once and never sees a variant list that doesn't match.
 static void apply_keyboard_layouts() {
-  if (selected_layouts.empty()) {
-    execute_hyprctl(
-        "input:kb_layout us"); 
+  std::vector<std::string> commands;
+  for (const auto &value : keyboard_layout_values())
+    commands.push_back(value.first + " " + value.second);
+  if (staged_mode || option_apply_suppressed) {
+    for (const auto &command : commands)
+      execute_hyprctl(command);
     return;
   }
-  std::string layouts_str;
-  for (size_t i = 0; i < selected_layouts.size(); ++i) {
-    if (i > 0)
-      layouts_str += ",";
-    layouts_str += selected_layouts[i];
-  }
-  execute_hyprctl("input:kb_layout " + layouts_str);
+  for (auto &command : commands)
+    command = "keyword " + command;
+  execute_hyprctl_batch(commands);
 }
 
 static gboolean deferred_refresh_layouts(gpointer) {
@@ -205,21 +1135,31 @@ static gboolean deferred_refresh_layouts(gpointer) {
 }
 
 static void on_sensitivity_changed(GtkRange *range, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   double value = gtk_range_get_value(range);
   std::ostringstream oss;
   oss << std::fixed << std::setprecision(2) << value;
   execute_hyprctl("input:sensitivity " + oss.str());
 }
 
+static void flush_accel_curve_push();
+static GtkWidget *accel_curve_group();
+
 static void on_accel_profile_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
   const char *profiles[] = {"", "flat", "adaptive"};
   if (selected > 0 && selected < 3) {
     execute_hyprctl(std::string("input:accel_profile ") + profiles[selected]);
+  } else if (selected == 3) {
+    flush_accel_curve_push();
   }
+  if (accel_curve_group())
+    gtk_widget_set_visible(accel_curve_group(), selected == 3);
 }
 
 static void on_scroll_method_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
   const char *methods[] = {"", "2fg", "edge", "on_button_down", "no_scroll"};
   if (selected > 0 && selected < 5) {
@@ -228,23 +1168,27 @@ static void on_scroll_method_changed(GObject *row, GParamSpec *, gpointer) {
 }
 
 static void on_follow_mouse_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
   execute_hyprctl("input:follow_mouse " + std::to_string(selected));
 }
 
 static void on_force_no_accel_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:force_no_accel ") +
                   (active ? "true" : "false"));
 }
 
 static void on_left_handed_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:left_handed ") +
                   (active ? "true" : "false"));
 }
 
 static void on_natural_scroll_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchpad:natural_scroll ") +
                   (active ? "true" : "false"));
@@ -252,12 +1196,14 @@ static void on_natural_scroll_changed(GObject *row, GParamSpec *, gpointer) {
 
 static void on_natural_scroll_mouse_changed(GObject *row, GParamSpec *,
                                             gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:natural_scroll ") +
                   (active ? "true" : "false"));
 }
 
 static void on_tap_to_click_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchpad:tap-to-click ") +
                   (active ? "true" : "false"));
@@ -265,18 +1211,21 @@ static void on_tap_to_click_changed(GObject *row, GParamSpec *, gpointer) {
 
 static void on_disable_while_typing_changed(GObject *row, GParamSpec *,
                                             gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchpad:disable_while_typing ") +
                   (active ? "true" : "false"));
 }
 
 static void on_drag_lock_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchpad:drag_lock ") +
                   (active ? "true" : "false"));
 }
 
 static void on_tap_and_drag_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchpad:tap-and-drag ") +
                   (active ? "true" : "false"));
@@ -284,6 +1233,7 @@ static void on_tap_and_drag_changed(GObject *row, GParamSpec *, gpointer) {
 
 static void on_middle_button_emulation_changed(GObject *row, GParamSpec *,
                                                gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchpad:middle_button_emulation ") +
                   (active ? "true" : "false"));
@@ -291,30 +1241,39 @@ static void on_middle_button_emulation_changed(GObject *row, GParamSpec *,
 
 static void on_clickfinger_behavior_changed(GObject *row, GParamSpec *,
                                             gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
   execute_hyprctl("input:touchpad:clickfinger_behavior " +
                   std::to_string(selected));
 }
 
 static void on_scroll_factor_changed(GtkRange *range, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   double value = gtk_range_get_value(range);
   std::ostringstream oss;
   oss << std::fixed << std::setprecision(2) << value;
   execute_hyprctl("input:touchpad:scroll_factor " + oss.str());
 }
 
+static void reset_key_repeat_tester();
+
 static void on_repeat_rate_changed(GtkRange *range, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   int value = static_cast<int>(gtk_range_get_value(range));
   execute_hyprctl("input:repeat_rate " + std::to_string(value));
+  reset_key_repeat_tester();
 }
 
 static void on_repeat_delay_changed(GtkRange *range, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   int value = static_cast<int>(gtk_range_get_value(range));
   execute_hyprctl("input:repeat_delay " + std::to_string(value));
+  reset_key_repeat_tester();
 }
 
 static void on_numlock_by_default_changed(GObject *row, GParamSpec *,
                                           gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:numlock_by_default ") +
                   (active ? "true" : "false"));
@@ -322,6 +1281,7 @@ static void on_numlock_by_default_changed(GObject *row, GParamSpec *,
 
 static void on_resolve_binds_by_sym_changed(GObject *row, GParamSpec *,
                                             gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:resolve_binds_by_sym ") +
                   (active ? "true" : "false"));
@@ -329,6 +1289,7 @@ static void on_resolve_binds_by_sym_changed(GObject *row, GParamSpec *,
 
 static void on_float_switch_override_changed(GObject *row, GParamSpec *,
                                              gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:float_switch_override_focus ") +
                   (active ? "2" : "0"));
@@ -336,12 +1297,14 @@ static void on_float_switch_override_changed(GObject *row, GParamSpec *,
 
 static void on_special_fallthrough_changed(GObject *row, GParamSpec *,
                                            gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:special_fallthrough ") +
                   (active ? "true" : "false"));
 }
 
 static void on_touchpad_toggle_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchpad:enabled ") +
                   (active ? "true" : "false"));
@@ -349,12 +1312,14 @@ static void on_touchpad_toggle_changed(GObject *row, GParamSpec *, gpointer) {
 
 static void on_touchdevice_toggle_changed(GObject *row, GParamSpec *,
                                           gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("input:touchdevice:enabled ") +
                   (active ? "true" : "false"));
 }
 
 static void on_workspace_swipe_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("gestures:workspace_swipe ") +
                   (active ? "true" : "false"));
@@ -362,18 +1327,21 @@ static void on_workspace_swipe_changed(GObject *row, GParamSpec *, gpointer) {
 
 static void on_workspace_swipe_fingers_changed(GObject *row, GParamSpec *,
                                                gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
   execute_hyprctl("gestures:workspace_swipe_fingers " +
                   std::to_string(selected + 3));
 }
 
 static void on_workspace_swipe_distance_changed(GtkRange *range, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   int value = static_cast<int>(gtk_range_get_value(range));
   execute_hyprctl("gestures:workspace_swipe_distance " + std::to_string(value));
 }
 
 static void on_workspace_swipe_invert_changed(GObject *row, GParamSpec *,
                                               gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("gestures:workspace_swipe_invert ") +
                   (active ? "true" : "false"));
@@ -381,17 +1349,20 @@ static void on_workspace_swipe_invert_changed(GObject *row, GParamSpec *,
 
 static void on_workspace_swipe_forever_changed(GObject *row, GParamSpec *,
                                                gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("gestures:workspace_swipe_forever ") +
                   (active ? "true" : "false"));
 }
 
 static void on_cursor_timeout_changed(GtkRange *range, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   int value = static_cast<int>(gtk_range_get_value(range));
   execute_hyprctl("cursor:inactive_timeout " + std::to_string(value));
 }
 
 static void on_cursor_zoom_factor_changed(GtkRange *range, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   double value = gtk_range_get_value(range);
   std::ostringstream oss;
   oss << std::fixed << std::setprecision(1) << value;
@@ -400,6 +1371,7 @@ static void on_cursor_zoom_factor_changed(GtkRange *range, gpointer) {
 
 static void on_cursor_hide_on_key_changed(GObject *row, GParamSpec *,
                                           gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("cursor:hide_on_key_press ") +
                   (active ? "true" : "false"));
@@ -407,6 +1379,7 @@ static void on_cursor_hide_on_key_changed(GObject *row, GParamSpec *,
 
 static void on_cursor_hide_on_touch_changed(GObject *row, GParamSpec *,
                                             gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
   execute_hyprctl(std::string("cursor:hide_on_touch ") +
                   (active ? "true" : "false"));
@@ -440,6 +1413,7 @@ static void apply_layout_switch_keybind() {
 }
 
 static void on_modifier_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
   selected_modifier_index = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
 }
 
@@ -554,45 +1528,386 @@ static void refresh_layouts_list() {
   gtk_widget_set_visible(layouts_list_box, !selected_layouts.empty());
 }
 
-static void on_layout_selected(GtkListBox *, GtkListBoxRow *row,
-                               gpointer dialog) {
-  if (!row)
-    return;
-  int index = gtk_list_box_row_get_index(row);
-  if (all_layouts[index].code) {
-    std::string layout = all_layouts[index].code;
-    if (std::find(selected_layouts.begin(), selected_layouts.end(), layout) ==
-        selected_layouts.end()) {
-      selected_layouts.push_back(layout);
-      refresh_layouts_list();
-      apply_keyboard_layouts();
+struct KeyCap {
+  int keycode;
+  double width;
+  const char *label;
+};
+
+// ISO pc105 main block, evdev keycodes; null labels come from the keymap.
+static const std::vector<std::vector<KeyCap>> keyboard_preview_rows = {
+    {{41, 1, nullptr},  {2, 1, nullptr},  {3, 1, nullptr},  {4, 1, nullptr},
+     {5, 1, nullptr},   {6, 1, nullptr},  {7, 1, nullptr},  {8, 1, nullptr},
+     {9, 1, nullptr},   {10, 1, nullptr}, {11, 1, nullptr}, {12, 1, nullptr},
+     {13, 1, nullptr},  {14, 2, "⌫"}},
+    {{15, 1.5, "⇥"},    {16, 1, nullptr}, {17, 1, nullptr}, {18, 1, nullptr},
+     {19, 1, nullptr},  {20, 1, nullptr}, {21, 1, nullptr}, {22, 1, nullptr},
+     {23, 1, nullptr},  {24, 1, nullptr}, {25, 1, nullptr}, {26, 1, nullptr},
+     {27, 1, nullptr},  {28, 1.5, "⏎"}},
+    {{58, 1.75, "⇪"},   {30, 1, nullptr}, {31, 1, nullptr}, {32, 1, nullptr},
+     {33, 1, nullptr},  {34, 1, nullptr}, {35, 1, nullptr}, {36, 1, nullptr},
+     {37, 1, nullptr},  {38, 1, nullptr}, {39, 1, nullptr}, {40, 1, nullptr},
+     {43, 1, nullptr},  {28, 1.25, "⏎"}},
+    {{42, 1.25, "⇧"},   {86, 1, nullptr}, {44, 1, nullptr}, {45, 1, nullptr},
+     {46, 1, nullptr},  {47, 1, nullptr}, {48, 1, nullptr}, {49, 1, nullptr},
+     {50, 1, nullptr},  {51, 1, nullptr}, {52, 1, nullptr}, {53, 1, nullptr},
+     {54, 2.75, "⇧"}},
+    {{0, 3.75, nullptr}, {57, 6.25, nullptr}, {0, 5, nullptr}},
+};
+
+struct KeymapSymbols {
+  bool valid = false;
+  std::unordered_map<int, std::pair<std::string, std::string>> keys;
+};
+
+struct LayoutPreview {
+  using Entry = std::pair<std::string, std::shared_ptr<KeymapSymbols>>;
+
+  size_t capacity = 32;
+  std::list<Entry> entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  std::unordered_map<std::string, bool> pending;
+  std::string shown;
+  GtkWidget *area = nullptr;
+  GtkWidget *variant_row = nullptr;
+  GtkWidget *add_button = nullptr;
+  int layout_index = -1;
+  std::vector<std::string> variants;
+};
+
+static LayoutPreview layout_preview;
+
+// Variant codes and descriptions per layout from the XKB rules catalog,
+// read the first time the Add Keyboard Layout dialog needs them.
+static const std::vector<std::pair<std::string, std::string>> &
+xkb_layout_variants(const std::string &layout) {
+  static std::unordered_map<std::string,
+                            std::vector<std::pair<std::string, std::string>>>
+      catalog;
+  static bool loaded = false;
+  if (!loaded) {
+    loaded = true;
+    g_autofree char *contents = nullptr;
+    if (g_file_get_contents("/usr/share/X11/xkb/rules/evdev.lst", &contents,
+                            nullptr, nullptr)) {
+      std::stringstream ss(contents);
+      std::string line;
+      std::string section;
+      while (std::getline(ss, line)) {
+        if (line.rfind("! ", 0) == 0) {
+          section = line.substr(2);
+          continue;
+        }
+        if (section != "variant")
+          continue;
+        std::stringstream fields(line);
+        std::string name;
+        std::string description;
+        if (!(fields >> name))
+          continue;
+        std::getline(fields, description);
+        description.erase(0, description.find_first_not_of(" \t"));
+        size_t colon = description.find(": ");
+        if (colon == std::string::npos)
+          continue;
+        catalog[description.substr(0, colon)].emplace_back(
+            name, description.substr(colon + 2));
+      }
     }
   }
-  adw_dialog_close(ADW_DIALOG(dialog));
+  static const std::vector<std::pair<std::string, std::string>> none;
+  auto it = catalog.find(layout);
+  return it != catalog.end() ? it->second : none;
 }
 
-static void on_add_layout_clicked(GtkButton *, gpointer parent_window) {
-  AdwDialog *dialog = adw_dialog_new();
-  adw_dialog_set_title(dialog, "Add Keyboard Layout");
-  adw_dialog_set_content_width(dialog, 360);
-  adw_dialog_set_content_height(dialog, 500);
+static std::string keysym_label(xkb_keysym_t sym) {
+  char buffer[16];
+  if (xkb_keysym_to_utf8(sym, buffer, sizeof(buffer)) <= 1)
+    return "";
+  // Dead keys and other controls come back as combining or control chars.
+  gunichar ch = g_utf8_get_char(buffer);
+  if (g_unichar_iscntrl(ch))
+    return "";
+  if (g_unichar_ismark(ch))
+    return std::string("◌") + buffer;
+  return buffer;
+}
 
-  GtkWidget *toolbar_view = adw_toolbar_view_new();
+// Runs on a worker thread; xkb contexts are not thread-safe, so each worker
+// keeps its own.
+static std::shared_ptr<KeymapSymbols> compile_keymap_symbols(
+    const std::string &layout, const std::string &variant) {
+  thread_local xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+  auto symbols = std::make_shared<KeymapSymbols>();
+  if (!context)
+    return symbols;
+
+  xkb_rule_names names = {};
+  names.rules = "evdev";
+  names.model = "pc105";
+  names.layout = layout.c_str();
+  names.variant = variant.c_str();
+  xkb_keymap *keymap =
+      xkb_keymap_new_from_names(context, &names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+  if (!keymap)
+    return symbols;
+
+  for (const auto &row : keyboard_preview_rows) {
+    for (const auto &key : row) {
+      if (key.label || key.keycode == 0)
+        continue;
+      xkb_keycode_t keycode = key.keycode + 8;
+      std::string levels[2];
+      for (int level = 0; level < 2; ++level) {
+        const xkb_keysym_t *syms = nullptr;
+        if (xkb_keymap_key_get_syms_by_level(keymap, keycode, 0, level,
+                                             &syms) > 0)
+          levels[level] = keysym_label(syms[0]);
+      }
+      g_autofree char *upper = g_utf8_strup(levels[0].c_str(), -1);
+      if (levels[1] == levels[0] || levels[1] == upper)
+        levels[1].clear();
+      symbols->keys[key.keycode] = {levels[0], levels[1]};
+    }
+  }
+  xkb_keymap_unref(keymap);
+  symbols->valid = true;
+  return symbols;
+}
 
-  GtkWidget *header = adw_header_bar_new();
-  adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbar_view), header);
+static std::shared_ptr<KeymapSymbols>
+lookup_layout_preview(const std::string &key) {
+  auto it = layout_preview.index.find(key);
+  if (it == layout_preview.index.end())
+    return nullptr;
+  layout_preview.entries.splice(layout_preview.entries.begin(),
+                                layout_preview.entries, it->second);
+  return it->second->second;
+}
 
-  GtkWidget *scrolled = gtk_scrolled_window_new();
-  gtk_widget_set_vexpand(scrolled, TRUE);
+static void request_layout_preview(const std::string &layout,
+                                   const std::string &variant) {
+  std::string key = variant.empty() ? layout : layout + "(" + variant + ")";
+  if (layout_preview.index.count(key) || layout_preview.pending.count(key))
+    return;
+  layout_preview.pending[key] = true;
+
+  worker_pool().submit([layout, variant, key] {
+    auto symbols = compile_keymap_symbols(layout, variant);
+    run_on_main([key, symbols] {
+      layout_preview.pending.erase(key);
+      layout_preview.entries.emplace_front(key, symbols);
+      layout_preview.index[key] = layout_preview.entries.begin();
+      if (layout_preview.entries.size() > layout_preview.capacity) {
+        layout_preview.index.erase(layout_preview.entries.back().first);
+        layout_preview.entries.pop_back();
+      }
+      if (layout_preview.area && layout_preview.shown == key)
+        gtk_widget_queue_draw(layout_preview.area);
+    });
+  });
+}
 
-  GtkWidget *list_box = gtk_list_box_new();
-  gtk_widget_add_css_class(list_box, "boxed-list");
-  gtk_widget_set_margin_start(list_box, 12);
-  gtk_widget_set_margin_end(list_box, 12);
-  gtk_widget_set_margin_top(list_box, 12);
-  gtk_widget_set_margin_bottom(list_box, 12);
+static void draw_key_label(GtkWidget *widget, cairo_t *cr,
+                           const std::string &text, double x, double y,
+                           double size) {
+  PangoLayout *layout = gtk_widget_create_pango_layout(widget, text.c_str());
+  PangoFontDescription *font = pango_font_description_new();
+  pango_font_description_set_absolute_size(font, size * PANGO_SCALE);
+  pango_layout_set_font_description(layout, font);
+  int text_width, text_height;
+  pango_layout_get_pixel_size(layout, &text_width, &text_height);
+  cairo_move_to(cr, x - text_width / 2.0, y - text_height / 2.0);
+  pango_cairo_show_layout(cr, layout);
+  pango_font_description_free(font);
+  g_object_unref(layout);
+}
 
-  for (int i = 0; all_layouts[i].code != nullptr; ++i) {
+static void draw_layout_preview(GtkDrawingArea *area, cairo_t *cr, int width,
+                                int height, gpointer) {
+  GtkWidget *widget = GTK_WIDGET(area);
+  GdkRGBA color;
+  gtk_widget_get_color(widget, &color);
+
+  auto symbols = layout_preview.shown.empty()
+                     ? nullptr
+                     : lookup_layout_preview(layout_preview.shown);
+  if (!symbols || !symbols->valid) {
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.5);
+    cairo_move_to(cr, 12, height / 2.0);
+    cairo_show_text(cr, layout_preview.shown.empty()
+                            ? "Select a layout to preview it"
+                        : symbols ? "No preview for this layout"
+                                  : "Loading…");
+    return;
+  }
+
+  const double units = 15;
+  const double rows = keyboard_preview_rows.size();
+  double unit = std::min((width - 8) / units, (height - 8) / rows);
+  double origin_x = (width - unit * units) / 2;
+  double origin_y = (height - unit * rows) / 2;
+  double gap = std::max(1.0, unit * 0.08);
+
+  for (size_t r = 0; r < keyboard_preview_rows.size(); ++r) {
+    double x = origin_x;
+    double y = origin_y + r * unit;
+    for (const auto &key : keyboard_preview_rows[r]) {
+      double w = key.width * unit;
+      if (key.keycode == 0) {
+        x += w;
+        continue;
+      }
+      cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.1);
+      cairo_rectangle(cr, x + gap / 2, y + gap / 2, w - gap, unit - gap);
+      cairo_fill(cr);
+
+      cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.9);
+      if (key.label) {
+        draw_key_label(widget, cr, key.label, x + w / 2, y + unit / 2,
+                       unit * 0.35);
+      } else {
+        auto it = symbols->keys.find(key.keycode);
+        if (it != symbols->keys.end()) {
+          const auto &levels = it->second;
+          if (levels.second.empty()) {
+            draw_key_label(widget, cr, levels.first, x + w / 2, y + unit / 2,
+                           unit * 0.4);
+          } else {
+            draw_key_label(widget, cr, levels.first, x + w / 2,
+                           y + unit * 0.68, unit * 0.32);
+            cairo_set_source_rgba(cr, color.red, color.green, color.blue,
+                                  0.55);
+            draw_key_label(widget, cr, levels.second, x + w / 2,
+                           y + unit * 0.32, unit * 0.28);
+          }
+        }
+      }
+      x += w;
+    }
+  }
+}
+
+static std::string selected_layout_variant() {
+  guint selected =
+      adw_combo_row_get_selected(ADW_COMBO_ROW(layout_preview.variant_row));
+  // Item 0 is the layout's default.
+  if (selected == 0 || selected > layout_preview.variants.size())
+    return "";
+  return layout_preview.variants[selected - 1];
+}
+
+static void on_layout_variant_changed(GObject *, GParamSpec *, gpointer) {
+  if (layout_preview.layout_index < 0)
+    return;
+  std::string layout = all_layouts[layout_preview.layout_index].code;
+  std::string variant = selected_layout_variant();
+  layout_preview.shown =
+      variant.empty() ? layout : layout + "(" + variant + ")";
+  request_layout_preview(layout, variant);
+  gtk_widget_queue_draw(layout_preview.area);
+}
+
+static void on_layout_row_selected(GtkListBox *, GtkListBoxRow *row,
+                                   gpointer) {
+  layout_preview.layout_index = row ? gtk_list_box_row_get_index(row) : -1;
+  gtk_widget_set_sensitive(layout_preview.add_button, row != nullptr);
+  if (!row)
+    return;
+  int index = layout_preview.layout_index;
+
+  layout_preview.variants.clear();
+  std::vector<const char *> names = {"Default"};
+  for (const auto &variant : xkb_layout_variants(all_layouts[index].code)) {
+    layout_preview.variants.push_back(variant.first);
+    names.push_back(variant.second.c_str());
+  }
+  names.push_back(nullptr);
+  GtkStringList *model = gtk_string_list_new(names.data());
+  adw_combo_row_set_model(ADW_COMBO_ROW(layout_preview.variant_row),
+                          G_LIST_MODEL(model));
+  g_object_unref(model);
+  adw_combo_row_set_selected(ADW_COMBO_ROW(layout_preview.variant_row), 0);
+  gtk_widget_set_sensitive(layout_preview.variant_row,
+                           !layout_preview.variants.empty());
+  on_layout_variant_changed(nullptr, nullptr, nullptr);
+
+  // Neighbours are compiled ahead so arrowing through the list hits the cache.
+  if (index > 0)
+    request_layout_preview(all_layouts[index - 1].code, "");
+  if (all_layouts[index + 1].code)
+    request_layout_preview(all_layouts[index + 1].code, "");
+}
+
+static void on_layout_dialog_closed(AdwDialog *, gpointer) {
+  layout_preview.area = nullptr;
+  layout_preview.variant_row = nullptr;
+  layout_preview.add_button = nullptr;
+  layout_preview.layout_index = -1;
+  layout_preview.variants.clear();
+  layout_preview.shown.clear();
+}
+
+// Adds the selected layout with the variant picked below the preview.
+static void add_selected_layout(AdwDialog *dialog) {
+  int index = layout_preview.layout_index;
+  if (index >= 0 && all_layouts[index].code) {
+    std::string layout = all_layouts[index].code;
+    if (std::find(selected_layouts.begin(), selected_layouts.end(), layout) ==
+        selected_layouts.end()) {
+      std::string variant = selected_layout_variant();
+      if (variant.empty())
+        layout_variants.erase(layout);
+      else
+        layout_variants[layout] = variant;
+      selected_layouts.push_back(layout);
+      refresh_layouts_list();
+      apply_keyboard_layouts();
+    }
+  }
+  adw_dialog_close(dialog);
+}
+
+static void on_layout_selected(GtkListBox *, GtkListBoxRow *row,
+                               gpointer dialog) {
+  if (row)
+    add_selected_layout(ADW_DIALOG(dialog));
+}
+
+static void on_add_selected_layout_clicked(GtkButton *, gpointer dialog) {
+  add_selected_layout(ADW_DIALOG(dialog));
+}
+
+static void on_add_layout_clicked(GtkButton *, gpointer parent_window) {
+  AdwDialog *dialog = adw_dialog_new();
+  adw_dialog_set_title(dialog, "Add Keyboard Layout");
+  adw_dialog_set_content_width(dialog, 480);
+  adw_dialog_set_content_height(dialog, 600);
+
+  GtkWidget *toolbar_view = adw_toolbar_view_new();
+
+  // Selecting a row previews it; Add, a double click or Enter adds it.
+  GtkWidget *header = adw_header_bar_new();
+  layout_preview.add_button = gtk_button_new_with_label("Add");
+  gtk_widget_add_css_class(layout_preview.add_button, "suggested-action");
+  gtk_widget_set_sensitive(layout_preview.add_button, FALSE);
+  g_signal_connect(layout_preview.add_button, "clicked",
+                   G_CALLBACK(on_add_selected_layout_clicked), dialog);
+  adw_header_bar_pack_end(ADW_HEADER_BAR(header), layout_preview.add_button);
+  adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbar_view), header);
+
+  GtkWidget *scrolled = gtk_scrolled_window_new();
+  gtk_widget_set_vexpand(scrolled, TRUE);
+
+  GtkWidget *list_box = gtk_list_box_new();
+  gtk_list_box_set_activate_on_single_click(GTK_LIST_BOX(list_box), FALSE);
+  gtk_widget_add_css_class(list_box, "boxed-list");
+  gtk_widget_set_margin_start(list_box, 12);
+  gtk_widget_set_margin_end(list_box, 12);
+  gtk_widget_set_margin_top(list_box, 12);
+  gtk_widget_set_margin_bottom(list_box, 12);
+
+  for (int i = 0; all_layouts[i].code != nullptr; ++i) {
     GtkWidget *row = adw_action_row_new();
     adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row),
                                   all_layouts[i].name);
@@ -613,196 +1928,5173 @@ static void on_add_layout_clicked(GtkButton *, gpointer parent_window) {
 
   g_signal_connect(list_box, "row-activated", G_CALLBACK(on_layout_selected),
                    dialog);
+  g_signal_connect(list_box, "row-selected",
+                   G_CALLBACK(on_layout_row_selected), nullptr);
 
   gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), list_box);
-  adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbar_view), scrolled);
+
+  layout_preview.area = gtk_drawing_area_new();
+  gtk_widget_set_size_request(layout_preview.area, -1, 150);
+  gtk_widget_set_margin_start(layout_preview.area, 12);
+  gtk_widget_set_margin_end(layout_preview.area, 12);
+  gtk_widget_set_margin_bottom(layout_preview.area, 12);
+  gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(layout_preview.area),
+                                 draw_layout_preview, nullptr, nullptr);
+
+  GtkWidget *variant_list = gtk_list_box_new();
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(variant_list),
+                                  GTK_SELECTION_NONE);
+  gtk_widget_add_css_class(variant_list, "boxed-list");
+  gtk_widget_set_margin_start(variant_list, 12);
+  gtk_widget_set_margin_end(variant_list, 12);
+  gtk_widget_set_margin_bottom(variant_list, 12);
+  layout_preview.variant_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(layout_preview.variant_row),
+                                "Variant");
+  gtk_widget_set_sensitive(layout_preview.variant_row, FALSE);
+  g_signal_connect(layout_preview.variant_row, "notify::selected",
+                   G_CALLBACK(on_layout_variant_changed), nullptr);
+  gtk_list_box_append(GTK_LIST_BOX(variant_list), layout_preview.variant_row);
+
+  GtkWidget *content = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+  gtk_box_append(GTK_BOX(content), scrolled);
+  gtk_box_append(GTK_BOX(content), layout_preview.area);
+  gtk_box_append(GTK_BOX(content), variant_list);
+  adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbar_view), content);
   adw_dialog_set_child(dialog, toolbar_view);
+  g_signal_connect(dialog, "closed", G_CALLBACK(on_layout_dialog_closed),
+                   nullptr);
 
   adw_dialog_present(dialog, GTK_WIDGET(parent_window));
 }
 
-static GtkWidget *create_mouse_page() {
-  GtkWidget *page = adw_preferences_page_new();
-  adw_preferences_page_set_title(ADW_PREFERENCES_PAGE(page), "Mouse");
-  adw_preferences_page_set_icon_name(ADW_PREFERENCES_PAGE(page),
-                                     "input-mouse-symbolic");
+static std::string hypr_control_config_path() {
+  return std::string(g_get_user_config_dir()) + "/hypr-control/settings.ini";
+}
 
-  GtkWidget *general_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(general_group),
-                                  "General");
+static GKeyFile *load_settings() {
+  GKeyFile *settings = g_key_file_new();
+  g_key_file_load_from_file(settings, hypr_control_config_path().c_str(),
+                            G_KEY_FILE_KEEP_COMMENTS, nullptr);
+  return settings;
+}
 
-  GtkWidget *sensitivity_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(sensitivity_row),
-                                "Sensitivity");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(sensitivity_row),
-                              "Mouse cursor speed multiplier");
-  GtkWidget *sensitivity_scale =
-      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, -1.0, 1.0, 0.05);
-  gtk_scale_set_draw_value(GTK_SCALE(sensitivity_scale), TRUE);
-  gtk_scale_set_value_pos(GTK_SCALE(sensitivity_scale), GTK_POS_LEFT);
-  gtk_range_set_value(GTK_RANGE(sensitivity_scale),
-                      get_float_option("input:sensitivity", 0.0));
-  gtk_widget_set_size_request(sensitivity_scale, 180, -1);
-  gtk_widget_set_valign(sensitivity_scale, GTK_ALIGN_CENTER);
-  g_signal_connect(sensitivity_scale, "value-changed",
-                   G_CALLBACK(on_sensitivity_changed), nullptr);
-  adw_action_row_add_suffix(ADW_ACTION_ROW(sensitivity_row), sensitivity_scale);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group),
-                            sensitivity_row);
+static void save_settings(GKeyFile *settings) {
+  std::string path = hypr_control_config_path();
+  g_autofree char *dir = g_path_get_dirname(path.c_str());
+  g_mkdir_with_parents(dir, 0755);
+  g_key_file_save_to_file(settings, path.c_str(), nullptr);
+}
 
-  const char *accel_options[] = {"Default", "Flat", "Adaptive", nullptr};
-  GtkStringList *accel_list = gtk_string_list_new(accel_options);
-  GtkWidget *accel_row = adw_combo_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(accel_row),
-                                "Acceleration Profile");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(accel_row),
-                              "Pointer acceleration curve");
-  adw_combo_row_set_model(ADW_COMBO_ROW(accel_row), G_LIST_MODEL(accel_list));
+static bool get_setting_bool(const char *group, const char *key,
+                             bool def_val) {
+  GKeyFile *settings = load_settings();
+  GError *error = nullptr;
+  bool value = g_key_file_get_boolean(settings, group, key, &error);
+  if (error) {
+    value = def_val;
+    g_error_free(error);
+  }
+  g_key_file_free(settings);
+  return value;
+}
 
-  std::string accel_val = get_string_option("input:accel_profile");
-  if (accel_val == "flat")
-    adw_combo_row_set_selected(ADW_COMBO_ROW(accel_row), 1);
-  else if (accel_val == "adaptive")
-    adw_combo_row_set_selected(ADW_COMBO_ROW(accel_row), 2);
+static void set_setting_bool(const char *group, const char *key, bool value) {
+  GKeyFile *settings = load_settings();
+  g_key_file_set_boolean(settings, group, key, value);
+  save_settings(settings);
+  g_key_file_free(settings);
+}
 
-  g_signal_connect(accel_row, "notify::selected",
-                   G_CALLBACK(on_accel_profile_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group), accel_row);
+static std::string daemon_lock_path() {
+  return std::string(g_get_user_runtime_dir()) + "/hypr-control-daemon.pid";
+}
 
-  GtkWidget *no_accel_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(no_accel_row),
-                                "Disable Acceleration");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(no_accel_row),
-                              "Force no pointer acceleration");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(no_accel_row),
-                            get_bool_option("input:force_no_accel", false));
-  g_signal_connect(no_accel_row, "notify::active",
-                   G_CALLBACK(on_force_no_accel_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group), no_accel_row);
+static pid_t running_daemon_pid() {
+  int fd = open(daemon_lock_path().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  pid_t pid = 0;
+  if (flock(fd, LOCK_SH | LOCK_NB) < 0) {
+    std::array<char, 32> buffer = {};
+    if (read(fd, buffer.data(), buffer.size() - 1) > 0)
+      pid = static_cast<pid_t>(std::atoi(buffer.data()));
+  }
+  close(fd);
+  return pid;
+}
 
-  GtkWidget *left_handed_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(left_handed_row),
-                                "Left Handed Mode");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(left_handed_row),
-                              "Swap left and right buttons");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(left_handed_row),
-                            get_bool_option("input:left_handed", false));
-  g_signal_connect(left_handed_row, "notify::active",
-                   G_CALLBACK(on_left_handed_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group),
-                            left_handed_row);
+static void notify_daemon_settings_changed(bool start_if_stopped) {
+  pid_t pid = running_daemon_pid();
+  if (pid > 0) {
+    kill(pid, SIGHUP);
+    return;
+  }
+  if (!start_if_stopped)
+    return;
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(general_group));
+  g_autofree char *self = g_file_read_link("/proc/self/exe", nullptr);
+  if (!self)
+    return;
+  char *argv[] = {self, const_cast<char *>("--daemon"), nullptr};
+  INSTRUMENT_COUNT(COUNT_SPAWNS, 1);
+  g_spawn_async(nullptr, argv, nullptr, G_SPAWN_DEFAULT, nullptr, nullptr,
+                nullptr, nullptr);
+}
 
-  GtkWidget *scroll_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(scroll_group),
-                                  "Scrolling");
+static void on_layout_memory_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
+  set_setting_bool("layout-memory", "enabled", active);
+  notify_daemon_settings_changed(active);
+}
 
-  GtkWidget *natural_scroll_mouse_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(natural_scroll_mouse_row),
-                                "Natural Scrolling");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(natural_scroll_mouse_row),
-                              "Invert scroll direction");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(natural_scroll_mouse_row),
-                            get_bool_option("input:natural_scroll", false));
-  g_signal_connect(natural_scroll_mouse_row, "notify::active",
-                   G_CALLBACK(on_natural_scroll_mouse_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group),
-                            natural_scroll_mouse_row);
+// Hyprland has no device hotplug event, so /dev/input is watched once for
+// everyone who cares, and subscribers run once the compositor has had time
+// to pick the device up.
+struct InputHotplug {
+  GFileMonitor *monitor = nullptr;
+  guint source = 0;
+  guint next_id = 0;
+  std::vector<std::pair<guint, std::function<void()>>> subscribers;
+};
 
-  const char *scroll_options[] = {"Default",        "Two Finger", "Edge",
-                                  "On Button Down", "No Scroll",  nullptr};
-  GtkStringList *scroll_list = gtk_string_list_new(scroll_options);
-  GtkWidget *scroll_method_row = adw_combo_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(scroll_method_row),
-                                "Scroll Method");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(scroll_method_row),
-                              "How scrolling is triggered");
-  adw_combo_row_set_model(ADW_COMBO_ROW(scroll_method_row),
-                          G_LIST_MODEL(scroll_list));
+static InputHotplug input_hotplug;
 
-  std::string scroll_val = get_string_option("input:scroll_method");
-  if (scroll_val == "2fg")
-    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 1);
-  else if (scroll_val == "edge")
-    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 2);
-  else if (scroll_val == "on_button_down")
-    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 3);
-  else if (scroll_val == "no_scroll")
-    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 4);
+static gboolean input_hotplug_timeout(gpointer) {
+  input_hotplug.source = 0;
+  // A subscriber may unsubscribe itself, so run from a copy.
+  auto subscribers = input_hotplug.subscribers;
+  for (const auto &subscriber : subscribers)
+    subscriber.second();
+  return G_SOURCE_REMOVE;
+}
 
-  g_signal_connect(scroll_method_row, "notify::selected",
-                   G_CALLBACK(on_scroll_method_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group),
-                            scroll_method_row);
+static void on_input_hotplug_changed(GFileMonitor *, GFile *, GFile *,
+                                     GFileMonitorEvent event, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  if (event != G_FILE_MONITOR_EVENT_CREATED &&
+      event != G_FILE_MONITOR_EVENT_DELETED)
+    return;
+  if (input_hotplug.source)
+    g_source_remove(input_hotplug.source);
+  input_hotplug.source = g_timeout_add(250, input_hotplug_timeout, nullptr);
+}
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(scroll_group));
+static guint input_hotplug_subscribe(std::function<void()> callback) {
+  if (input_hotplug.subscribers.empty()) {
+    GFile *input_dir = g_file_new_for_path("/dev/input");
+    input_hotplug.monitor = g_file_monitor_directory(
+        input_dir, G_FILE_MONITOR_NONE, nullptr, nullptr);
+    g_object_unref(input_dir);
+    if (input_hotplug.monitor)
+      g_signal_connect(input_hotplug.monitor, "changed",
+                       G_CALLBACK(on_input_hotplug_changed), nullptr);
+  }
+  guint id = ++input_hotplug.next_id;
+  input_hotplug.subscribers.emplace_back(id, std::move(callback));
+  return id;
+}
 
-  GtkWidget *focus_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(focus_group),
-                                  "Focus Behavior");
+static void input_hotplug_unsubscribe(guint id) {
+  auto &subscribers = input_hotplug.subscribers;
+  subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                   [id](const auto &subscriber) {
+                                     return subscriber.first == id;
+                                   }),
+                    subscribers.end());
+  if (!subscribers.empty())
+    return;
+  if (input_hotplug.source)
+    g_source_remove(input_hotplug.source);
+  input_hotplug.source = 0;
+  if (input_hotplug.monitor)
+    g_object_unref(input_hotplug.monitor);
+  input_hotplug.monitor = nullptr;
+}
 
-  const char *follow_options[] = {"Disabled", "Always", "Loose", "Strict",
-                                  nullptr};
-  GtkStringList *follow_list = gtk_string_list_new(follow_options);
-  GtkWidget *follow_row = adw_combo_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(follow_row),
-                                "Follow Mouse");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(follow_row),
-                              "Window focus follows mouse cursor");
-  adw_combo_row_set_model(ADW_COMBO_ROW(follow_row), G_LIST_MODEL(follow_list));
+struct LayoutMemory {
+  using Entry = std::pair<std::string, int>;
+
+  size_t capacity = 256;
+  bool by_address = false;
+  std::list<Entry> entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  std::unordered_map<std::string, std::string> xkb_descriptions;
+  // The last j/devices reply, refreshed off the main thread on start,
+  // configreloaded and hotplug rather than fetched on every event.
+  std::string devices;
+  std::string focused_key;
+  int active_layout = -1;
+  // Bumped per activelayout event, so a late lookup can tell it is stale.
+  uint32_t layout_events = 0;
+  guint save_source = 0;
+  guint hotplug_id = 0;
+};
 
-  int follow_val = get_int_option("input:follow_mouse", 1);
-  if (follow_val >= 0 && follow_val <= 3)
-    adw_combo_row_set_selected(ADW_COMBO_ROW(follow_row), follow_val);
+static LayoutMemory *layout_memory = nullptr;
 
-  g_signal_connect(follow_row, "notify::selected",
-                   G_CALLBACK(on_follow_mouse_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(focus_group), follow_row);
+static std::string layout_memory_path() {
+  return std::string(g_get_user_state_dir()) + "/hypr-control/layout-memory";
+}
 
-  GtkWidget *float_focus_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(float_focus_row),
-                                "Float Switch Override Focus");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(float_focus_row),
-                              "Focus floats on mouse hover");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(float_focus_row),
-      get_int_option("input:float_switch_override_focus", 1) == 2);
-  g_signal_connect(float_focus_row, "notify::active",
-                   G_CALLBACK(on_float_switch_override_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(focus_group),
-                            float_focus_row);
+static void layout_memory_remember(const std::string &key, int layout) {
+  auto it = layout_memory->index.find(key);
+  if (it != layout_memory->index.end()) {
+    it->second->second = layout;
+    layout_memory->entries.splice(layout_memory->entries.begin(),
+                                  layout_memory->entries, it->second);
+    return;
+  }
+  layout_memory->entries.emplace_front(key, layout);
+  layout_memory->index[key] = layout_memory->entries.begin();
+  while (layout_memory->entries.size() > layout_memory->capacity) {
+    layout_memory->index.erase(layout_memory->entries.back().first);
+    layout_memory->entries.pop_back();
+  }
+}
 
-  GtkWidget *special_fallthrough_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(special_fallthrough_row),
-                                "Special Fallthrough");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(special_fallthrough_row),
-                              "Click through special workspaces");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(special_fallthrough_row),
-      get_bool_option("input:special_fallthrough", false));
-  g_signal_connect(special_fallthrough_row, "notify::active",
-                   G_CALLBACK(on_special_fallthrough_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(focus_group),
-                            special_fallthrough_row);
+static void layout_memory_save() {
+  if (!layout_memory)
+    return;
+  std::string contents;
+  for (const auto &entry : layout_memory->entries)
+    contents += std::to_string(entry.second) + "\t" + entry.first + "\n";
+
+  std::string path = layout_memory_path();
+  g_autofree char *dir = g_path_get_dirname(path.c_str());
+  g_mkdir_with_parents(dir, 0755);
+  g_file_set_contents(path.c_str(), contents.c_str(), contents.size(),
+                      nullptr);
+}
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(focus_group));
+static gboolean layout_memory_save_timeout(gpointer) {
+  layout_memory->save_source = 0;
+  layout_memory_save();
+  return G_SOURCE_REMOVE;
+}
 
-  GtkWidget *cursor_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(cursor_group),
-                                  "Cursor");
+static void layout_memory_schedule_save() {
+  if (layout_memory->save_source == 0)
+    layout_memory->save_source =
+        g_timeout_add_seconds(5, layout_memory_save_timeout, nullptr);
+}
 
-  GtkWidget *cursor_timeout_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(cursor_timeout_row),
-                                "Hide Timeout");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(cursor_timeout_row),
-                              "Seconds before cursor hides (0 = never)");
-  GtkWidget *timeout_scale =
-      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0, 60, 1);
-  gtk_scale_set_draw_value(GTK_SCALE(timeout_scale), TRUE);
+static void layout_memory_load() {
+  g_autofree char *contents = nullptr;
+  if (!g_file_get_contents(layout_memory_path().c_str(), &contents, nullptr,
+                           nullptr))
+    return;
+
+  std::vector<LayoutMemory::Entry> loaded;
+  std::stringstream ss(contents);
+  std::string line;
+  while (std::getline(ss, line) && loaded.size() < layout_memory->capacity) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos)
+      continue;
+    try {
+      loaded.emplace_back(line.substr(tab + 1), std::stoi(line.substr(0, tab)));
+    } catch (...) {
+    }
+  }
+  for (auto it = loaded.rbegin(); it != loaded.rend(); ++it)
+    layout_memory_remember(it->first, it->second);
+}
+
+// Maps the layout names Hyprland reports in activelayout events (e.g.
+// "English (US)") back to "code" / "code(variant)" via the XKB rules catalog.
+static std::unordered_map<std::string, std::string> load_xkb_descriptions() {
+  std::unordered_map<std::string, std::string> descriptions;
+  g_autofree char *contents = nullptr;
+  if (!g_file_get_contents("/usr/share/X11/xkb/rules/evdev.lst", &contents,
+                           nullptr, nullptr))
+    return descriptions;
+
+  std::stringstream ss(contents);
+  std::string line;
+  std::string section;
+  while (std::getline(ss, line)) {
+    if (line.rfind("! ", 0) == 0) {
+      section = line.substr(2);
+      continue;
+    }
+    if (section != "layout" && section != "variant")
+      continue;
+    std::stringstream fields(line);
+    std::string name;
+    if (!(fields >> name))
+      continue;
+    std::string description;
+    std::getline(fields, description);
+    description.erase(0, description.find_first_not_of(" \t"));
+    if (section == "variant") {
+      size_t colon = description.find(": ");
+      if (colon == std::string::npos)
+        continue;
+      name = description.substr(0, colon) + "(" + name + ")";
+      description = description.substr(colon + 2);
+    }
+    descriptions.emplace(description, name);
+  }
+  return descriptions;
+}
+
+// Fetches j/devices on a worker, plus the XKB catalog the first time.
+static void layout_memory_refresh_devices() {
+  LayoutMemory *memory = layout_memory;
+  bool load_catalog = memory->xkb_descriptions.empty();
+  worker_pool().submit([memory, load_catalog] {
+    auto devices = std::make_shared<std::string>(
+        hypr_socket_request("j/devices"));
+    auto descriptions =
+        std::make_shared<std::unordered_map<std::string, std::string>>();
+    if (load_catalog)
+      *descriptions = load_xkb_descriptions();
+    run_on_main([memory, devices, descriptions] {
+      // Skip replies for a memory that was stopped in the meantime.
+      if (layout_memory != memory)
+        return;
+      memory->devices = std::move(*devices);
+      if (!descriptions->empty())
+        memory->xkb_descriptions = std::move(*descriptions);
+    });
+  });
+}
+
+// Finds the index of `layout_name` in the keyboard's layout list. Only a
+// fresh reply can be trusted for active_layout_index; a cached one is
+// matched by name.
+static int resolve_active_layout(const std::string &devices,
+                                 const std::string &keyboard,
+                                 const std::string &layout_name,
+                                 bool fresh) {
+  JsonParser *parser = json_parser_new();
+  int result = -1;
+  if (json_parser_load_from_data(parser, devices.c_str(), devices.size(),
+                                 nullptr) &&
+      JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser))) {
+    JsonObject *root = json_node_get_object(json_parser_get_root(parser));
+    JsonArray *keyboards =
+        json_object_has_member(root, "keyboards")
+            ? json_object_get_array_member(root, "keyboards")
+            : nullptr;
+    for (guint i = 0; keyboards && i < json_array_get_length(keyboards); ++i) {
+      JsonObject *kb = json_array_get_object_element(keyboards, i);
+      if (keyboard !=
+          json_object_get_string_member_with_default(kb, "name", ""))
+        continue;
+      if (fresh && json_object_has_member(kb, "active_layout_index")) {
+        result = json_object_get_int_member(kb, "active_layout_index");
+        break;
+      }
+
+      auto desc = layout_memory->xkb_descriptions.find(layout_name);
+      if (desc == layout_memory->xkb_descriptions.end())
+        break;
+
+      std::stringstream layouts(
+          json_object_get_string_member_with_default(kb, "layout", ""));
+      std::stringstream variants(
+          json_object_get_string_member_with_default(kb, "variant", ""));
+      std::string code;
+      std::string variant;
+      for (int index = 0; std::getline(layouts, code, ','); ++index) {
+        if (!std::getline(variants, variant, ','))
+          variant.clear();
+        std::string name = variant.empty() ? code : code + "(" + variant + ")";
+        if (name == desc->second || (result < 0 && code == desc->second))
+          result = index;
+        if (name == desc->second)
+          break;
+      }
+      break;
+    }
+  }
+  g_object_unref(parser);
+  return result;
+}
+
+static void layout_memory_layout_changed(const std::string &focused,
+                                         int layout) {
+  layout_memory->active_layout = layout;
+  if (!focused.empty()) {
+    layout_memory_remember(focused, layout);
+    layout_memory_schedule_save();
+  }
+}
+
+static void on_layout_memory_event(const std::string &event,
+                                   const std::string &data) {
+  if (!layout_memory)
+    return;
+
+  if (event == "configreloaded") {
+    layout_memory_refresh_devices();
+    return;
+  }
+
+  bool focus_event = layout_memory->by_address ? event == "activewindowv2"
+                                               : event == "activewindow";
+  if (focus_event) {
+    std::string key = layout_memory->by_address
+                          ? data
+                          : data.substr(0, data.find(','));
+    if (key.empty())
+      return;
+    key.resize(std::min<size_t>(key.size(), 128));
+    layout_memory->focused_key = key;
+
+    auto it = layout_memory->index.find(key);
+    if (it == layout_memory->index.end()) {
+      if (layout_memory->active_layout >= 0) {
+        layout_memory_remember(key, layout_memory->active_layout);
+        layout_memory_schedule_save();
+      }
+      return;
+    }
+    int layout = it->second->second;
+    layout_memory->entries.splice(layout_memory->entries.begin(),
+                                  layout_memory->entries, it->second);
+    if (layout != layout_memory->active_layout) {
+      dispatch_hyprctl("switchxkblayout all " + std::to_string(layout));
+      layout_memory->active_layout = layout;
+    }
+    return;
+  }
+
+  if (event == "activelayout") {
+    size_t comma = data.find(',');
+    if (comma == std::string::npos)
+      return;
+    std::string keyboard = data.substr(0, comma);
+    std::string name = data.substr(comma + 1);
+    uint32_t sequence = ++layout_memory->layout_events;
+    int layout =
+        resolve_active_layout(layout_memory->devices, keyboard, name, false);
+    if (layout >= 0) {
+      layout_memory_layout_changed(layout_memory->focused_key, layout);
+      return;
+    }
+    // A layout the cache can't place: ask on a worker, and keep the reply
+    // for the events that follow. New keyboards reach the cache through
+    // the hotplug watcher instead.
+    LayoutMemory *memory = layout_memory;
+    std::string focused = layout_memory->focused_key;
+    worker_pool().submit([memory, keyboard, name, focused, sequence] {
+      std::string devices = hypr_socket_request("j/devices");
+      run_on_main([memory, keyboard, name, focused, sequence, devices] {
+        if (layout_memory != memory)
+          return;
+        memory->devices = devices;
+        if (memory->layout_events != sequence)
+          return;
+        int layout = resolve_active_layout(devices, keyboard, name, true);
+        if (layout >= 0)
+          layout_memory_layout_changed(focused, layout);
+      });
+    });
+  }
+}
+
+static void layout_memory_start() {
+  if (layout_memory)
+    return;
+  layout_memory = new LayoutMemory();
+
+  GKeyFile *settings = load_settings();
+  gint capacity =
+      g_key_file_get_integer(settings, "layout-memory", "capacity", nullptr);
+  if (capacity > 0)
+    layout_memory->capacity = capacity;
+  g_autofree char *key_mode =
+      g_key_file_get_string(settings, "layout-memory", "key", nullptr);
+  layout_memory->by_address = key_mode && g_str_equal(key_mode, "address");
+  g_key_file_free(settings);
+
+  layout_memory_load();
+  layout_memory_refresh_devices();
+  layout_memory->hotplug_id =
+      input_hotplug_subscribe(layout_memory_refresh_devices);
+}
+
+static void layout_memory_stop() {
+  if (!layout_memory)
+    return;
+  if (layout_memory->save_source)
+    g_source_remove(layout_memory->save_source);
+  input_hotplug_unsubscribe(layout_memory->hotplug_id);
+  layout_memory_save();
+  delete layout_memory;
+  layout_memory = nullptr;
+}
+
+static void on_input_state_setting_changed(GObject *row, GParamSpec *,
+                                          gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
+  set_setting_bool("status", "enabled", active);
+  notify_daemon_settings_changed(active);
+}
+
+static void on_input_rules_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  gboolean active = adw_switch_row_get_active(ADW_SWITCH_ROW(row));
+  set_setting_bool("rules", "enabled", active);
+  notify_daemon_settings_changed(active);
+}
+
+enum RuleAtomKind {
+  RULE_DEVICE,
+  RULE_MONITOR,
+  RULE_CLASS,
+  RULE_WORKSPACE,
+  RULE_KIND_COUNT
+};
+
+static const char *rule_condition_keys[RULE_KIND_COUNT] = {
+    "device", "monitor", "class", "workspace"};
+
+struct RuleAtom {
+  RuleAtomKind kind;
+  std::string source;
+  GPatternSpec *pattern;
+};
+
+struct CompiledRule {
+  std::string name;
+  uint64_t required = 0;
+  uint64_t forbidden = 0;
+  std::vector<std::pair<size_t, std::string>> values;
+};
+
+// Conditions are compiled to one bit each, so a rule matches when
+// (state & required) == required and (state & forbidden) == 0.
+struct RuleEngine {
+  std::vector<RuleAtom> atoms;
+  std::array<uint64_t, RULE_KIND_COUNT> kind_masks = {};
+  std::vector<CompiledRule> rules;
+  std::vector<std::string> keys;
+  std::vector<std::string> baseline;
+  std::vector<std::string> applied;
+  // The last subjects seen per kind, so recompiled atoms can be matched
+  // without asking the compositor again.
+  std::array<std::vector<std::string>, RULE_KIND_COUNT> subjects;
+  uint64_t state = 0;
+  guint hotplug_id = 0;
+  // Writes and baseline reads go out in order, off the event path.
+  std::unique_ptr<WorkerPool> executor = std::make_unique<WorkerPool>(1);
+};
+
+static RuleEngine *rule_engine = nullptr;
+
+static GVariant *string_array_variant(const std::vector<std::string> &items);
+static void input_state_set(const char *name, GVariant *value);
+
+static std::string rules_path() {
+  return std::string(g_get_user_config_dir()) + "/hypr-control/rules.conf";
+}
+
+static std::string query_option_value(const std::string &key) {
+  std::string output = hypr_socket_request("j/getoption " + key);
+  JsonParser *parser = json_parser_new();
+  std::string value;
+  if (json_parser_load_from_data(parser, output.c_str(), output.size(),
+                                 nullptr) &&
+      JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser))) {
+    JsonObject *obj = json_node_get_object(json_parser_get_root(parser));
+    for (const char *member : {"int", "float", "str", "custom"}) {
+      if (json_object_has_member(obj, member)) {
+        value = stringify_json_node(json_object_get_member(obj, member));
+        break;
+      }
+    }
+  }
+  g_object_unref(parser);
+  return value;
+}
+
+static int rule_atom_index(RuleAtomKind kind, const std::string &source) {
+  for (size_t i = 0; i < rule_engine->atoms.size(); ++i) {
+    if (rule_engine->atoms[i].kind == kind &&
+        rule_engine->atoms[i].source == source)
+      return i;
+  }
+  if (rule_engine->atoms.size() == 64)
+    return -1;
+  g_autofree char *lower = g_utf8_strdown(source.c_str(), -1);
+  rule_engine->atoms.push_back({kind, source, g_pattern_spec_new(lower)});
+  rule_engine->kind_masks[kind] |= 1ULL << (rule_engine->atoms.size() - 1);
+  return rule_engine->atoms.size() - 1;
+}
+
+static size_t rule_key_slot(const std::string &key) {
+  auto it = std::find(rule_engine->keys.begin(), rule_engine->keys.end(), key);
+  if (it != rule_engine->keys.end())
+    return it - rule_engine->keys.begin();
+  rule_engine->keys.push_back(key);
+  rule_engine->baseline.push_back(query_option_value(key));
+  rule_engine->applied.push_back(rule_engine->baseline.back());
+  return rule_engine->keys.size() - 1;
+}
+
+static void rules_compile() {
+  GKeyFile *file = g_key_file_new();
+  if (!g_key_file_load_from_file(file, rules_path().c_str(), G_KEY_FILE_NONE,
+                                 nullptr)) {
+    g_key_file_free(file);
+    return;
+  }
+
+  gsize n_groups = 0;
+  g_auto(GStrv) groups = g_key_file_get_groups(file, &n_groups);
+  for (gsize g = 0; g < n_groups; ++g) {
+    CompiledRule rule;
+    rule.name = groups[g];
+    bool valid = true;
+    for (int kind = 0; kind < RULE_KIND_COUNT; ++kind) {
+      g_auto(GStrv) patterns = g_key_file_get_string_list(
+          file, groups[g], rule_condition_keys[kind], nullptr, nullptr);
+      for (int i = 0; patterns && patterns[i]; ++i) {
+        bool negated = patterns[i][0] == '!';
+        int atom = rule_atom_index(static_cast<RuleAtomKind>(kind),
+                                   patterns[i] + (negated ? 1 : 0));
+        if (atom < 0) {
+          g_printerr("hypr-control: too many rule conditions, ignoring [%s]\n",
+                     groups[g]);
+          valid = false;
+          break;
+        }
+        (negated ? rule.forbidden : rule.required) |= 1ULL << atom;
+      }
+    }
+
+    g_auto(GStrv) sets =
+        g_key_file_get_string_list(file, groups[g], "set", nullptr, nullptr);
+    for (int i = 0; valid && sets && sets[i]; ++i) {
+      std::string assignment = g_strstrip(sets[i]);
+      size_t space = assignment.find(' ');
+      if (space == std::string::npos)
+        continue;
+      rule.values.emplace_back(rule_key_slot(assignment.substr(0, space)),
+                               assignment.substr(space + 1));
+    }
+    if (valid && !rule.values.empty())
+      rule_engine->rules.push_back(std::move(rule));
+  }
+  g_key_file_free(file);
+}
+
+static void rules_match(RuleAtomKind kind) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < rule_engine->atoms.size(); ++i) {
+    if (rule_engine->atoms[i].kind != kind)
+      continue;
+    for (const auto &subject : rule_engine->subjects[kind]) {
+      if (g_pattern_spec_match_string(rule_engine->atoms[i].pattern,
+                                      subject.c_str())) {
+        bits |= 1ULL << i;
+        break;
+      }
+    }
+  }
+  rule_engine->state = (rule_engine->state & ~rule_engine->kind_masks[kind]) |
+                       bits;
+}
+
+static void rules_update(RuleAtomKind kind,
+                         const std::vector<std::string> &subjects) {
+  rule_engine->subjects[kind] = subjects;
+  rules_match(kind);
+}
+
+static void rules_update(RuleAtomKind kind, const std::string &subject) {
+  g_autofree char *lower = g_utf8_strdown(subject.c_str(), -1);
+  rules_update(kind, std::vector<std::string>{lower});
+}
+
+// Keys not set by any matching rule fall back to their baseline: the value
+// they had when the rules were loaded or the config was last reloaded.
+// Evaluating only touches memory; the batch is sent by the executor.
+static void rules_apply() {
+  std::vector<const std::string *> outcome(rule_engine->keys.size());
+  for (size_t i = 0; i < outcome.size(); ++i)
+    outcome[i] = &rule_engine->baseline[i];
+  std::vector<std::string> active;
+  for (const auto &rule : rule_engine->rules) {
+    if ((rule_engine->state & rule.required) != rule.required ||
+        (rule_engine->state & rule.forbidden) != 0)
+      continue;
+    active.push_back(rule.name);
+    for (const auto &value : rule.values)
+      outcome[value.first] = &value.second;
+  }
+  input_state_set("ActiveRules", string_array_variant(active));
+
+  std::string batch;
+  for (size_t i = 0; i < outcome.size(); ++i) {
+    if (*outcome[i] == rule_engine->applied[i])
+      continue;
+    batch += (batch.empty() ? "[[BATCH]]keyword " : ";keyword ") +
+             rule_engine->keys[i] + " " + *outcome[i];
+    rule_engine->applied[i] = *outcome[i];
+    input_state_option_written(rule_engine->keys[i], *outcome[i]);
+  }
+  if (!batch.empty())
+    rule_engine->executor->submit([batch] { hypr_socket_request(batch); });
+}
+
+static std::vector<std::string> query_names(const std::string &request) {
+  std::vector<std::string> names;
+  std::string output = hypr_socket_request(request);
+  JsonParser *parser = json_parser_new();
+  if (!json_parser_load_from_data(parser, output.c_str(), output.size(),
+                                  nullptr)) {
+    g_object_unref(parser);
+    return names;
+  }
+
+  auto collect = [&](JsonArray *array) {
+    for (guint i = 0; array && i < json_array_get_length(array); ++i) {
+      JsonObject *obj = json_array_get_object_element(array, i);
+      for (const char *key : {"name", "description"}) {
+        g_autofree char *lower = g_utf8_strdown(
+            json_object_get_string_member_with_default(obj, key, ""), -1);
+        if (*lower)
+          names.push_back(lower);
+      }
+    }
+  };
+  JsonNode *root = json_parser_get_root(parser);
+  if (JSON_NODE_HOLDS_ARRAY(root)) {
+    collect(json_node_get_array(root));
+  } else if (JSON_NODE_HOLDS_OBJECT(root)) {
+    JsonObject *obj = json_node_get_object(root);
+    for (const char *section :
+         {"mice", "keyboards", "tablets", "touch", "switches"}) {
+      if (json_object_has_member(obj, section))
+        collect(json_object_get_array_member(obj, section));
+    }
+  }
+  g_object_unref(parser);
+  return names;
+}
+
+// Replies that arrive after the engine was stopped or replaced are
+// dropped.
+static void rules_query(RuleAtomKind kind, const std::string &request) {
+  RuleEngine *engine = rule_engine;
+  worker_pool().submit([engine, kind, request] {
+    std::vector<std::string> names = query_names(request);
+    run_on_main([engine, kind, names] {
+      if (rule_engine != engine)
+        return;
+      rules_update(kind, names);
+      rules_apply();
+    });
+  });
+}
+
+static void rules_query_devices() { rules_query(RULE_DEVICE, "j/devices"); }
+
+static void rules_query_monitors() {
+  rules_query(RULE_MONITOR, "j/monitors");
+}
+
+// A reload resets every keyword, so the baselines are read again and the
+// matching rules resent. The reads queue behind writes already sent.
+static void rules_refresh_baselines() {
+  RuleEngine *engine = rule_engine;
+  engine->executor->submit([engine, keys = engine->keys] {
+    std::vector<std::string> values;
+    for (const auto &key : keys)
+      values.push_back(query_option_value(key));
+    run_on_main([engine, values] {
+      if (rule_engine != engine)
+        return;
+      for (size_t i = 0; i < values.size(); ++i) {
+        rule_engine->baseline[i] = values[i];
+        rule_engine->applied[i] = values[i];
+      }
+      rules_apply();
+    });
+  });
+}
+
+static void on_rules_event(const std::string &event, const std::string &data) {
+  if (!rule_engine)
+    return;
+
+  if (event == "activewindow") {
+    rules_update(RULE_CLASS, data.substr(0, data.find(',')));
+  } else if (event == "workspace") {
+    rules_update(RULE_WORKSPACE, data);
+  } else if (event == "focusedmon") {
+    rules_update(RULE_WORKSPACE, data.substr(data.find(',') + 1));
+  } else if (event == "monitoradded" || event == "monitorremoved") {
+    rules_query_monitors();
+    return;
+  } else if (event == "configreloaded") {
+    rules_refresh_baselines();
+    return;
+  } else {
+    return;
+  }
+  rules_apply();
+}
+
+static void rules_start() {
+  if (rule_engine)
+    return;
+  rule_engine = new RuleEngine();
+  rules_compile();
+
+  std::string window = hypr_socket_request("activewindow");
+  size_t class_pos = window.find("\tclass: ");
+  if (class_pos != std::string::npos) {
+    class_pos += 8;
+    rules_update(RULE_CLASS,
+                 window.substr(class_pos, window.find('\n', class_pos) -
+                                              class_pos));
+  }
+  std::string workspace = hypr_socket_request("activeworkspace");
+  size_t open = workspace.find('(');
+  size_t close_paren = workspace.find(')', open);
+  if (open != std::string::npos && close_paren != std::string::npos)
+    rules_update(RULE_WORKSPACE,
+                 workspace.substr(open + 1, close_paren - open - 1));
+  // Asked inline this once, so rules that depend on hardware are right on
+  // the first apply instead of flickering in when the replies arrive.
+  rules_update(RULE_MONITOR, query_names("j/monitors"));
+  rules_update(RULE_DEVICE, query_names("j/devices"));
+
+  rule_engine->hotplug_id = input_hotplug_subscribe(rules_query_devices);
+
+  rules_apply();
+}
+
+// Recompiles rules.conf in place. Keys keep their baselines and applied
+// values, so only what the new rules change is sent; a restart would put
+// every key back and then set it again.
+static void rules_reload() {
+  for (auto &atom : rule_engine->atoms)
+    g_pattern_spec_free(atom.pattern);
+  rule_engine->atoms.clear();
+  rule_engine->kind_masks = {};
+  rule_engine->rules.clear();
+  rule_engine->state = 0;
+  rules_compile();
+  for (int kind = 0; kind < RULE_KIND_COUNT; ++kind)
+    rules_match(static_cast<RuleAtomKind>(kind));
+  rules_apply();
+}
+
+static void rules_stop() {
+  if (!rule_engine)
+    return;
+  input_hotplug_unsubscribe(rule_engine->hotplug_id);
+  for (auto &atom : rule_engine->atoms)
+    g_pattern_spec_free(atom.pattern);
+  // Put back what the rules changed so disabling them is not sticky.
+  std::string batch;
+  for (size_t i = 0; i < rule_engine->keys.size(); ++i) {
+    if (rule_engine->applied[i] != rule_engine->baseline[i])
+      batch += (batch.empty() ? "[[BATCH]]keyword " : ";keyword ") +
+               rule_engine->keys[i] + " " + rule_engine->baseline[i];
+  }
+  if (!batch.empty())
+    rule_engine->executor->submit([batch] { hypr_socket_request(batch); });
+  // Waits for the executor to send everything queued.
+  delete rule_engine;
+  rule_engine = nullptr;
+}
+
+static const char input_state_xml[] =
+    "<node>"
+    "  <interface name='com.github.hyprcontrol.InputState'>"
+    "    <property name='Layouts' type='as' access='read'/>"
+    "    <property name='ActiveLayout' type='s' access='read'/>"
+    "    <property name='TouchpadEnabled' type='b' access='read'/>"
+    "    <property name='ActiveRules' type='as' access='read'/>"
+    "    <property name='Devices' type='a(ss)' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+static const char *input_state_name = "com.github.hyprcontrol.InputState";
+static const char *input_state_path = "/com/github/hyprcontrol/InputState";
+
+// Published on the session bus so status bars can follow PropertiesChanged
+// instead of polling hyprctl. The app and the daemon both request the
+// name; the other one waits in the queue and takes over when it exits.
+struct InputState {
+  guint owner_id = 0;
+  guint registration_id = 0;
+  bool owned = false;
+  GDBusConnection *connection = nullptr;
+  GDBusNodeInfo *node = nullptr;
+  guint hotplug_id = 0;
+  std::unordered_map<std::string, GVariant *> properties;
+};
+
+static InputState *input_state = nullptr;
+
+static GVariant *string_array_variant(const std::vector<std::string> &items) {
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("as"));
+  for (const auto &item : items)
+    g_variant_builder_add(&builder, "s", item.c_str());
+  return g_variant_builder_end(&builder);
+}
+
+// Takes ownership of `value`; emits PropertiesChanged only on a change.
+static void input_state_set(const char *name, GVariant *value) {
+  g_variant_ref_sink(value);
+  if (!input_state) {
+    g_variant_unref(value);
+    return;
+  }
+  GVariant *&slot = input_state->properties[name];
+  if (slot && g_variant_equal(slot, value)) {
+    g_variant_unref(value);
+    return;
+  }
+  if (slot)
+    g_variant_unref(slot);
+  slot = value;
+  if (!input_state->owned)
+    return;
+
+  GVariantBuilder changed;
+  g_variant_builder_init(&changed, G_VARIANT_TYPE("a{sv}"));
+  g_variant_builder_add(&changed, "{sv}", name, value);
+  g_dbus_connection_emit_signal(
+      input_state->connection, nullptr, input_state_path,
+      "org.freedesktop.DBus.Properties", "PropertiesChanged",
+      g_variant_new("(sa{sv}as)", input_state_name, &changed, nullptr),
+      nullptr);
+}
+
+static void input_state_option_written(const std::string &key,
+                                       const std::string &value) {
+  if (key == "input:kb_layout")
+    input_state_set("Layouts", string_array_variant(split_list(value)));
+  else if (key == "input:touchpad:enabled")
+    input_state_set("TouchpadEnabled",
+                    g_variant_new_boolean(value == "1" || value == "true"));
+}
+
+// Both keys are startup options, so in the app this reads what the
+// prefetch already fetched instead of making two more round trips.
+static void input_state_query_options() {
+  for (const char *key : {"input:kb_layout", "input:touchpad:enabled"})
+    input_state_option_written(key, option_value(key).s);
+}
+
+static void input_state_devices_received(const std::string &output) {
+  if (!input_state)
+    return;
+  JsonParser *parser = json_parser_new();
+  if (!json_parser_load_from_data(parser, output.c_str(), output.size(),
+                                  nullptr) ||
+      !JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser))) {
+    g_object_unref(parser);
+    return;
+  }
+
+  JsonObject *root = json_node_get_object(json_parser_get_root(parser));
+  GVariantBuilder devices;
+  g_variant_builder_init(&devices, G_VARIANT_TYPE("a(ss)"));
+  for (const char *section :
+       {"mice", "keyboards", "tablets", "touch", "switches"}) {
+    JsonArray *array = json_object_has_member(root, section)
+                           ? json_object_get_array_member(root, section)
+                           : nullptr;
+    for (guint i = 0; array && i < json_array_get_length(array); ++i) {
+      JsonObject *device = json_array_get_object_element(array, i);
+      const char *name =
+          json_object_get_string_member_with_default(device, "name", "");
+      g_variant_builder_add(&devices, "(ss)", name, section);
+      if (std::strcmp(section, "keyboards") == 0 &&
+          json_object_get_boolean_member_with_default(device, "main", FALSE))
+        input_state_set(
+            "ActiveLayout",
+            g_variant_new_string(json_object_get_string_member_with_default(
+                device, "active_keymap", "")));
+    }
+  }
+  input_state_set("Devices", g_variant_builder_end(&devices));
+  g_object_unref(parser);
+}
+
+static void input_state_query_devices() {
+  worker_pool().submit([] {
+    std::string output = hypr_socket_request("j/devices");
+    run_on_main([output] { input_state_devices_received(output); });
+  });
+}
+
+static void on_input_state_event(const std::string &event,
+                                 const std::string &data) {
+  if (!input_state)
+    return;
+  if (event == "activelayout") {
+    std::string layout = data.substr(data.find(',') + 1);
+    input_state_set("ActiveLayout", g_variant_new_string(layout.c_str()));
+  } else if (event == "configreloaded") {
+    input_state_query_options();
+    input_state_query_devices();
+  }
+}
+
+static GVariant *on_input_state_get_property(GDBusConnection *,
+                                             const gchar *, const gchar *,
+                                             const gchar *,
+                                             const gchar *property,
+                                             GError **error, gpointer) {
+  auto it = input_state->properties.find(property);
+  if (it == input_state->properties.end()) {
+    g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+                "No such property: %s", property);
+    return nullptr;
+  }
+  return g_variant_ref(it->second);
+}
+
+static void on_input_state_bus_acquired(GDBusConnection *connection,
+                                        const gchar *, gpointer) {
+  static const GDBusInterfaceVTable vtable = {
+      nullptr, on_input_state_get_property, nullptr, {}};
+  input_state->connection = connection;
+  input_state->registration_id = g_dbus_connection_register_object(
+      connection, input_state_path, input_state->node->interfaces[0],
+      &vtable, nullptr, nullptr, nullptr);
+}
+
+static void on_input_state_name_acquired(GDBusConnection *, const gchar *,
+                                         gpointer) {
+  input_state->owned = true;
+}
+
+static void on_input_state_name_lost(GDBusConnection *, const gchar *,
+                                     gpointer) {
+  input_state->owned = false;
+}
+
+static void input_state_start() {
+  if (input_state)
+    return;
+  input_state = new InputState();
+  input_state->node = g_dbus_node_info_new_for_xml(input_state_xml, nullptr);
+  input_state_set("ActiveLayout", g_variant_new_string(""));
+  input_state_set("ActiveRules", string_array_variant({}));
+  // Filled in when the worker's j/devices reply arrives.
+  input_state_set("Devices", g_variant_new_array(G_VARIANT_TYPE("(ss)"),
+                                                 nullptr, 0));
+  input_state_query_options();
+  input_state_query_devices();
+
+  input_state->hotplug_id = input_hotplug_subscribe(input_state_query_devices);
+
+  input_state->owner_id = g_bus_own_name(
+      G_BUS_TYPE_SESSION, input_state_name, G_BUS_NAME_OWNER_FLAGS_NONE,
+      on_input_state_bus_acquired, on_input_state_name_acquired,
+      on_input_state_name_lost, nullptr, nullptr);
+}
+
+static void input_state_stop() {
+  if (!input_state)
+    return;
+  g_bus_unown_name(input_state->owner_id);
+  if (input_state->registration_id)
+    g_dbus_connection_unregister_object(input_state->connection,
+                                        input_state->registration_id);
+  input_hotplug_unsubscribe(input_state->hotplug_id);
+  g_dbus_node_info_unref(input_state->node);
+  for (auto &property : input_state->properties)
+    g_variant_unref(property.second);
+  delete input_state;
+  input_state = nullptr;
+}
+
+static GMainLoop *daemon_loop = nullptr;
+
+// Returns false when no service is enabled, so the daemon can exit.
+static bool reload_daemon_services() {
+  if (get_setting_bool("layout-memory", "enabled", false))
+    layout_memory_start();
+  else
+    layout_memory_stop();
+
+  if (!get_setting_bool("rules", "enabled", false))
+    rules_stop();
+  else if (rule_engine)
+    rules_reload();
+  else
+    rules_start();
+
+  if (get_setting_bool("status", "enabled", false))
+    input_state_start();
+  else
+    input_state_stop();
+
+  return layout_memory || rule_engine || input_state;
+}
+
+static gboolean on_daemon_reload_signal(gpointer) {
+  layout_memory_stop();
+  if (!reload_daemon_services())
+    g_main_loop_quit(daemon_loop);
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_daemon_quit_signal(gpointer) {
+  g_main_loop_quit(daemon_loop);
+  return G_SOURCE_CONTINUE;
+}
+
+static int run_daemon() {
+  int lock_fd = open(daemon_lock_path().c_str(),
+                     O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (lock_fd < 0 || flock(lock_fd, LOCK_EX | LOCK_NB) < 0) {
+    g_printerr("hypr-control: daemon already running\n");
+    return 1;
+  }
+  std::string pid = std::to_string(getpid()) + "\n";
+  if (ftruncate(lock_fd, 0) < 0 ||
+      write(lock_fd, pid.c_str(), pid.size()) < 0) {
+    close(lock_fd);
+    return 1;
+  }
+
+  daemon_loop = g_main_loop_new(nullptr, FALSE);
+  // First, so the status service reads fresh options on configreloaded.
+  hypr_event_handlers.push_back(on_option_cache_event);
+  hypr_event_handlers.push_back(on_layout_memory_event);
+  hypr_event_handlers.push_back(on_rules_event);
+  hypr_event_handlers.push_back(on_input_state_event);
+  g_unix_signal_add(SIGHUP, on_daemon_reload_signal, nullptr);
+  g_unix_signal_add(SIGTERM, on_daemon_quit_signal, nullptr);
+  g_unix_signal_add(SIGINT, on_daemon_quit_signal, nullptr);
+
+  // Nothing enabled: exit now rather than quit a loop that isn't running.
+  if (reload_daemon_services()) {
+    start_hypr_event_listener();
+    g_main_loop_run(daemon_loop);
+  }
+
+  layout_memory_stop();
+  rules_stop();
+  input_state_stop();
+  g_main_loop_unref(daemon_loop);
+  unlink(daemon_lock_path().c_str());
+  close(lock_fd);
+  return 0;
+}
+
+struct ReplayRecord {
+  gint64 time;
+  gint64 duration;
+  std::string response;
+};
+
+struct ReplayData {
+  std::mutex mutex;
+  bool fast = false;
+  gint64 latency = 0;
+  gint64 origin = 0;
+  int in_flight = 0;
+  gint64 last_reply = 0;
+  std::unordered_map<std::string, std::vector<ReplayRecord>> replies;
+  std::unordered_map<std::string, size_t> next_reply;
+  std::vector<std::pair<gint64, std::string>> events;
+  std::string runtime_dir;
+  std::string signature;
+};
+
+static bool load_ipc_recording(const char *path, ReplayData &data) {
+  gchar *contents = nullptr;
+  gsize length = 0;
+  if (!g_file_get_contents(path, &contents, &length, nullptr))
+    return false;
+  std::string text(contents, length);
+  g_free(contents);
+
+  const std::string header = "HCREC1\n";
+  size_t pos = 0;
+  while (pos < text.size()) {
+    if (text.compare(pos, header.size(), header) == 0) {
+      pos += header.size();
+      continue;
+    }
+    size_t newline = text.find('\n', pos);
+    if (newline == std::string::npos)
+      return false;
+    char kind = 0;
+    long long time = 0, duration = 0;
+    size_t request_size = 0, response_size = 0;
+    if (std::sscanf(text.c_str() + pos, "%c %lld %lld %zu %zu", &kind, &time,
+                    &duration, &request_size, &response_size) != 5 ||
+        newline + 1 + request_size + response_size > text.size())
+      return false;
+    std::string request = text.substr(newline + 1, request_size);
+    std::string response =
+        text.substr(newline + 1 + request_size, response_size);
+    pos = newline + 1 + request_size + response_size;
+
+    if (data.origin == 0 || time < data.origin)
+      data.origin = time;
+    if (kind == 'Q')
+      data.replies[request].push_back({time, duration, response});
+    else if (kind == 'E')
+      data.events.emplace_back(time, request);
+  }
+  std::sort(data.events.begin(), data.events.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  return true;
+}
+
+static int listen_unix_socket(const std::string &path) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    return -1;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, 16) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void write_all(int fd, const std::string &data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n <= 0)
+      return;
+    written += n;
+  }
+}
+
+// Serves recorded replies in the order they were recorded, repeating the
+// last one once a request's recordings run out. Writes that were never
+// recorded are acknowledged like Hyprland would.
+static void serve_replay_request(int fd, ReplayData *data) {
+  // Batches can be far larger than one buffer. Read to EOF, which this app
+  // signals by shutting down its write side; hyprctl doesn't, so a short
+  // read followed by a quiet 50 ms also ends the request.
+  std::string request;
+  std::array<char, 8192> buffer;
+  ssize_t n;
+  while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+    request.append(buffer.data(), n);
+    pollfd more = {fd, POLLIN, 0};
+    if (static_cast<size_t>(n) < buffer.size() && poll(&more, 1, 50) <= 0)
+      break;
+  }
+  if (request.empty()) {
+    close(fd);
+    return;
+  }
+
+  std::string response = "unknown request";
+  gint64 duration = 0;
+  {
+    std::lock_guard<std::mutex> lock(data->mutex);
+    ++data->in_flight;
+    auto it = data->replies.find(request);
+    if (it != data->replies.end()) {
+      size_t &next = data->next_reply[request];
+      const ReplayRecord &record = it->second[next];
+      response = record.response;
+      duration = record.duration;
+      if (next + 1 < it->second.size())
+        ++next;
+    } else if (request.rfind("keyword ", 0) == 0 ||
+               request.rfind("[[BATCH]]", 0) == 0) {
+      response = "ok";
+      duration = data->latency;
+    }
+  }
+  if (!data->fast)
+    g_usleep(duration);
+  write_all(fd, response);
+  close(fd);
+
+  std::lock_guard<std::mutex> lock(data->mutex);
+  --data->in_flight;
+  data->last_reply = g_get_monotonic_time();
+}
+
+static void serve_replay_events(int fd, ReplayData *data) {
+  gint64 start = g_get_monotonic_time();
+  for (const auto &event : data->events) {
+    if (!data->fast) {
+      gint64 due = start + (event.first - data->origin);
+      gint64 now = g_get_monotonic_time();
+      if (due > now)
+        g_usleep(due - now);
+    }
+    write_all(fd, event.second);
+  }
+  // Hold the connection open like the compositor does.
+  char byte;
+  while (read(fd, &byte, 1) > 0) {
+  }
+  close(fd);
+}
+
+static void serve_replay(int request_fd, int event_fd, ReplayData *data) {
+  for (;;) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(request_fd, &fds);
+    FD_SET(event_fd, &fds);
+    if (select(std::max(request_fd, event_fd) + 1, &fds, nullptr, nullptr,
+               nullptr) < 0)
+      continue;
+    if (FD_ISSET(request_fd, &fds)) {
+      int client = accept4(request_fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client >= 0)
+        std::thread(serve_replay_request, client, data).detach();
+    }
+    if (FD_ISSET(event_fd, &fds)) {
+      int client = accept4(event_fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client >= 0)
+        std::thread(serve_replay_events, client, data).detach();
+    }
+  }
+}
+
+// Removes the runtime dir made by start_replay_sockets and the sockets in it.
+static void remove_replay_sockets(ReplayData *data) {
+  if (data->runtime_dir.empty())
+    return;
+  std::string hypr = data->runtime_dir + "/hypr";
+  std::string dir = hypr + "/" + data->signature;
+  g_unlink((dir + "/.socket.sock").c_str());
+  g_unlink((dir + "/.socket2.sock").c_str());
+  g_rmdir(dir.c_str());
+  g_rmdir(hypr.c_str());
+  g_rmdir(data->runtime_dir.c_str());
+  data->runtime_dir.clear();
+}
+
+// Creates $dir/hypr/<signature>/.socket{,2}.sock in a fresh runtime dir and
+// returns that dir, or "" on failure. Sockets are served on a thread.
+static std::string start_replay_sockets(ReplayData *data,
+                                        const char *signature) {
+  g_autofree char *runtime_dir =
+      g_dir_make_tmp("hypr-control-replay-XXXXXX", nullptr);
+  if (!runtime_dir)
+    return "";
+  data->runtime_dir = runtime_dir;
+  data->signature = signature;
+  std::string dir = std::string(runtime_dir) + "/hypr/" + signature;
+  g_mkdir_with_parents(dir.c_str(), 0700);
+  int request_fd = listen_unix_socket(dir + "/.socket.sock");
+  int event_fd = listen_unix_socket(dir + "/.socket2.sock");
+  if (request_fd < 0 || event_fd < 0) {
+    g_printerr("hypr-control: cannot create replay sockets in %s\n",
+               dir.c_str());
+    if (request_fd >= 0)
+      close(request_fd);
+    if (event_fd >= 0)
+      close(event_fd);
+    remove_replay_sockets(data);
+    return "";
+  }
+  signal(SIGPIPE, SIG_IGN);
+  std::thread(serve_replay, request_fd, event_fd, data).detach();
+  return runtime_dir;
+}
+
+static int run_replay_server(const char *path, bool fast) {
+  auto *data = new ReplayData();
+  data->fast = fast;
+  if (!load_ipc_recording(path, *data)) {
+    g_printerr("hypr-control: cannot read recording %s\n", path);
+    return 1;
+  }
+
+  // Block the exit signals before the server threads start, so they all
+  // arrive at the sigwait below and the sockets can be removed.
+  sigset_t exit_signals;
+  sigemptyset(&exit_signals);
+  sigaddset(&exit_signals, SIGINT);
+  sigaddset(&exit_signals, SIGTERM);
+  sigaddset(&exit_signals, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &exit_signals, nullptr);
+
+  std::string runtime_dir = start_replay_sockets(data, "replay");
+  if (runtime_dir.empty())
+    return 1;
+  std::printf("export XDG_RUNTIME_DIR=%s\n"
+              "export HYPRLAND_INSTANCE_SIGNATURE=replay\n",
+              runtime_dir.c_str());
+  std::fflush(stdout);
+  int signal_number = 0;
+  sigwait(&exit_signals, &signal_number);
+  remove_replay_sockets(data);
+  return 0;
+}
+
+template <typename T, size_t N> struct SampleRing {
+  static_assert((N & (N - 1)) == 0, "SampleRing size must be a power of two");
+
+  bool push(const T &item, T *evicted = nullptr) {
+    bool full = count == N;
+    if (full && evicted)
+      *evicted = items[head];
+    items[head] = item;
+    head = (head + 1) & (N - 1);
+    if (!full)
+      ++count;
+    return full;
+  }
+
+  const T &operator[](size_t i) const {
+    return items[(head + N - count + i) & (N - 1)];
+  }
+
+  size_t size() const { return count; }
+  void clear() { head = count = 0; }
+
+  // Drops the newest `n` items.
+  void truncate(size_t n) {
+    n = std::min(n, count);
+    head = (head + N - n) & (N - 1);
+    count -= n;
+  }
+
+  std::array<T, N> items = {};
+  size_t head = 0;
+  size_t count = 0;
+};
+
+static int speed_bin(double speed, int bins) {
+  if (speed <= 0)
+    return 0;
+  return std::clamp(std::ilogb(speed) + bins / 2, 0, bins - 1);
+}
+
+static void draw_histogram(cairo_t *cr, const uint32_t *bins, int n, double x,
+                           double y, double width, double height) {
+  uint32_t peak = *std::max_element(bins, bins + n);
+  if (peak == 0)
+    return;
+  double bar = width / n;
+  for (int i = 0; i < n; ++i) {
+    double h = height * bins[i] / peak;
+    cairo_rectangle(cr, x + i * bar + 1, y + height - h, bar - 2, h);
+  }
+  cairo_fill(cr);
+}
+
+struct PointerSample {
+  uint32_t dt;
+  float distance;
+};
+
+struct PointerStroke {
+  float distance;
+  float duration;
+};
+
+static constexpr int pointer_speed_bins = 16;
+static constexpr double comfortable_sweep_cm = 15.0;
+
+struct PointerPad {
+  SampleRing<PointerSample, 4096> samples;
+  SampleRing<PointerStroke, 64> strokes;
+  std::array<uint32_t, pointer_speed_bins> speed_histogram = {};
+  uint64_t rate_intervals = 0;
+  uint64_t rate_time = 0;
+  PointerStroke current = {};
+  bool has_last = false;
+  double last_x = 0;
+  double last_y = 0;
+  guint32 last_time = 0;
+  guint tick_id = 0;
+  double suggested = NAN;
+
+  GtkWidget *area = nullptr;
+  GtkWidget *stats_label = nullptr;
+  GtkWidget *apply_button = nullptr;
+  GtkAdjustment *stroke_length = nullptr;
+};
+
+static PointerPad pointer_pad;
+static GtkWidget *sensitivity_scale_widget = nullptr;
+
+static gboolean on_pointer_pad_tick(GtkWidget *widget, GdkFrameClock *,
+                                    gpointer);
+
+static void pointer_pad_schedule_update() {
+  if (pointer_pad.tick_id == 0)
+    pointer_pad.tick_id = gtk_widget_add_tick_callback(
+        pointer_pad.area, on_pointer_pad_tick, nullptr, nullptr);
+}
+
+static void pointer_pad_finish_stroke() {
+  if (pointer_pad.current.distance > 50 && pointer_pad.current.duration > 0)
+    pointer_pad.strokes.push(pointer_pad.current);
+  pointer_pad.current = {};
+}
+
+static void pointer_pad_record(guint32 time, double x, double y) {
+  if (!pointer_pad.has_last) {
+    pointer_pad.has_last = true;
+    pointer_pad.last_x = x;
+    pointer_pad.last_y = y;
+    pointer_pad.last_time = time;
+    return;
+  }
+
+  uint32_t dt = time - pointer_pad.last_time;
+  float distance =
+      std::hypot(x - pointer_pad.last_x, y - pointer_pad.last_y);
+  pointer_pad.last_x = x;
+  pointer_pad.last_y = y;
+  pointer_pad.last_time = time;
+
+  if (dt > 150) {
+    pointer_pad_finish_stroke();
+    return;
+  }
+
+  PointerSample evicted;
+  if (pointer_pad.samples.push({dt, distance}, &evicted)) {
+    if (evicted.dt > 0)
+      --pointer_pad.speed_histogram[speed_bin(
+          evicted.distance / evicted.dt, pointer_speed_bins)];
+    if (evicted.dt <= 20) {
+      --pointer_pad.rate_intervals;
+      pointer_pad.rate_time -= evicted.dt;
+    }
+  }
+  if (dt > 0)
+    ++pointer_pad.speed_histogram[speed_bin(distance / dt, pointer_speed_bins)];
+  if (dt <= 20) {
+    ++pointer_pad.rate_intervals;
+    pointer_pad.rate_time += dt;
+  }
+
+  pointer_pad.current.distance += distance;
+  pointer_pad.current.duration += dt;
+  pointer_pad_schedule_update();
+}
+
+static void on_pointer_pad_motion(GtkEventControllerMotion *controller,
+                                  double, double, gpointer) {
+  GdkEvent *event =
+      gtk_event_controller_get_current_event(GTK_EVENT_CONTROLLER(controller));
+  if (!event)
+    return;
+
+  guint n_coords = 0;
+  GdkTimeCoord *history = gdk_event_get_history(event, &n_coords);
+  for (guint i = 0; i < n_coords; ++i)
+    pointer_pad_record(history[i].time, history[i].axes[GDK_AXIS_X],
+                       history[i].axes[GDK_AXIS_Y]);
+  g_free(history);
+
+  double x, y;
+  if (gdk_event_get_position(event, &x, &y))
+    pointer_pad_record(gdk_event_get_time(event), x, y);
+}
+
+static void on_pointer_pad_leave(GtkEventControllerMotion *, gpointer) {
+  pointer_pad_finish_stroke();
+  pointer_pad.has_last = false;
+  pointer_pad_schedule_update();
+}
+
+static void update_pointer_pad_stats() {
+  double rate = pointer_pad.rate_time > 0
+                    ? 1000.0 * pointer_pad.rate_intervals /
+                          pointer_pad.rate_time
+                    : 0;
+
+  std::array<std::pair<float, float>, 64> by_speed;
+  size_t n = pointer_pad.strokes.size();
+  double stroke_cm = gtk_adjustment_get_value(pointer_pad.stroke_length);
+  for (size_t i = 0; i < n; ++i) {
+    const PointerStroke &stroke = pointer_pad.strokes[i];
+    by_speed[i] = {stroke.distance / stroke.duration,
+                   static_cast<float>(stroke.distance / stroke_cm)};
+  }
+  std::sort(by_speed.begin(), by_speed.begin() + n);
+
+  double slow_gain = 0;
+  double fast_gain = 0;
+  size_t half = n / 2;
+  for (size_t i = 0; i < n; ++i)
+    (i < half ? slow_gain : fast_gain) += by_speed[i].second;
+  if (half > 0) {
+    slow_gain /= half;
+    fast_gain /= n - half;
+  }
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(0) << "Polling rate: ~" << rate
+      << " Hz · Strokes: " << n;
+  pointer_pad.suggested = NAN;
+  if (half > 0) {
+    oss << "\nSlow gain: " << slow_gain << " px/cm · Fast/slow: "
+        << std::setprecision(2) << fast_gain / slow_gain;
+
+    GdkDisplay *display = gtk_widget_get_display(pointer_pad.area);
+    GtkNative *native = gtk_widget_get_native(pointer_pad.area);
+    GdkMonitor *monitor =
+        native ? gdk_display_get_monitor_at_surface(
+                     display, gtk_native_get_surface(native))
+               : nullptr;
+    if (monitor && sensitivity_scale_widget) {
+      GdkRectangle geometry;
+      gdk_monitor_get_geometry(monitor, &geometry);
+      double target = geometry.width / comfortable_sweep_cm;
+      double current = gtk_range_get_value(GTK_RANGE(sensitivity_scale_widget));
+      pointer_pad.suggested =
+          std::clamp((1.0 + current) * target / slow_gain - 1.0, -1.0, 1.0);
+      oss << "\nSuggested sensitivity: " << pointer_pad.suggested;
+    }
+  }
+  gtk_label_set_text(GTK_LABEL(pointer_pad.stats_label), oss.str().c_str());
+  gtk_widget_set_sensitive(pointer_pad.apply_button,
+                           !std::isnan(pointer_pad.suggested));
+}
+
+static gboolean on_pointer_pad_tick(GtkWidget *widget, GdkFrameClock *,
+                                    gpointer) {
+  pointer_pad.tick_id = 0;
+  update_pointer_pad_stats();
+  gtk_widget_queue_draw(widget);
+  return G_SOURCE_REMOVE;
+}
+
+static void draw_pointer_pad(GtkDrawingArea *area, cairo_t *cr, int width,
+                             int height, gpointer) {
+  GdkRGBA color;
+  gtk_widget_get_color(GTK_WIDGET(area), &color);
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.06);
+  cairo_rectangle(cr, 0, 0, width, height);
+  cairo_fill(cr);
+
+  if (pointer_pad.samples.size() == 0) {
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.5);
+    cairo_move_to(cr, 12, height / 2.0);
+    cairo_show_text(cr, "Move the pointer here in straight strokes");
+    return;
+  }
+
+  double half = width / 2.0;
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.6);
+  draw_histogram(cr, pointer_pad.speed_histogram.data(), pointer_speed_bins,
+                 8, 8, half - 16, height - 16);
+
+  float max_distance = 0;
+  for (size_t i = 0; i < pointer_pad.strokes.size(); ++i)
+    max_distance = std::max(max_distance, pointer_pad.strokes[i].distance);
+  if (max_distance <= 0)
+    return;
+
+  cairo_set_source_rgba(cr, 0.2, 0.5, 0.9, 0.9);
+  for (size_t i = 0; i < pointer_pad.strokes.size(); ++i) {
+    const PointerStroke &stroke = pointer_pad.strokes[i];
+    double speed = stroke.distance / stroke.duration;
+    double sx = half + 8 +
+                (half - 16) *
+                    speed_bin(speed, pointer_speed_bins) / pointer_speed_bins;
+    double sy = height - 8 - (height - 16) * stroke.distance / max_distance;
+    cairo_arc(cr, sx, sy, 3, 0, 2 * G_PI);
+    cairo_fill(cr);
+  }
+}
+
+static void on_pointer_pad_reset(GtkButton *, gpointer) {
+  pointer_pad.samples.clear();
+  pointer_pad.strokes.clear();
+  pointer_pad.speed_histogram.fill(0);
+  pointer_pad.rate_intervals = 0;
+  pointer_pad.rate_time = 0;
+  pointer_pad.current = {};
+  pointer_pad.has_last = false;
+  pointer_pad_schedule_update();
+}
+
+static void on_pointer_pad_apply(GtkButton *, gpointer) {
+  if (sensitivity_scale_widget && !std::isnan(pointer_pad.suggested))
+    gtk_range_set_value(GTK_RANGE(sensitivity_scale_widget),
+                        pointer_pad.suggested);
+}
+
+static GtkWidget *create_pointer_pad_group() {
+  GtkWidget *group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(group),
+                                  "Pointer Test");
+  adw_preferences_group_set_description(
+      ADW_PREFERENCES_GROUP(group),
+      "Move the mouse the same physical distance in slow and fast strokes");
+
+  GtkWidget *length_row = adw_spin_row_new_with_range(1, 50, 1);
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(length_row),
+                                "Stroke Length");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(length_row),
+                              "Physical distance of each stroke in cm");
+  adw_spin_row_set_value(ADW_SPIN_ROW(length_row), 10);
+  pointer_pad.stroke_length =
+      adw_spin_row_get_adjustment(ADW_SPIN_ROW(length_row));
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), length_row);
+
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+  gtk_widget_set_margin_top(box, 12);
+
+  pointer_pad.area = gtk_drawing_area_new();
+  gtk_widget_set_size_request(pointer_pad.area, -1, 200);
+  gtk_widget_add_css_class(pointer_pad.area, "card");
+  gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(pointer_pad.area),
+                                 draw_pointer_pad, nullptr, nullptr);
+  GtkEventController *motion = gtk_event_controller_motion_new();
+  g_signal_connect(motion, "motion", G_CALLBACK(on_pointer_pad_motion),
+                   nullptr);
+  g_signal_connect(motion, "leave", G_CALLBACK(on_pointer_pad_leave),
+                   nullptr);
+  gtk_widget_add_controller(pointer_pad.area, motion);
+  gtk_box_append(GTK_BOX(box), pointer_pad.area);
+
+  GtkWidget *footer = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+  pointer_pad.stats_label = gtk_label_new(nullptr);
+  gtk_label_set_xalign(GTK_LABEL(pointer_pad.stats_label), 0);
+  gtk_widget_set_hexpand(pointer_pad.stats_label, TRUE);
+  gtk_widget_add_css_class(pointer_pad.stats_label, "dim-label");
+  gtk_box_append(GTK_BOX(footer), pointer_pad.stats_label);
+
+  GtkWidget *reset_button = gtk_button_new_with_label("Reset");
+  gtk_widget_set_valign(reset_button, GTK_ALIGN_CENTER);
+  g_signal_connect(reset_button, "clicked", G_CALLBACK(on_pointer_pad_reset),
+                   nullptr);
+  gtk_box_append(GTK_BOX(footer), reset_button);
+
+  pointer_pad.apply_button = gtk_button_new_with_label("Apply Suggestion");
+  gtk_widget_add_css_class(pointer_pad.apply_button, "suggested-action");
+  gtk_widget_set_valign(pointer_pad.apply_button, GTK_ALIGN_CENTER);
+  g_signal_connect(pointer_pad.apply_button, "clicked",
+                   G_CALLBACK(on_pointer_pad_apply), nullptr);
+  gtk_box_append(GTK_BOX(footer), pointer_pad.apply_button);
+  gtk_box_append(GTK_BOX(box), footer);
+
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), box);
+  update_pointer_pad_stats();
+  return group;
+}
+
+static constexpr int accel_control_points = 5;
+static constexpr int accel_curve_points = 16;
+static constexpr int accel_preview_samples = (accel_curve_points - 1) * 16;
+static constexpr float accel_max_velocity = 8.0f;
+static constexpr float accel_max_output = 16.0f;
+
+struct AccelCurveEditor {
+  std::array<float, accel_control_points> x = {};
+  std::array<float, accel_control_points> y = {};
+  std::array<float, accel_curve_points> points = {};
+  alignas(32) std::array<float, accel_preview_samples> preview = {};
+  float step = accel_max_velocity / (accel_curve_points - 1);
+  int dragging = -1;
+  float drag_x = 0;
+  float drag_y = 0;
+  guint push_source = 0;
+
+  GtkWidget *group = nullptr;
+  GtkWidget *area = nullptr;
+};
+
+static AccelCurveEditor accel_editor;
+
+// The velocity the last curve point stands for. It is accel_max_velocity
+// unless an imported curve covers a different range.
+static float accel_velocity_range() {
+  return accel_editor.step * (accel_curve_points - 1);
+}
+
+// Piecewise linear between control points, clamped to be non-decreasing so
+// the resulting libinput curve never slows the pointer down as speed grows.
+static void resample_accel_curve() {
+  const auto &cx = accel_editor.x;
+  const auto &cy = accel_editor.y;
+  int segment = 0;
+  float previous = 0;
+  for (int i = 0; i < accel_curve_points; ++i) {
+    float v = i * accel_editor.step;
+    while (segment < accel_control_points - 2 && v > cx[segment + 1])
+      ++segment;
+    float span = cx[segment + 1] - cx[segment];
+    float t = span > 0 ? std::clamp((v - cx[segment]) / span, 0.0f, 1.0f) : 0;
+    float out = cy[segment] + (cy[segment + 1] - cy[segment]) * t;
+    previous = std::max(previous, out);
+    accel_editor.points[i] = previous;
+  }
+}
+
+// Evaluates the resampled curve the way libinput does (linear interpolation
+// between points) over a uniform velocity grid. Each segment covers a fixed
+// run of samples, so the inner loop is a branch-free multiply-add.
+static void evaluate_accel_curve(const float *points, int n_points,
+                                 float *out, int n_samples) {
+  const int per_segment = n_samples / (n_points - 1);
+  for (int s = 0; s < n_points - 1; ++s) {
+    const float base = points[s];
+    const float slope = (points[s + 1] - points[s]) / per_segment;
+    float *dst = out + s * per_segment;
+    for (int j = 0; j < per_segment; ++j)
+      dst[j] = base + slope * j;
+  }
+  for (int i = (n_points - 1) * per_segment; i < n_samples; ++i)
+    out[i] = points[n_points - 1];
+}
+
+static std::string accel_curve_profile() {
+  std::ostringstream oss;
+  oss << "custom " << std::fixed << std::setprecision(3) << accel_editor.step;
+  for (float point : accel_editor.points)
+    oss << " " << point;
+  return oss.str();
+}
+
+static gboolean push_accel_curve(gpointer) {
+  accel_editor.push_source = 0;
+  execute_hyprctl("input:accel_profile " + accel_curve_profile());
+  return G_SOURCE_REMOVE;
+}
+
+static void schedule_accel_curve_push() {
+  if (accel_editor.push_source == 0)
+    accel_editor.push_source = g_timeout_add(150, push_accel_curve, nullptr);
+}
+
+static void flush_accel_curve_push() {
+  if (accel_editor.push_source != 0)
+    g_source_remove(accel_editor.push_source);
+  push_accel_curve(nullptr);
+}
+
+static void update_accel_curve() {
+  resample_accel_curve();
+  evaluate_accel_curve(accel_editor.points.data(), accel_curve_points,
+                       accel_editor.preview.data(), accel_preview_samples);
+  if (accel_editor.area)
+    gtk_widget_queue_draw(accel_editor.area);
+}
+
+// A parsed curve keeps the velocity range its step and points cover; the
+// editor's step is rescaled so its points span the same range.
+static void init_accel_curve(const std::string &profile) {
+  accel_editor.step = accel_max_velocity / (accel_curve_points - 1);
+  for (int i = 0; i < accel_control_points; ++i) {
+    accel_editor.x[i] = accel_max_velocity * i / (accel_control_points - 1);
+    accel_editor.y[i] = accel_editor.x[i];
+  }
+
+  std::stringstream ss(profile);
+  std::string name;
+  float step;
+  std::vector<float> points;
+  if (ss >> name >> step && name == "custom" && step > 0) {
+    float point;
+    while (ss >> point)
+      points.push_back(point);
+  }
+  if (points.size() >= 2) {
+    accel_editor.step = step * (points.size() - 1) / (accel_curve_points - 1);
+    for (int i = 0; i < accel_control_points; ++i) {
+      size_t index = (points.size() - 1) * i / (accel_control_points - 1);
+      accel_editor.x[i] = index * step;
+      accel_editor.y[i] = std::min(points[index], accel_max_output);
+    }
+  }
+  update_accel_curve();
+}
+
+static void draw_accel_curve(GtkDrawingArea *area, cairo_t *cr, int width,
+                             int height, gpointer) {
+  GdkRGBA color;
+  gtk_widget_get_color(GTK_WIDGET(area), &color);
+  const double pad = 12;
+  const double w = width - 2 * pad;
+  const double h = height - 2 * pad;
+  const double range = accel_velocity_range();
+  auto to_x = [&](double v) { return pad + w * v / range; };
+  auto to_y = [&](double o) { return pad + h - h * o / accel_max_output; };
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.15);
+  cairo_set_line_width(cr, 1);
+  cairo_move_to(cr, to_x(0), to_y(0));
+  cairo_line_to(cr, to_x(range), to_y(range));
+  cairo_stroke(cr);
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.9);
+  cairo_set_line_width(cr, 2);
+  for (int i = 0; i < accel_preview_samples; ++i) {
+    double v = range * i / accel_preview_samples;
+    double y = to_y(accel_editor.preview[i]);
+    if (i == 0)
+      cairo_move_to(cr, to_x(v), y);
+    else
+      cairo_line_to(cr, to_x(v), y);
+  }
+  cairo_stroke(cr);
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.5);
+  for (int i = 0; i < accel_curve_points; ++i) {
+    cairo_arc(cr, to_x(i * accel_editor.step), to_y(accel_editor.points[i]),
+              2, 0, 2 * G_PI);
+    cairo_fill(cr);
+  }
+
+  cairo_set_source_rgba(cr, 0.2, 0.5, 0.9, 1);
+  for (int i = 0; i < accel_control_points; ++i) {
+    cairo_arc(cr, to_x(accel_editor.x[i]), to_y(accel_editor.y[i]), 6, 0,
+              2 * G_PI);
+    cairo_fill(cr);
+  }
+}
+
+static void on_accel_drag_begin(GtkGestureDrag *, double x, double y,
+                                gpointer) {
+  int width = gtk_widget_get_width(accel_editor.area);
+  int height = gtk_widget_get_height(accel_editor.area);
+  double w = width - 24;
+  double h = height - 24;
+  accel_editor.dragging = -1;
+  double best = 16 * 16;
+  for (int i = 0; i < accel_control_points; ++i) {
+    double px = 12 + w * accel_editor.x[i] / accel_velocity_range();
+    double py = 12 + h - h * accel_editor.y[i] / accel_max_output;
+    double d = (px - x) * (px - x) + (py - y) * (py - y);
+    if (d < best) {
+      best = d;
+      accel_editor.dragging = i;
+    }
+  }
+  if (accel_editor.dragging >= 0) {
+    accel_editor.drag_x = accel_editor.x[accel_editor.dragging];
+    accel_editor.drag_y = accel_editor.y[accel_editor.dragging];
+  }
+}
+
+static void on_accel_drag_update(GtkGestureDrag *, double dx, double dy,
+                                 gpointer) {
+  int i = accel_editor.dragging;
+  if (i < 0)
+    return;
+  double w = gtk_widget_get_width(accel_editor.area) - 24;
+  double h = gtk_widget_get_height(accel_editor.area) - 24;
+  if (w <= 0 || h <= 0)
+    return;
+
+  if (i > 0 && i < accel_control_points - 1) {
+    float lo = accel_editor.x[i - 1] + 0.05f;
+    float hi = accel_editor.x[i + 1] - 0.05f;
+    accel_editor.x[i] = std::clamp(
+        static_cast<float>(accel_editor.drag_x +
+                           dx * accel_velocity_range() / w),
+        lo, hi);
+  }
+  accel_editor.y[i] = std::clamp(
+      static_cast<float>(accel_editor.drag_y - dy * accel_max_output / h), 0.0f,
+      accel_max_output);
+
+  update_accel_curve();
+  schedule_accel_curve_push();
+}
+
+static void on_accel_drag_end(GtkGestureDrag *, double, double, gpointer) {
+  if (accel_editor.dragging >= 0)
+    flush_accel_curve_push();
+  accel_editor.dragging = -1;
+}
+
+// A wheel step is 15 degrees, which clients map to 15 surface pixels or three
+// lines of text; the same ratio converts touchpad (surface unit) scrolling.
+static constexpr double scroll_lines_per_wheel_unit = 3.0;
+static constexpr double scroll_pixels_per_line = 5.0;
+static constexpr int scroll_histogram_bins = 16;
+
+struct ScrollSample {
+  uint32_t dt;
+  float delta;
+};
+
+struct ScrollGesture {
+  float lines;
+  float duration;
+  uint32_t events;
+  bool wheel;
+};
+
+struct ScrollPad {
+  SampleRing<ScrollSample, 2048> samples;
+  SampleRing<ScrollGesture, 8> gestures;
+  std::array<uint32_t, scroll_histogram_bins> delta_histogram = {};
+  std::array<uint32_t, scroll_histogram_bins> interval_histogram = {};
+  ScrollGesture current = {};
+  guint32 last_time = 0;
+  bool in_gesture = false;
+  guint tick_id = 0;
+  guint idle_source = 0;
+  double suggested = NAN;
+  bool suggested_wheel = true;
+
+  GtkWidget *area = nullptr;
+  GtkWidget *label = nullptr;
+  GtkWidget *apply_button = nullptr;
+  GtkEventController *controller = nullptr;
+  GtkAdjustment *steps = nullptr;
+  GtkAdjustment *target_lines = nullptr;
+  double wheel_factor = 1.0;
+};
+
+static ScrollPad scroll_pad;
+static GtkWidget *scroll_factor_scale_widget = nullptr;
+
+static gboolean on_scroll_pad_tick(GtkWidget *widget, GdkFrameClock *,
+                                   gpointer);
+
+static void schedule_scroll_pad_update() {
+  if (scroll_pad.area && scroll_pad.tick_id == 0)
+    scroll_pad.tick_id = gtk_widget_add_tick_callback(
+        scroll_pad.area, on_scroll_pad_tick, nullptr, nullptr);
+}
+
+static void scroll_pad_finish_gesture() {
+  if (scroll_pad.current.events > 0)
+    scroll_pad.gestures.push(scroll_pad.current);
+  scroll_pad.current = {};
+  scroll_pad.in_gesture = false;
+  schedule_scroll_pad_update();
+}
+
+static gboolean on_scroll_pad_idle(gpointer) {
+  scroll_pad.idle_source = 0;
+  scroll_pad_finish_gesture();
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean on_scroll_pad_scroll(GtkEventControllerScroll *controller,
+                                     double dx, double dy, gpointer) {
+  guint32 time = gtk_event_controller_get_current_event_time(
+      GTK_EVENT_CONTROLLER(controller));
+  bool wheel = gtk_event_controller_scroll_get_unit(controller) ==
+               GDK_SCROLL_UNIT_WHEEL;
+  float delta = std::hypot(dx, dy);
+  uint32_t dt = scroll_pad.in_gesture ? time - scroll_pad.last_time : 0;
+  scroll_pad.last_time = time;
+
+  ScrollSample evicted;
+  if (scroll_pad.samples.push({dt, delta}, &evicted)) {
+    --scroll_pad.delta_histogram[speed_bin(evicted.delta,
+                                           scroll_histogram_bins)];
+    if (evicted.dt > 0)
+      --scroll_pad.interval_histogram[std::min<uint32_t>(
+          evicted.dt, scroll_histogram_bins - 1)];
+  }
+  ++scroll_pad.delta_histogram[speed_bin(delta, scroll_histogram_bins)];
+  if (dt > 0)
+    ++scroll_pad.interval_histogram[std::min<uint32_t>(
+        dt, scroll_histogram_bins - 1)];
+
+  scroll_pad.in_gesture = true;
+  scroll_pad.current.wheel = wheel;
+  scroll_pad.current.lines +=
+      wheel ? delta * scroll_lines_per_wheel_unit
+            : delta / scroll_pixels_per_line;
+  scroll_pad.current.duration += dt;
+  ++scroll_pad.current.events;
+
+  // Touchpads report scroll-end when the fingers lift; wheels never do, so
+  // a pause closes the burst instead.
+  if (wheel) {
+    if (scroll_pad.idle_source)
+      g_source_remove(scroll_pad.idle_source);
+    scroll_pad.idle_source = g_timeout_add(400, on_scroll_pad_idle, nullptr);
+  }
+  schedule_scroll_pad_update();
+  return TRUE;
+}
+
+static void on_scroll_pad_scroll_end(GtkEventControllerScroll *, gpointer) {
+  if (!scroll_pad.current.wheel)
+    scroll_pad_finish_gesture();
+}
+
+static void update_scroll_pad_stats() {
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1);
+
+  size_t n = scroll_pad.gestures.size();
+  scroll_pad.suggested = NAN;
+  if (n == 0) {
+    oss << "Scroll inside the box, then pause";
+  } else {
+    const ScrollGesture &last = scroll_pad.gestures[n - 1];
+    double lines = 0;
+    double events = 0;
+    double duration = 0;
+    size_t matching = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const ScrollGesture &g = scroll_pad.gestures[i];
+      if (g.wheel != last.wheel)
+        continue;
+      lines += g.lines;
+      events += g.events;
+      duration += g.duration;
+      ++matching;
+    }
+    double steps = gtk_adjustment_get_value(scroll_pad.steps) * matching;
+    double per_step = lines / steps;
+    oss << (last.wheel ? "Wheel" : "Touchpad") << ": " << per_step
+        << " lines per " << (last.wheel ? "notch" : "swipe");
+    if (duration > 0)
+      oss << " · " << std::setprecision(0) << 1000.0 * events / duration
+          << " events/s · " << std::setprecision(1)
+          << 1000.0 * lines / duration << " lines/s";
+
+    double current = last.wheel ? scroll_pad.wheel_factor
+                     : scroll_factor_scale_widget
+                         ? gtk_range_get_value(
+                               GTK_RANGE(scroll_factor_scale_widget))
+                         : 1.0;
+    if (per_step > 0) {
+      scroll_pad.suggested = std::clamp(
+          current * gtk_adjustment_get_value(scroll_pad.target_lines) /
+              per_step,
+          0.1, 3.0);
+      scroll_pad.suggested_wheel = last.wheel;
+      oss << "\nSuggested " << (last.wheel ? "" : "touchpad ")
+          << "scroll factor: " << std::setprecision(2)
+          << scroll_pad.suggested;
+    }
+  }
+  gtk_label_set_text(GTK_LABEL(scroll_pad.label), oss.str().c_str());
+  gtk_widget_set_sensitive(scroll_pad.apply_button,
+                           !std::isnan(scroll_pad.suggested));
+}
+
+static gboolean on_scroll_pad_tick(GtkWidget *widget, GdkFrameClock *,
+                                   gpointer) {
+  scroll_pad.tick_id = 0;
+  update_scroll_pad_stats();
+  gtk_widget_queue_draw(widget);
+  return G_SOURCE_REMOVE;
+}
+
+static void draw_scroll_pad(GtkDrawingArea *area, cairo_t *cr, int width,
+                            int height, gpointer) {
+  GdkRGBA color;
+  gtk_widget_get_color(GTK_WIDGET(area), &color);
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.06);
+  cairo_rectangle(cr, 0, 0, width, height);
+  cairo_fill(cr);
+
+  if (scroll_pad.samples.size() == 0) {
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.5);
+    cairo_move_to(cr, 12, height / 2.0);
+    cairo_show_text(cr, "Scroll here with the wheel or two fingers");
+    return;
+  }
+
+  double half = width / 2.0;
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.6);
+  draw_histogram(cr, scroll_pad.delta_histogram.data(), scroll_histogram_bins,
+                 8, 8, half - 16, height - 16);
+  cairo_set_source_rgba(cr, 0.2, 0.5, 0.9, 0.8);
+  draw_histogram(cr, scroll_pad.interval_histogram.data(),
+                 scroll_histogram_bins, half + 8, 8, half - 16, height - 16);
+}
+
+static void on_scroll_pad_mode_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
+  GtkEventControllerScrollFlags flags = GTK_EVENT_CONTROLLER_SCROLL_BOTH_AXES;
+  if (selected == 1)
+    flags = static_cast<GtkEventControllerScrollFlags>(
+        flags | GTK_EVENT_CONTROLLER_SCROLL_DISCRETE);
+  gtk_event_controller_scroll_set_flags(
+      GTK_EVENT_CONTROLLER_SCROLL(scroll_pad.controller), flags);
+}
+
+static void on_scroll_pad_reset(GtkButton *, gpointer) {
+  scroll_pad.samples.clear();
+  scroll_pad.gestures.clear();
+  scroll_pad.delta_histogram.fill(0);
+  scroll_pad.interval_histogram.fill(0);
+  scroll_pad.current = {};
+  scroll_pad.in_gesture = false;
+  schedule_scroll_pad_update();
+}
+
+static void on_scroll_pad_apply(GtkButton *, gpointer) {
+  if (std::isnan(scroll_pad.suggested))
+    return;
+  if (!scroll_pad.suggested_wheel) {
+    if (scroll_factor_scale_widget)
+      gtk_range_set_value(GTK_RANGE(scroll_factor_scale_widget),
+                          scroll_pad.suggested);
+    return;
+  }
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2) << scroll_pad.suggested;
+  execute_hyprctl("input:scroll_factor " + oss.str());
+  scroll_pad.wheel_factor = scroll_pad.suggested;
+  on_scroll_pad_reset(nullptr, nullptr);
+}
+
+static GtkWidget *create_scroll_pad_group() {
+  scroll_pad.wheel_factor = get_float_option("input:scroll_factor", 1.0);
+
+  GtkWidget *group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(group), "Scroll Test");
+  adw_preferences_group_set_description(
+      ADW_PREFERENCES_GROUP(group),
+      "Scroll a known number of notches or swipes, then pause");
+
+  const char *mode_options[] = {"Smooth", "Discrete", nullptr};
+  GtkWidget *mode_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(mode_row), "Event Mode");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(mode_row),
+                              "How the test area receives scroll events");
+  adw_combo_row_set_model(ADW_COMBO_ROW(mode_row),
+                          G_LIST_MODEL(gtk_string_list_new(mode_options)));
+  g_signal_connect(mode_row, "notify::selected",
+                   G_CALLBACK(on_scroll_pad_mode_changed), nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), mode_row);
+
+  GtkWidget *steps_row = adw_spin_row_new_with_range(1, 50, 1);
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(steps_row),
+                                "Notches per Test");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(steps_row),
+                              "Wheel notches or swipes in each burst");
+  adw_spin_row_set_value(ADW_SPIN_ROW(steps_row), 5);
+  scroll_pad.steps = adw_spin_row_get_adjustment(ADW_SPIN_ROW(steps_row));
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), steps_row);
+
+  GtkWidget *target_row = adw_spin_row_new_with_range(1, 10, 1);
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(target_row),
+                                "Target Lines per Notch");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(target_row),
+                              "Lines of text one notch should scroll");
+  adw_spin_row_set_value(ADW_SPIN_ROW(target_row), 3);
+  scroll_pad.target_lines =
+      adw_spin_row_get_adjustment(ADW_SPIN_ROW(target_row));
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), target_row);
+
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+  gtk_widget_set_margin_top(box, 12);
+
+  scroll_pad.area = gtk_drawing_area_new();
+  gtk_widget_set_size_request(scroll_pad.area, -1, 140);
+  gtk_widget_add_css_class(scroll_pad.area, "card");
+  gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(scroll_pad.area),
+                                 draw_scroll_pad, nullptr, nullptr);
+  scroll_pad.controller =
+      gtk_event_controller_scroll_new(GTK_EVENT_CONTROLLER_SCROLL_BOTH_AXES);
+  g_signal_connect(scroll_pad.controller, "scroll",
+                   G_CALLBACK(on_scroll_pad_scroll), nullptr);
+  g_signal_connect(scroll_pad.controller, "scroll-end",
+                   G_CALLBACK(on_scroll_pad_scroll_end), nullptr);
+  gtk_widget_add_controller(scroll_pad.area, scroll_pad.controller);
+  gtk_box_append(GTK_BOX(box), scroll_pad.area);
+
+  GtkWidget *footer = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+  scroll_pad.label = gtk_label_new(nullptr);
+  gtk_label_set_xalign(GTK_LABEL(scroll_pad.label), 0);
+  gtk_widget_set_hexpand(scroll_pad.label, TRUE);
+  gtk_widget_add_css_class(scroll_pad.label, "dim-label");
+  gtk_box_append(GTK_BOX(footer), scroll_pad.label);
+
+  GtkWidget *reset_button = gtk_button_new_with_label("Reset");
+  gtk_widget_set_valign(reset_button, GTK_ALIGN_CENTER);
+  g_signal_connect(reset_button, "clicked", G_CALLBACK(on_scroll_pad_reset),
+                   nullptr);
+  gtk_box_append(GTK_BOX(footer), reset_button);
+
+  scroll_pad.apply_button = gtk_button_new_with_label("Apply Suggestion");
+  gtk_widget_add_css_class(scroll_pad.apply_button, "suggested-action");
+  gtk_widget_set_valign(scroll_pad.apply_button, GTK_ALIGN_CENTER);
+  g_signal_connect(scroll_pad.apply_button, "clicked",
+                   G_CALLBACK(on_scroll_pad_apply), nullptr);
+  gtk_box_append(GTK_BOX(footer), scroll_pad.apply_button);
+  gtk_box_append(GTK_BOX(box), footer);
+
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), box);
+  update_scroll_pad_stats();
+  return group;
+}
+
+struct SwipeSample {
+  uint32_t dt;
+  float dx;
+  float dy;
+};
+
+struct SwipeGesture {
+  float distance;
+  float duration;
+  float peak_speed;
+  float end_speed;
+  uint32_t events;
+  uint8_t fingers;
+  bool pinch;
+};
+
+// Touchpad swipes and pinches land in fixed rings, so the event handler
+// never allocates; statistics and the plot are refreshed once per frame.
+struct GesturePad {
+  SampleRing<SwipeSample, 1024> samples;
+  SampleRing<SwipeGesture, 16> gestures;
+  SwipeGesture current = {};
+  float sum_x = 0;
+  float sum_y = 0;
+  guint32 last_time = 0;
+  bool in_gesture = false;
+  bool recording = false;
+  bool swipe_was_enabled = false;
+  guint tick_id = 0;
+  double suggested_distance = NAN;
+  double suggested_ratio = NAN;
+
+  GtkWidget *area = nullptr;
+  GtkWidget *label = nullptr;
+  GtkWidget *record_button = nullptr;
+  GtkWidget *apply_button = nullptr;
+  GtkWidget *distance_scale = nullptr;
+};
+
+static GesturePad gesture_pad;
+
+static gboolean on_gesture_pad_tick(GtkWidget *widget, GdkFrameClock *,
+                                    gpointer);
+
+static void schedule_gesture_pad_update() {
+  if (gesture_pad.area && gesture_pad.tick_id == 0)
+    gesture_pad.tick_id = gtk_widget_add_tick_callback(
+        gesture_pad.area, on_gesture_pad_tick, nullptr, nullptr);
+}
+
+// Forgets the gesture in progress along with the samples it recorded.
+static void drop_gesture_pad_current() {
+  if (gesture_pad.in_gesture)
+    gesture_pad.samples.truncate(gesture_pad.current.events);
+  gesture_pad.current = {};
+  gesture_pad.in_gesture = false;
+}
+
+static gboolean on_gesture_pad_event(GtkEventControllerLegacy *,
+                                     GdkEvent *event, gpointer) {
+  GdkEventType type = gdk_event_get_event_type(event);
+  if (!gesture_pad.recording ||
+      (type != GDK_TOUCHPAD_SWIPE && type != GDK_TOUCHPAD_PINCH))
+    return FALSE;
+
+  guint32 time = gdk_event_get_time(event);
+  switch (gdk_touchpad_event_get_gesture_phase(event)) {
+  case GDK_TOUCHPAD_GESTURE_PHASE_BEGIN:
+    gesture_pad.current = {};
+    gesture_pad.current.fingers = gdk_touchpad_event_get_n_fingers(event);
+    gesture_pad.current.pinch = type == GDK_TOUCHPAD_PINCH;
+    gesture_pad.sum_x = gesture_pad.sum_y = 0;
+    gesture_pad.last_time = time;
+    gesture_pad.in_gesture = true;
+    break;
+  case GDK_TOUCHPAD_GESTURE_PHASE_UPDATE: {
+    if (!gesture_pad.in_gesture)
+      break;
+    double dx, dy;
+    gdk_touchpad_event_get_deltas(event, &dx, &dy);
+    uint32_t dt = time - gesture_pad.last_time;
+    gesture_pad.last_time = time;
+    gesture_pad.samples.push({dt, float(dx), float(dy)});
+    gesture_pad.sum_x += dx;
+    gesture_pad.sum_y += dy;
+
+    SwipeGesture &g = gesture_pad.current;
+    float speed = std::hypot(dx, dy) / std::max<uint32_t>(dt, 1);
+    g.duration += dt;
+    g.peak_speed = std::max(g.peak_speed, speed);
+    g.end_speed = g.events ? 0.7f * g.end_speed + 0.3f * speed : speed;
+    g.distance = std::max(std::abs(gesture_pad.sum_x),
+                          std::abs(gesture_pad.sum_y));
+    ++g.events;
+    break;
+  }
+  case GDK_TOUCHPAD_GESTURE_PHASE_END:
+    if (gesture_pad.in_gesture && gesture_pad.current.events > 0)
+      gesture_pad.gestures.push(gesture_pad.current);
+    gesture_pad.in_gesture = false;
+    break;
+  default:
+    drop_gesture_pad_current();
+    break;
+  }
+  schedule_gesture_pad_update();
+  return TRUE;
+}
+
+// Recommends a distance that the user's typical swipe just completes, and
+// a cancel ratio their short swipes still clear.
+static void update_gesture_pad_stats() {
+  std::array<float, 16> distances;
+  size_t n = 0;
+  for (size_t i = 0; i < gesture_pad.gestures.size(); ++i) {
+    const SwipeGesture &g = gesture_pad.gestures[i];
+    if (!g.pinch)
+      distances[n++] = g.distance;
+  }
+  std::sort(distances.begin(), distances.begin() + n);
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(0);
+  gesture_pad.suggested_distance = NAN;
+  gesture_pad.suggested_ratio = NAN;
+  if (gesture_pad.gestures.size() == 0) {
+    oss << (gesture_pad.recording
+                ? "Swipe across the touchpad like you switch workspaces"
+                : "Start recording, then swipe with your workspace fingers");
+  } else {
+    const SwipeGesture &last =
+        gesture_pad.gestures[gesture_pad.gestures.size() - 1];
+    oss << int(last.fingers) << "-finger "
+        << (last.pinch ? "pinch" : "swipe") << ": " << last.distance
+        << " px in " << last.duration << " ms · peak "
+        << std::setprecision(1) << last.peak_speed << " px/ms, release "
+        << last.end_speed << " px/ms";
+  }
+  if (n >= 3) {
+    double median = distances[n / 2];
+    double short_swipe = distances[n / 5];
+    gesture_pad.suggested_distance =
+        std::clamp(std::round(median * 0.9 / 10) * 10, 100.0, 500.0);
+    gesture_pad.suggested_ratio = std::clamp(
+        0.9 * short_swipe / gesture_pad.suggested_distance, 0.1, 0.9);
+    oss << "\n" << n << " swipes, median " << std::setprecision(0) << median
+        << " px · Suggested distance " << gesture_pad.suggested_distance
+        << ", cancel ratio " << std::setprecision(2)
+        << gesture_pad.suggested_ratio;
+  } else if (n > 0) {
+    oss << "\nSwipe " << 3 - n << " more times for a suggestion";
+  }
+  gtk_label_set_text(GTK_LABEL(gesture_pad.label), oss.str().c_str());
+  gtk_widget_set_sensitive(gesture_pad.apply_button,
+                           !std::isnan(gesture_pad.suggested_distance));
+}
+
+static gboolean on_gesture_pad_tick(GtkWidget *widget, GdkFrameClock *,
+                                    gpointer) {
+  gesture_pad.tick_id = 0;
+  update_gesture_pad_stats();
+  gtk_widget_queue_draw(widget);
+  return G_SOURCE_REMOVE;
+}
+
+// Left: displacement over time of the latest gesture. Right: one bar per
+// recorded swipe against the suggested distance and cancel threshold.
+static void draw_gesture_pad(GtkDrawingArea *area, cairo_t *cr, int width,
+                             int height, gpointer) {
+  GdkRGBA color;
+  gtk_widget_get_color(GTK_WIDGET(area), &color);
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.06);
+  cairo_rectangle(cr, 0, 0, width, height);
+  cairo_fill(cr);
+
+  size_t gestures = gesture_pad.gestures.size();
+  if (gestures == 0 && !gesture_pad.in_gesture) {
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.5);
+    cairo_move_to(cr, 12, height / 2.0);
+    cairo_show_text(cr, "Swipe here with three or four fingers");
+    return;
+  }
+
+  double scale = 500;
+  for (size_t i = 0; i < gestures; ++i)
+    scale = std::max<double>(scale, gesture_pad.gestures[i].distance);
+  double half = width / 2.0;
+  double plot_h = height - 16;
+
+  // The newest gesture's samples are the tail of the sample ring.
+  uint32_t events = gesture_pad.in_gesture
+                        ? gesture_pad.current.events
+                    : gestures ? gesture_pad.gestures[gestures - 1].events
+                               : 0;
+  size_t count = std::min<size_t>(events, gesture_pad.samples.size());
+  size_t first = gesture_pad.samples.size() - count;
+  double duration = 0;
+  for (size_t i = first; i < gesture_pad.samples.size(); ++i)
+    duration += gesture_pad.samples[i].dt;
+  if (count > 0 && duration > 0) {
+    double t = 0, x = 0, y = 0;
+    cairo_set_source_rgba(cr, 0.2, 0.5, 0.9, 0.9);
+    cairo_set_line_width(cr, 2);
+    cairo_move_to(cr, 8, 8 + plot_h);
+    for (size_t i = first; i < gesture_pad.samples.size(); ++i) {
+      const SwipeSample &s = gesture_pad.samples[i];
+      t += s.dt;
+      x += s.dx;
+      y += s.dy;
+      double d = std::max(std::abs(x), std::abs(y));
+      cairo_line_to(cr, 8 + (half - 16) * t / duration,
+                    8 + plot_h * (1 - std::min(d / scale, 1.0)));
+    }
+    cairo_stroke(cr);
+  }
+
+  double bar_w = (half - 16) / 16;
+  for (size_t i = 0; i < gestures; ++i) {
+    const SwipeGesture &g = gesture_pad.gestures[i];
+    double h = plot_h * g.distance / scale;
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue,
+                          g.pinch ? 0.2 : 0.6);
+    cairo_rectangle(cr, half + 8 + i * bar_w + 1, 8 + plot_h - h, bar_w - 2,
+                    h);
+    cairo_fill(cr);
+  }
+  if (!std::isnan(gesture_pad.suggested_distance)) {
+    double d = gesture_pad.suggested_distance;
+    for (double level : {d, d * gesture_pad.suggested_ratio}) {
+      double y = 8 + plot_h * (1 - level / scale);
+      cairo_set_source_rgba(cr, 0.9, 0.4, 0.2, level == d ? 0.9 : 0.5);
+      cairo_set_line_width(cr, 1);
+      cairo_move_to(cr, half + 8, y);
+      cairo_line_to(cr, width - 8, y);
+      cairo_stroke(cr);
+    }
+  }
+}
+
+// Hyprland consumes workspace swipes itself, so they only reach the pad
+// while workspace_swipe is off. The switch is restored when recording ends.
+static void set_gesture_pad_recording(bool recording) {
+  if (recording == gesture_pad.recording)
+    return;
+  gesture_pad.recording = recording;
+  if (recording) {
+    gesture_pad.swipe_was_enabled =
+        get_bool_option("gestures:workspace_swipe", true);
+    if (gesture_pad.swipe_was_enabled)
+      dispatch_hyprctl("keyword gestures:workspace_swipe false");
+  } else {
+    drop_gesture_pad_current();
+    if (gesture_pad.swipe_was_enabled)
+      dispatch_hyprctl("keyword gestures:workspace_swipe true");
+  }
+  gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(gesture_pad.record_button),
+                               recording);
+  schedule_gesture_pad_update();
+}
+
+static void on_gesture_pad_record_toggled(GtkToggleButton *button, gpointer) {
+  set_gesture_pad_recording(gtk_toggle_button_get_active(button));
+}
+
+// Unmapping may mean the window is closing, and queued writes would die
+// with the process, so the switch is put back before returning.
+static void on_gesture_pad_unmap(GtkWidget *, gpointer) {
+  if (gesture_pad.recording && gesture_pad.swipe_was_enabled) {
+    for (HyprInstance *instance : target_hypr_instances())
+      hypr_socket_request_at(instance->dir,
+                             "keyword gestures:workspace_swipe true");
+    gesture_pad.swipe_was_enabled = false;
+  }
+  set_gesture_pad_recording(false);
+}
+
+static void on_gesture_pad_reset(GtkButton *, gpointer) {
+  gesture_pad.samples.clear();
+  gesture_pad.gestures.clear();
+  gesture_pad.current = {};
+  gesture_pad.in_gesture = false;
+  schedule_gesture_pad_update();
+}
+
+static void on_gesture_pad_apply(GtkButton *, gpointer) {
+  if (std::isnan(gesture_pad.suggested_distance))
+    return;
+  set_gesture_pad_recording(false);
+  gtk_range_set_value(GTK_RANGE(gesture_pad.distance_scale),
+                      gesture_pad.suggested_distance);
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2) << gesture_pad.suggested_ratio;
+  execute_hyprctl("gestures:workspace_swipe_cancel_ratio " + oss.str());
+  on_gesture_pad_reset(nullptr, nullptr);
+}
+
+static GtkWidget *create_gesture_pad_group(GtkWidget *distance_scale) {
+  gesture_pad.distance_scale = distance_scale;
+
+  GtkWidget *group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(group),
+                                  "Swipe Test");
+  adw_preferences_group_set_description(
+      ADW_PREFERENCES_GROUP(group),
+      "Record a few workspace swipes to tune distance and cancel ratio. "
+      "Workspace swiping is paused while recording.");
+
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+
+  gesture_pad.area = gtk_drawing_area_new();
+  gtk_widget_set_size_request(gesture_pad.area, -1, 140);
+  gtk_widget_add_css_class(gesture_pad.area, "card");
+  gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(gesture_pad.area),
+                                 draw_gesture_pad, nullptr, nullptr);
+  GtkEventController *events = gtk_event_controller_legacy_new();
+  g_signal_connect(events, "event", G_CALLBACK(on_gesture_pad_event),
+                   nullptr);
+  gtk_widget_add_controller(gesture_pad.area, events);
+  g_signal_connect(gesture_pad.area, "unmap",
+                   G_CALLBACK(on_gesture_pad_unmap), nullptr);
+  gtk_box_append(GTK_BOX(box), gesture_pad.area);
+
+  GtkWidget *footer = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+  gesture_pad.label = gtk_label_new(nullptr);
+  gtk_label_set_xalign(GTK_LABEL(gesture_pad.label), 0);
+  gtk_label_set_wrap(GTK_LABEL(gesture_pad.label), TRUE);
+  gtk_widget_set_hexpand(gesture_pad.label, TRUE);
+  gtk_widget_add_css_class(gesture_pad.label, "dim-label");
+  gtk_box_append(GTK_BOX(footer), gesture_pad.label);
+
+  gesture_pad.record_button = gtk_toggle_button_new_with_label("Record");
+  gtk_widget_set_valign(gesture_pad.record_button, GTK_ALIGN_CENTER);
+  g_signal_connect(gesture_pad.record_button, "toggled",
+                   G_CALLBACK(on_gesture_pad_record_toggled), nullptr);
+  gtk_box_append(GTK_BOX(footer), gesture_pad.record_button);
+
+  GtkWidget *reset_button = gtk_button_new_with_label("Reset");
+  gtk_widget_set_valign(reset_button, GTK_ALIGN_CENTER);
+  g_signal_connect(reset_button, "clicked", G_CALLBACK(on_gesture_pad_reset),
+                   nullptr);
+  gtk_box_append(GTK_BOX(footer), reset_button);
+
+  gesture_pad.apply_button = gtk_button_new_with_label("Apply Suggestion");
+  gtk_widget_add_css_class(gesture_pad.apply_button, "suggested-action");
+  gtk_widget_set_valign(gesture_pad.apply_button, GTK_ALIGN_CENTER);
+  g_signal_connect(gesture_pad.apply_button, "clicked",
+                   G_CALLBACK(on_gesture_pad_apply), nullptr);
+  gtk_box_append(GTK_BOX(footer), gesture_pad.apply_button);
+  gtk_box_append(GTK_BOX(box), footer);
+
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), box);
+  update_gesture_pad_stats();
+  return group;
+}
+
+struct CursorTheme {
+  std::string name;
+  std::string path;
+  bool xcursor = false;
+  bool hyprcursor = false;
+  // The cursor file the thumbnail is decoded from; its mtime keys the
+  // thumbnail cache, so a cursor rewritten in place is decoded again.
+  std::string source;
+  int64_t mtime = 0;
+};
+
+struct CursorThumbnail {
+  int width = 0;
+  int height = 0;
+  GBytes *pixels = nullptr;
+};
+
+struct CursorPicker {
+  std::vector<CursorTheme> themes;
+  std::unordered_map<std::string, size_t> theme_index;
+  std::unordered_map<std::string, GdkTexture *> thumbnails;
+  std::unordered_map<std::string, bool> pending;
+  std::unordered_map<std::string, GtkWidget *> bound_pictures;
+  GtkStringList *model = nullptr;
+  GtkWidget *dialog = nullptr;
+  GtkWidget *size_spin = nullptr;
+  GtkWidget *theme_row = nullptr;
+  bool scanned = false;
+};
+
+static CursorPicker cursor_picker;
+
+static std::vector<std::string> icon_search_dirs() {
+  std::vector<std::string> dirs;
+  dirs.push_back(std::string(g_get_home_dir()) + "/.icons");
+  dirs.push_back(std::string(g_get_user_data_dir()) + "/icons");
+  for (const char *const *dir = g_get_system_data_dirs(); *dir; ++dir)
+    dirs.push_back(std::string(*dir) + "/icons");
+  return dirs;
+}
+
+static int64_t file_mtime(const std::string &path) {
+  GStatBuf st;
+  if (g_stat(path.c_str(), &st) != 0)
+    return 0;
+  return st.st_mtime;
+}
+
+// The directory a hyprcursor manifest keeps its .hlc shapes in, from its
+// "cursors_directory = ..." line (quoted in manifest.toml).
+static std::string hyprcursor_directory(const std::string &manifest) {
+  gchar *contents = nullptr;
+  if (!g_file_get_contents(manifest.c_str(), &contents, nullptr, nullptr))
+    return "";
+  std::string directory;
+  std::istringstream lines(contents);
+  g_free(contents);
+  std::string line;
+  while (std::getline(lines, line)) {
+    size_t equals = line.find('=');
+    if (equals == std::string::npos)
+      continue;
+    g_autofree char *key = g_strdup(line.substr(0, equals).c_str());
+    if (std::strcmp(g_strstrip(key), "cursors_directory") != 0)
+      continue;
+    g_autofree char *value =
+        g_strstrip(g_strdup(line.substr(equals + 1).c_str()));
+    directory = value;
+    if (directory.size() >= 2 && directory.front() == '"' &&
+        directory.back() == '"')
+      directory = directory.substr(1, directory.size() - 2);
+    break;
+  }
+  return directory;
+}
+
+static std::string cursor_thumbnail_source(const CursorTheme &theme,
+                                           const std::string &manifest) {
+  static const char *const shapes[] = {"left_ptr", "default", "arrow"};
+  if (theme.xcursor) {
+    for (const char *shape : shapes) {
+      std::string path = theme.path + "/cursors/" + shape;
+      if (g_file_test(path.c_str(), G_FILE_TEST_EXISTS))
+        return path;
+    }
+  }
+  if (theme.hyprcursor) {
+    std::string directory = hyprcursor_directory(manifest);
+    if (directory.empty())
+      return "";
+    for (const char *shape : shapes) {
+      std::string path =
+          theme.path + "/" + directory + "/" + shape + ".hlc";
+      if (g_file_test(path.c_str(), G_FILE_TEST_EXISTS))
+        return path;
+    }
+  }
+  return "";
+}
+
+static std::vector<CursorTheme> scan_cursor_themes() {
+  std::vector<CursorTheme> themes;
+  std::unordered_map<std::string, bool> seen;
+  for (const auto &base : icon_search_dirs()) {
+    GDir *dir = g_dir_open(base.c_str(), 0, nullptr);
+    if (!dir)
+      continue;
+    while (const char *entry = g_dir_read_name(dir)) {
+      if (seen.count(entry))
+        continue;
+      CursorTheme theme;
+      theme.name = entry;
+      theme.path = base + "/" + entry;
+      std::string cursors = theme.path + "/cursors";
+      // hyprcursor accepts either manifest format.
+      std::string manifest = theme.path + "/manifest.hl";
+      if (!g_file_test(manifest.c_str(), G_FILE_TEST_EXISTS))
+        manifest = theme.path + "/manifest.toml";
+      theme.xcursor = g_file_test(cursors.c_str(), G_FILE_TEST_IS_DIR);
+      theme.hyprcursor = g_file_test(manifest.c_str(), G_FILE_TEST_EXISTS);
+      if (!theme.xcursor && !theme.hyprcursor)
+        continue;
+      theme.source = cursor_thumbnail_source(theme, manifest);
+      theme.mtime = file_mtime(!theme.source.empty() ? theme.source
+                               : theme.xcursor       ? cursors
+                                                     : manifest);
+      seen[theme.name] = true;
+      themes.push_back(std::move(theme));
+    }
+    g_dir_close(dir);
+  }
+  std::sort(themes.begin(), themes.end(),
+            [](const CursorTheme &a, const CursorTheme &b) {
+              return g_utf8_collate(a.name.c_str(), b.name.c_str()) < 0;
+            });
+  return themes;
+}
+
+static uint32_t read_le32(const guint8 *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// Picks the image closest to 32px from an XCursor file. Pixels are
+// premultiplied ARGB in native order, which is what GDK_MEMORY_DEFAULT
+// expects.
+static CursorThumbnail decode_xcursor(const std::string &path) {
+  CursorThumbnail thumbnail;
+  gchar *contents = nullptr;
+  gsize length = 0;
+  if (!g_file_get_contents(path.c_str(), &contents, &length, nullptr))
+    return thumbnail;
+
+  const guint8 *data = reinterpret_cast<const guint8 *>(contents);
+  if (length < 16 || std::memcmp(data, "Xcur", 4) != 0) {
+    g_free(contents);
+    return thumbnail;
+  }
+
+  uint32_t ntoc = read_le32(data + 12);
+  uint32_t best_position = 0;
+  uint32_t best_distance = UINT32_MAX;
+  for (uint32_t i = 0; i < ntoc && 16 + (i + 1) * 12 <= length; ++i) {
+    const guint8 *toc = data + 16 + i * 12;
+    if (read_le32(toc) != 0xfffd0002)
+      continue;
+    uint32_t size = read_le32(toc + 4);
+    uint32_t distance = size > 32 ? size - 32 : 32 - size;
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_position = read_le32(toc + 8);
+    }
+  }
+
+  // Positions come from the file, so bounds are checked in 64 bits where a
+  // bogus offset cannot wrap around.
+  if (best_position > 0 && uint64_t(best_position) + 36 <= length) {
+    const guint8 *chunk = data + best_position;
+    uint32_t width = read_le32(chunk + 16);
+    uint32_t height = read_le32(chunk + 20);
+    if (width > 0 && height > 0 && width <= 256 && height <= 256 &&
+        uint64_t(best_position) + 36 + uint64_t(width) * height * 4 <=
+            length) {
+      std::vector<guint8> pixels(width * height * 4);
+      for (uint32_t i = 0; i < width * height; ++i) {
+        uint32_t argb = read_le32(chunk + 36 + i * 4);
+        std::memcpy(pixels.data() + i * 4, &argb, 4);
+      }
+      thumbnail.width = width;
+      thumbnail.height = height;
+      thumbnail.pixels = g_bytes_new(pixels.data(), pixels.size());
+    }
+  }
+  g_free(contents);
+  return thumbnail;
+}
+
+static uint16_t read_le16(const guint8 *data) {
+  return data[0] | (data[1] << 8);
+}
+
+struct ZipEntry {
+  std::string name;
+  uint16_t method;
+  uint32_t compressed_size;
+  uint32_t size;
+  uint32_t offset;
+};
+
+// Lists a zip archive from its central directory. Offsets are checked
+// against the buffer in 64 bits, since they come from the file.
+static std::vector<ZipEntry> read_zip_entries(const guint8 *data,
+                                              gsize length) {
+  std::vector<ZipEntry> entries;
+  if (length < 22)
+    return entries;
+  // The end record sits at the end, before a comment of up to 64 KiB.
+  uint64_t end = length - 22;
+  while (read_le32(data + end) != 0x06054b50) {
+    if (end == 0 || length - end > 22 + 0xffff)
+      return entries;
+    --end;
+  }
+  uint16_t count = read_le16(data + end + 10);
+  uint64_t position = read_le32(data + end + 16);
+  for (uint16_t i = 0; i < count; ++i) {
+    if (position + 46 > length || read_le32(data + position) != 0x02014b50)
+      break;
+    const guint8 *header = data + position;
+    uint16_t name_length = read_le16(header + 28);
+    uint64_t next = position + 46 + name_length + read_le16(header + 30) +
+                    read_le16(header + 32);
+    if (next > length)
+      break;
+    entries.push_back(
+        {std::string(reinterpret_cast<const char *>(header + 46),
+                     name_length),
+         read_le16(header + 10), read_le32(header + 20),
+         read_le32(header + 24), read_le32(header + 42)});
+    position = next;
+  }
+  return entries;
+}
+
+// Returns a stored or deflated entry's contents, or nothing.
+static std::vector<guint8> read_zip_entry(const guint8 *data, gsize length,
+                                          const ZipEntry &entry) {
+  std::vector<guint8> contents;
+  uint64_t header = entry.offset;
+  if (header + 30 > length || read_le32(data + header) != 0x04034b50 ||
+      entry.size > (16 << 20))
+    return contents;
+  uint64_t start = header + 30 + read_le16(data + header + 26) +
+                   read_le16(data + header + 28);
+  if (start + entry.compressed_size > length)
+    return contents;
+
+  if (entry.method == 0 && entry.compressed_size == entry.size) {
+    contents.assign(data + start, data + start + entry.size);
+  } else if (entry.method == 8) {
+    GInputStream *raw = g_memory_input_stream_new_from_data(
+        data + start, entry.compressed_size, nullptr);
+    GZlibDecompressor *inflater =
+        g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW);
+    GInputStream *stream =
+        g_converter_input_stream_new(raw, G_CONVERTER(inflater));
+    contents.resize(entry.size);
+    gsize read = 0;
+    if (!g_input_stream_read_all(stream, contents.data(), contents.size(),
+                                 &read, nullptr, nullptr) ||
+        read != contents.size())
+      contents.clear();
+    g_object_unref(stream);
+    g_object_unref(inflater);
+    g_object_unref(raw);
+  }
+  return contents;
+}
+
+// Picks the PNG closest to 32px from a hyprcursor .hlc archive, using the
+// sizes its meta.hl declares ("define_size = 32, left_ptr.png"). Shapes
+// drawn as SVG have no pixels to show and give no thumbnail.
+static CursorThumbnail decode_hyprcursor(const std::string &path) {
+  CursorThumbnail thumbnail;
+  gchar *contents = nullptr;
+  gsize length = 0;
+  if (!g_file_get_contents(path.c_str(), &contents, &length, nullptr))
+    return thumbnail;
+  const guint8 *data = reinterpret_cast<const guint8 *>(contents);
+  std::vector<ZipEntry> entries = read_zip_entries(data, length);
+
+  auto is_png = [](const std::string &name) {
+    return g_str_has_suffix(name.c_str(), ".png");
+  };
+  std::string image;
+  int best_distance = G_MAXINT;
+  for (const auto &entry : entries) {
+    if (entry.name != "meta.hl")
+      continue;
+    std::vector<guint8> meta = read_zip_entry(data, length, entry);
+    std::istringstream lines(std::string(meta.begin(), meta.end()));
+    std::string line;
+    while (std::getline(lines, line)) {
+      if (line.rfind("define_size", 0) != 0)
+        continue;
+      g_auto(GStrv) fields =
+          g_strsplit(line.substr(line.find('=') + 1).c_str(), ",", -1);
+      if (!fields[0] || !fields[1])
+        continue;
+      int distance = std::abs(std::atoi(fields[0]) - 32);
+      std::string file = g_strstrip(fields[1]);
+      if (is_png(file) && distance < best_distance) {
+        best_distance = distance;
+        image = file;
+      }
+    }
+  }
+
+  for (const auto &entry : entries) {
+    if (image.empty() ? !is_png(entry.name) : entry.name != image)
+      continue;
+    std::vector<guint8> png = read_zip_entry(data, length, entry);
+    GBytes *bytes = g_bytes_new(png.data(), png.size());
+    GdkTexture *texture = gdk_texture_new_from_bytes(bytes, nullptr);
+    g_bytes_unref(bytes);
+    if (!texture)
+      break;
+    int width = gdk_texture_get_width(texture);
+    int height = gdk_texture_get_height(texture);
+    if (width > 0 && height > 0 && width <= 256 && height <= 256) {
+      std::vector<guint8> pixels(size_t(width) * height * 4);
+      gdk_texture_download(texture, pixels.data(), width * 4);
+      thumbnail.width = width;
+      thumbnail.height = height;
+      thumbnail.pixels = g_bytes_new(pixels.data(), pixels.size());
+    }
+    g_object_unref(texture);
+    break;
+  }
+  g_free(contents);
+  return thumbnail;
+}
+
+static std::string cursor_thumbnail_cache_path(const CursorTheme &theme) {
+  uint64_t hash = 1469598103934665603ULL;
+  for (unsigned char c : theme.path)
+    hash = (hash ^ c) * 1099511628211ULL;
+  char name[64];
+  g_snprintf(name, sizeof(name), "%016" G_GINT64_MODIFIER "x-%" G_GINT64_FORMAT
+             ".argb", static_cast<guint64>(hash), theme.mtime);
+  return std::string(g_get_user_cache_dir()) +
+         "/hypr-control/cursor-thumbnails/" + name;
+}
+
+static CursorThumbnail load_cursor_thumbnail(const CursorTheme &theme) {
+  CursorThumbnail thumbnail;
+  std::string cache_path = cursor_thumbnail_cache_path(theme);
+
+  gchar *contents = nullptr;
+  gsize length = 0;
+  if (g_file_get_contents(cache_path.c_str(), &contents, &length, nullptr)) {
+    const guint8 *data = reinterpret_cast<const guint8 *>(contents);
+    if (length >= 12 && std::memcmp(data, "HCT1", 4) == 0) {
+      uint32_t width = read_le32(data + 4);
+      uint32_t height = read_le32(data + 8);
+      if (static_cast<uint64_t>(width) * height * 4 == length - 12) {
+        thumbnail.width = width;
+        thumbnail.height = height;
+        thumbnail.pixels = g_bytes_new(data + 12, length - 12);
+      }
+    }
+    g_free(contents);
+    if (thumbnail.pixels || length == 4)
+      return thumbnail;
+  }
+
+  if (g_str_has_suffix(theme.source.c_str(), ".hlc"))
+    thumbnail = decode_hyprcursor(theme.source);
+  else if (!theme.source.empty())
+    thumbnail = decode_xcursor(theme.source);
+
+  // A bare "HCT1" marks themes with nothing we can decode, such as SVG
+  // hyprcursor themes, so they are not rescanned on every launch.
+  std::string cached = "HCT1";
+  if (thumbnail.pixels) {
+    uint32_t header[2] = {
+        GUINT32_TO_LE(static_cast<guint32>(thumbnail.width)),
+        GUINT32_TO_LE(static_cast<guint32>(thumbnail.height))};
+    cached.append(reinterpret_cast<const char *>(header), sizeof(header));
+    gsize size = 0;
+    const char *pixels =
+        static_cast<const char *>(g_bytes_get_data(thumbnail.pixels, &size));
+    cached.append(pixels, size);
+  }
+  g_autofree char *dir = g_path_get_dirname(cache_path.c_str());
+  g_mkdir_with_parents(dir, 0755);
+  g_file_set_contents(cache_path.c_str(), cached.data(), cached.size(),
+                      nullptr);
+  return thumbnail;
+}
+
+static void set_cursor_picture(GtkWidget *picture, const std::string &name) {
+  auto it = cursor_picker.thumbnails.find(name);
+  if (it != cursor_picker.thumbnails.end() && it->second)
+    gtk_picture_set_paintable(GTK_PICTURE(picture), GDK_PAINTABLE(it->second));
+  else
+    gtk_picture_set_paintable(GTK_PICTURE(picture), nullptr);
+}
+
+static void request_cursor_thumbnail(const std::string &name) {
+  if (cursor_picker.thumbnails.count(name) || cursor_picker.pending.count(name))
+    return;
+  auto it = cursor_picker.theme_index.find(name);
+  if (it == cursor_picker.theme_index.end())
+    return;
+  cursor_picker.pending[name] = true;
+
+  CursorTheme theme = cursor_picker.themes[it->second];
+  worker_pool().submit([theme] {
+    CursorThumbnail thumbnail = load_cursor_thumbnail(theme);
+    run_on_main([name = theme.name, thumbnail] {
+      GdkTexture *texture = nullptr;
+      if (thumbnail.pixels) {
+        texture = gdk_memory_texture_new(thumbnail.width, thumbnail.height,
+                                         GDK_MEMORY_DEFAULT, thumbnail.pixels,
+                                         thumbnail.width * 4);
+        g_bytes_unref(thumbnail.pixels);
+      }
+      cursor_picker.pending.erase(name);
+      cursor_picker.thumbnails[name] = texture;
+      auto bound = cursor_picker.bound_pictures.find(name);
+      if (bound != cursor_picker.bound_pictures.end())
+        set_cursor_picture(bound->second, name);
+    });
+  });
+}
+
+static void on_cursor_item_setup(GtkSignalListItemFactory *, GObject *object,
+                                 gpointer) {
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+  gtk_widget_set_margin_start(box, 6);
+  gtk_widget_set_margin_end(box, 6);
+  gtk_widget_set_margin_top(box, 6);
+  gtk_widget_set_margin_bottom(box, 6);
+
+  GtkWidget *picture = gtk_picture_new();
+  gtk_widget_set_size_request(picture, 48, 48);
+  gtk_picture_set_content_fit(GTK_PICTURE(picture), GTK_CONTENT_FIT_SCALE_DOWN);
+  gtk_box_append(GTK_BOX(box), picture);
+
+  GtkWidget *label = gtk_label_new(nullptr);
+  gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_END);
+  gtk_label_set_max_width_chars(GTK_LABEL(label), 14);
+  gtk_widget_add_css_class(label, "caption");
+  gtk_box_append(GTK_BOX(box), label);
+
+  g_object_set_data(G_OBJECT(box), "picture", picture);
+  g_object_set_data(G_OBJECT(box), "label", label);
+  gtk_list_item_set_child(GTK_LIST_ITEM(object), box);
+}
+
+static void on_cursor_item_bind(GtkSignalListItemFactory *, GObject *object,
+                                gpointer) {
+  GtkListItem *list_item = GTK_LIST_ITEM(object);
+  GtkWidget *box = gtk_list_item_get_child(list_item);
+  const char *name = gtk_string_object_get_string(
+      GTK_STRING_OBJECT(gtk_list_item_get_item(list_item)));
+  GtkWidget *picture =
+      GTK_WIDGET(g_object_get_data(G_OBJECT(box), "picture"));
+
+  auto it = cursor_picker.theme_index.find(name);
+  std::string label = name;
+  if (it != cursor_picker.theme_index.end() &&
+      !cursor_picker.themes[it->second].xcursor)
+    label += " (hyprcursor)";
+  gtk_label_set_text(GTK_LABEL(g_object_get_data(G_OBJECT(box), "label")),
+                     label.c_str());
+
+  cursor_picker.bound_pictures[name] = picture;
+  set_cursor_picture(picture, name);
+  request_cursor_thumbnail(name);
+}
+
+static void on_cursor_item_unbind(GtkSignalListItemFactory *, GObject *object,
+                                  gpointer) {
+  GtkListItem *list_item = GTK_LIST_ITEM(object);
+  const char *name = gtk_string_object_get_string(
+      GTK_STRING_OBJECT(gtk_list_item_get_item(list_item)));
+  GtkWidget *box = gtk_list_item_get_child(list_item);
+  auto it = cursor_picker.bound_pictures.find(name);
+  if (it != cursor_picker.bound_pictures.end() &&
+      it->second == g_object_get_data(G_OBJECT(box), "picture"))
+    cursor_picker.bound_pictures.erase(it);
+}
+
+static std::string current_cursor_theme() {
+  const char *theme = std::getenv("HYPRCURSOR_THEME");
+  if (!theme || !*theme)
+    theme = std::getenv("XCURSOR_THEME");
+  return theme ? theme : "";
+}
+
+static void apply_cursor_theme(const std::string &name, int size) {
+  std::string size_str = std::to_string(size);
+  execute_hyprctl_batch({"setcursor " + name + " " + size_str,
+                         "keyword env XCURSOR_THEME," + name,
+                         "keyword env XCURSOR_SIZE," + size_str,
+                         "keyword env HYPRCURSOR_THEME," + name,
+                         "keyword env HYPRCURSOR_SIZE," + size_str});
+  g_setenv("XCURSOR_THEME", name.c_str(), TRUE);
+  g_setenv("HYPRCURSOR_THEME", name.c_str(), TRUE);
+  g_setenv("XCURSOR_SIZE", size_str.c_str(), TRUE);
+  if (cursor_picker.theme_row)
+    adw_action_row_set_subtitle(ADW_ACTION_ROW(cursor_picker.theme_row),
+                                name.c_str());
+}
+
+static void on_cursor_theme_activated(GtkGridView *view, guint position,
+                                      gpointer) {
+  GListModel *model = G_LIST_MODEL(gtk_grid_view_get_model(view));
+  GtkStringObject *item =
+      GTK_STRING_OBJECT(g_list_model_get_item(model, position));
+  if (!item)
+    return;
+  int size = gtk_spin_button_get_value_as_int(
+      GTK_SPIN_BUTTON(cursor_picker.size_spin));
+  apply_cursor_theme(gtk_string_object_get_string(item), size);
+  g_object_unref(item);
+  adw_dialog_close(ADW_DIALOG(cursor_picker.dialog));
+}
+
+static void populate_cursor_picker() {
+  std::vector<const char *> names;
+  names.reserve(cursor_picker.themes.size() + 1);
+  for (const auto &theme : cursor_picker.themes)
+    names.push_back(theme.name.c_str());
+  names.push_back(nullptr);
+  gtk_string_list_splice(
+      cursor_picker.model, 0,
+      g_list_model_get_n_items(G_LIST_MODEL(cursor_picker.model)),
+      names.data());
+}
+
+static void on_cursor_picker_closed(AdwDialog *, gpointer) {
+  cursor_picker.dialog = nullptr;
+  cursor_picker.model = nullptr;
+  cursor_picker.bound_pictures.clear();
+}
+
+static void on_cursor_theme_clicked(AdwActionRow *, gpointer) {
+  AdwDialog *dialog = adw_dialog_new();
+  adw_dialog_set_title(dialog, "Cursor Theme");
+  adw_dialog_set_content_width(dialog, 520);
+  adw_dialog_set_content_height(dialog, 520);
+  cursor_picker.dialog = GTK_WIDGET(dialog);
+
+  GtkWidget *toolbar_view = adw_toolbar_view_new();
+  GtkWidget *header = adw_header_bar_new();
+
+  const char *size_env = std::getenv("XCURSOR_SIZE");
+  cursor_picker.size_spin = gtk_spin_button_new_with_range(8, 128, 4);
+  gtk_spin_button_set_value(GTK_SPIN_BUTTON(cursor_picker.size_spin),
+                            size_env ? std::atoi(size_env) : 24);
+  gtk_widget_set_tooltip_text(cursor_picker.size_spin, "Cursor size");
+  adw_header_bar_pack_start(ADW_HEADER_BAR(header), cursor_picker.size_spin);
+  adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(toolbar_view), header);
+
+  cursor_picker.model = gtk_string_list_new(nullptr);
+  GtkListItemFactory *factory = gtk_signal_list_item_factory_new();
+  g_signal_connect(factory, "setup", G_CALLBACK(on_cursor_item_setup),
+                   nullptr);
+  g_signal_connect(factory, "bind", G_CALLBACK(on_cursor_item_bind), nullptr);
+  g_signal_connect(factory, "unbind", G_CALLBACK(on_cursor_item_unbind),
+                   nullptr);
+
+  GtkWidget *grid = gtk_grid_view_new(
+      GTK_SELECTION_MODEL(
+          gtk_single_selection_new(G_LIST_MODEL(cursor_picker.model))),
+      factory);
+  gtk_grid_view_set_max_columns(GTK_GRID_VIEW(grid), 6);
+  gtk_grid_view_set_single_click_activate(GTK_GRID_VIEW(grid), TRUE);
+  g_signal_connect(grid, "activate", G_CALLBACK(on_cursor_theme_activated),
+                   nullptr);
+
+  GtkWidget *scrolled = gtk_scrolled_window_new();
+  gtk_widget_set_vexpand(scrolled, TRUE);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), grid);
+  adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(toolbar_view), scrolled);
+  adw_dialog_set_child(dialog, toolbar_view);
+  g_signal_connect(dialog, "closed", G_CALLBACK(on_cursor_picker_closed),
+                   nullptr);
+  adw_dialog_present(dialog, main_window);
+
+  if (cursor_picker.scanned) {
+    populate_cursor_picker();
+    return;
+  }
+  worker_pool().submit([] {
+    std::vector<CursorTheme> themes = scan_cursor_themes();
+    run_on_main([themes = std::move(themes)]() mutable {
+      cursor_picker.themes = std::move(themes);
+      cursor_picker.theme_index.clear();
+      for (size_t i = 0; i < cursor_picker.themes.size(); ++i)
+        cursor_picker.theme_index[cursor_picker.themes[i].name] = i;
+      cursor_picker.scanned = true;
+      if (cursor_picker.model)
+        populate_cursor_picker();
+    });
+  });
+}
+
+static GtkWidget *accel_curve_group() { return accel_editor.group; }
+
+static GtkWidget *create_accel_curve_group(const std::string &profile) {
+  accel_editor.group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(accel_editor.group),
+                                  "Acceleration Curve");
+  adw_preferences_group_set_description(
+      ADW_PREFERENCES_GROUP(accel_editor.group),
+      "Drag the points to shape pointer speed against hand speed");
+
+  accel_editor.area = gtk_drawing_area_new();
+  gtk_widget_set_size_request(accel_editor.area, -1, 220);
+  gtk_widget_add_css_class(accel_editor.area, "card");
+  gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(accel_editor.area),
+                                 draw_accel_curve, nullptr, nullptr);
+
+  GtkGesture *drag = gtk_gesture_drag_new();
+  g_signal_connect(drag, "drag-begin", G_CALLBACK(on_accel_drag_begin),
+                   nullptr);
+  g_signal_connect(drag, "drag-update", G_CALLBACK(on_accel_drag_update),
+                   nullptr);
+  g_signal_connect(drag, "drag-end", G_CALLBACK(on_accel_drag_end), nullptr);
+  gtk_widget_add_controller(accel_editor.area, GTK_EVENT_CONTROLLER(drag));
+
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(accel_editor.group),
+                            accel_editor.area);
+  init_accel_curve(profile);
+  gtk_widget_set_visible(accel_editor.group, profile.rfind("custom", 0) == 0);
+  return accel_editor.group;
+}
+
+enum OptionBindingKind { BINDING_SWITCH, BINDING_RANGE, BINDING_COMBO };
+
+// Ties an option key to the control that shows it. Switches with values
+// use {off, on}; combos list the config value of each item, and an empty
+// entry stands for any value no other item matches.
+struct OptionBinding {
+  std::string key;
+  OptionBindingKind kind;
+  GtkWidget *control;
+  std::vector<std::string> values;
+  std::string snapshot;
+};
+
+static std::vector<OptionBinding> option_bindings;
+
+static void bind_option(const char *key, OptionBindingKind kind,
+                        GtkWidget *control,
+                        std::vector<std::string> values = {}) {
+  option_bindings.push_back({key, kind, control, std::move(values), ""});
+}
+
+static bool parse_config_bool(const std::string &value) {
+  return value == "true" || value == "yes" || value == "on" ||
+         std::atof(value.c_str()) != 0;
+}
+
+static void set_option_binding_value(const OptionBinding &binding,
+                                     const std::string &value) {
+  ++option_apply_suppressed;
+  switch (binding.kind) {
+  case BINDING_SWITCH:
+    adw_switch_row_set_active(ADW_SWITCH_ROW(binding.control),
+                              binding.values.empty()
+                                  ? parse_config_bool(value)
+                                  : value == binding.values[1]);
+    break;
+  case BINDING_RANGE:
+    gtk_range_set_value(GTK_RANGE(binding.control), std::atof(value.c_str()));
+    break;
+  case BINDING_COMBO: {
+    guint selected = GTK_INVALID_LIST_POSITION;
+    for (size_t i = 0; i < binding.values.size(); ++i) {
+      const std::string &item = binding.values[i];
+      if (item.empty() && selected == GTK_INVALID_LIST_POSITION)
+        selected = i;
+      else if (!item.empty() && value.rfind(item, 0) == 0)
+        selected = i;
+    }
+    if (selected != GTK_INVALID_LIST_POSITION)
+      adw_combo_row_set_selected(ADW_COMBO_ROW(binding.control), selected);
+    break;
+  }
+  }
+  --option_apply_suppressed;
+}
+
+static std::string option_binding_value(const OptionBinding &binding) {
+  switch (binding.kind) {
+  case BINDING_SWITCH: {
+    bool active = adw_switch_row_get_active(ADW_SWITCH_ROW(binding.control));
+    if (!binding.values.empty())
+      return binding.values[active ? 1 : 0];
+    return active ? "true" : "false";
+  }
+  case BINDING_RANGE: {
+    std::ostringstream oss;
+    oss << gtk_range_get_value(GTK_RANGE(binding.control));
+    return oss.str();
+  }
+  case BINDING_COMBO: {
+    guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(binding.control));
+    return selected < binding.values.size() ? binding.values[selected] : "";
+  }
+  }
+  return "";
+}
+
+struct StagedChange {
+  std::string key;
+  std::string value;
+  std::string old_value;
+};
+
+// Besides the bound controls, discarding restores the keyboard layout list,
+// the custom acceleration curve and the wheel factor the scroll pad
+// suggested against, as they were at the last snapshot.
+struct StagedChanges {
+  std::vector<StagedChange> changes;
+  std::vector<std::string> layouts;
+  std::unordered_map<std::string, std::string> variants;
+  std::vector<std::string> options;
+  std::array<float, accel_control_points> accel_x = {};
+  std::array<float, accel_control_points> accel_y = {};
+  float accel_step = 0;
+  double wheel_factor = 1;
+  // The layout switch bind a staged XKB toggle replaces; removed on apply.
+  std::string unbind;
+  bool reverting_toggle = false;
+  GtkWidget *mode_button = nullptr;
+  GtkWidget *revealer = nullptr;
+  GtkWidget *summary = nullptr;
+  GtkWidget *diff_list = nullptr;
+};
+
+static StagedChanges staged;
+
+static OptionBinding *find_option_binding(const std::string &key) {
+  for (auto &binding : option_bindings) {
+    if (binding.key == key)
+      return &binding;
+  }
+  return nullptr;
+}
+
+static void snapshot_option_bindings() {
+  for (auto &binding : option_bindings)
+    binding.snapshot = option_binding_value(binding);
+}
+
+static void snapshot_staged_state() {
+  snapshot_option_bindings();
+  staged.layouts = selected_layouts;
+  staged.variants = layout_variants;
+  staged.options = xkb_options;
+  staged.accel_x = accel_editor.x;
+  staged.accel_y = accel_editor.y;
+  staged.accel_step = accel_editor.step;
+  staged.wheel_factor = scroll_pad.wheel_factor;
+}
+
+static void restore_staged_state() {
+  bool keymap = false;
+  bool curve = false;
+  bool wheel = false;
+  for (const auto &change : staged.changes) {
+    if (OptionBinding *binding = find_option_binding(change.key))
+      set_option_binding_value(*binding, binding->snapshot);
+    keymap = keymap || change.key.rfind("input:kb_", 0) == 0;
+    curve = curve || change.key == "input:accel_profile";
+    wheel = wheel || change.key == "input:scroll_factor";
+  }
+
+  if (keymap) {
+    selected_layouts = staged.layouts;
+    layout_variants = staged.variants;
+    xkb_options = staged.options;
+    refresh_layouts_list();
+    if (layout_toggle_row) {
+      guint selected = 0;
+      for (size_t i = 0; i < xkb_toggle_options.size(); ++i) {
+        if (std::find(xkb_options.begin(), xkb_options.end(),
+                      xkb_toggle_options[i].first) != xkb_options.end())
+          selected = i + 1;
+      }
+      ++option_apply_suppressed;
+      adw_combo_row_set_selected(ADW_COMBO_ROW(layout_toggle_row), selected);
+      --option_apply_suppressed;
+    }
+  }
+
+  // A curve edit still waiting for its debounce would stage itself again.
+  if (accel_editor.push_source != 0) {
+    g_source_remove(accel_editor.push_source);
+    accel_editor.push_source = 0;
+    curve = true;
+  }
+  if (curve) {
+    accel_editor.x = staged.accel_x;
+    accel_editor.y = staged.accel_y;
+    accel_editor.step = staged.accel_step;
+    update_accel_curve();
+  }
+  if (wheel)
+    scroll_pad.wheel_factor = staged.wheel_factor;
+}
+
+static void refresh_staged_changes() {
+  if (!staged.revealer)
+    return;
+  size_t count = staged.changes.size();
+  gtk_revealer_set_reveal_child(GTK_REVEALER(staged.revealer), count > 0);
+  std::string summary = std::to_string(count) +
+                        (count == 1 ? " pending change" : " pending changes");
+  gtk_label_set_text(GTK_LABEL(staged.summary), summary.c_str());
+
+  GtkWidget *child;
+  while ((child = gtk_widget_get_first_child(staged.diff_list)))
+    gtk_list_box_remove(GTK_LIST_BOX(staged.diff_list), child);
+  for (const auto &change : staged.changes) {
+    const std::string &old_value = change.old_value;
+    std::string diff = (old_value.empty() ? "(default)" : old_value) + " → " +
+                       (change.value.empty() ? "(default)" : change.value);
+    GtkWidget *row = adw_action_row_new();
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), change.key.c_str());
+    adw_action_row_set_subtitle(ADW_ACTION_ROW(row), diff.c_str());
+    gtk_list_box_append(GTK_LIST_BOX(staged.diff_list), row);
+  }
+}
+
+// Called by execute_hyprctl in staged mode; "key value" goes into the change
+// set instead of being sent. Setting a key back to its snapshot drops it.
+static void stage_option_change(const std::string &command) {
+  size_t space = command.find(' ');
+  std::string key = command.substr(0, space);
+  std::string value =
+      space == std::string::npos ? "" : command.substr(space + 1);
+
+  auto it = std::find_if(staged.changes.begin(), staged.changes.end(),
+                         [&](const StagedChange &c) { return c.key == key; });
+  OptionBinding *binding = find_option_binding(key);
+  bool reverted =
+      binding && (value == binding->snapshot ||
+                  (binding->kind == BINDING_RANGE &&
+                   option_binding_value(*binding) == binding->snapshot));
+  if (reverted) {
+    if (it != staged.changes.end())
+      staged.changes.erase(it);
+  } else if (it != staged.changes.end()) {
+    it->value = value;
+  } else {
+    // Staged writes aren't sent, so the cache still holds the applied value.
+    staged.changes.push_back(
+        {key, value, binding ? binding->snapshot : option_value(key).s});
+  }
+  refresh_staged_changes();
+}
+
+static void apply_staged_changes() {
+  std::vector<std::string> commands;
+  for (const auto &change : staged.changes)
+    commands.push_back("keyword " + change.key + " " + change.value);
+  if (!commands.empty())
+    execute_hyprctl_batch(commands);
+  if (!staged.unbind.empty() &&
+      staged.unbind == current_layout_switch_bind) {
+    execute_hyprctl_bind("keyword unbind " + current_layout_switch_bind);
+    current_layout_switch_bind = "";
+    refresh_keybinds_list();
+  }
+  staged.unbind.clear();
+  staged.changes.clear();
+  snapshot_staged_state();
+  refresh_staged_changes();
+}
+
+static void discard_staged_changes() {
+  restore_staged_state();
+  staged.unbind.clear();
+  staged.changes.clear();
+  refresh_staged_changes();
+}
+
+static void on_apply_staged_clicked(GtkButton *, gpointer) {
+  apply_staged_changes();
+}
+
+static void on_discard_staged_clicked(GtkButton *, gpointer) {
+  discard_staged_changes();
+}
+
+static void set_staged_mode(bool active) {
+  if (active)
+    snapshot_staged_state();
+  staged_mode = active;
+  set_setting_bool("app", "staged", active);
+}
+
+static void on_leave_staged_response(AdwAlertDialog *, const char *response,
+                                     gpointer) {
+  if (std::strcmp(response, "apply") == 0) {
+    apply_staged_changes();
+  } else if (std::strcmp(response, "discard") == 0) {
+    discard_staged_changes();
+  } else {
+    staged.reverting_toggle = true;
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(staged.mode_button), TRUE);
+    staged.reverting_toggle = false;
+    return;
+  }
+  set_staged_mode(false);
+}
+
+// Turning staged mode off with changes pending asks what to do with them.
+static void on_staged_mode_toggled(GtkToggleButton *button, gpointer) {
+  if (staged.reverting_toggle)
+    return;
+  bool active = gtk_toggle_button_get_active(button);
+  if (active || staged.changes.empty()) {
+    set_staged_mode(active);
+    return;
+  }
+
+  std::string body = std::to_string(staged.changes.size()) +
+                     (staged.changes.size() == 1 ? " change has"
+                                                 : " changes have") +
+                     " not been applied yet.";
+  AdwDialog *dialog =
+      adw_alert_dialog_new("Apply Pending Changes?", body.c_str());
+  adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "cancel",
+                                 "Keep Staging", "discard", "Discard",
+                                 "apply", "Apply", nullptr);
+  adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog),
+                                           "discard",
+                                           ADW_RESPONSE_DESTRUCTIVE);
+  adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog), "apply",
+                                           ADW_RESPONSE_SUGGESTED);
+  adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "apply");
+  adw_alert_dialog_set_close_response(ADW_ALERT_DIALOG(dialog), "cancel");
+  g_signal_connect(dialog, "response", G_CALLBACK(on_leave_staged_response),
+                   nullptr);
+  adw_dialog_present(dialog, main_window);
+}
+
+static GtkWidget *create_staged_mode_button() {
+  GtkWidget *button = gtk_toggle_button_new();
+  staged.mode_button = button;
+  gtk_button_set_icon_name(GTK_BUTTON(button), "document-edit-symbolic");
+  gtk_widget_set_tooltip_text(button,
+                              "Collect changes and apply them together");
+  gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(button),
+                               get_setting_bool("app", "staged", false));
+  g_signal_connect(button, "toggled", G_CALLBACK(on_staged_mode_toggled),
+                   nullptr);
+  return button;
+}
+
+static GtkWidget *create_staged_changes_bar() {
+  GtkWidget *bar = gtk_action_bar_new();
+
+  staged.summary = gtk_label_new(nullptr);
+  gtk_action_bar_pack_start(GTK_ACTION_BAR(bar), staged.summary);
+
+  staged.diff_list = gtk_list_box_new();
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(staged.diff_list),
+                                  GTK_SELECTION_NONE);
+  gtk_widget_add_css_class(staged.diff_list, "boxed-list");
+  GtkWidget *scrolled = gtk_scrolled_window_new();
+  gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled),
+                                 GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_propagate_natural_height(
+      GTK_SCROLLED_WINDOW(scrolled), TRUE);
+  gtk_scrolled_window_set_max_content_height(GTK_SCROLLED_WINDOW(scrolled),
+                                             400);
+  gtk_widget_set_size_request(scrolled, 320, -1);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled),
+                                staged.diff_list);
+  GtkWidget *popover = gtk_popover_new();
+  gtk_popover_set_child(GTK_POPOVER(popover), scrolled);
+
+  GtkWidget *review = gtk_menu_button_new();
+  gtk_menu_button_set_label(GTK_MENU_BUTTON(review), "Review");
+  gtk_menu_button_set_popover(GTK_MENU_BUTTON(review), popover);
+  gtk_action_bar_pack_start(GTK_ACTION_BAR(bar), review);
+
+  GtkWidget *apply = gtk_button_new_with_label("Apply");
+  gtk_widget_add_css_class(apply, "suggested-action");
+  g_signal_connect(apply, "clicked", G_CALLBACK(on_apply_staged_clicked),
+                   nullptr);
+  gtk_action_bar_pack_end(GTK_ACTION_BAR(bar), apply);
+
+  GtkWidget *discard = gtk_button_new_with_label("Discard");
+  g_signal_connect(discard, "clicked", G_CALLBACK(on_discard_staged_clicked),
+                   nullptr);
+  gtk_action_bar_pack_end(GTK_ACTION_BAR(bar), discard);
+
+  staged.revealer = gtk_revealer_new();
+  gtk_revealer_set_transition_type(GTK_REVEALER(staged.revealer),
+                                   GTK_REVEALER_TRANSITION_TYPE_SLIDE_UP);
+  gtk_revealer_set_child(GTK_REVEALER(staged.revealer), bar);
+  return staged.revealer;
+}
+
+static std::string hyprland_config_path() {
+  return std::string(g_get_user_config_dir()) + "/hypr/hyprland.conf";
+}
+
+struct ConfigFile {
+  uint64_t hash = 0;
+  std::unordered_map<std::string, std::string> values;
+  std::vector<std::string> sources;
+};
+
+struct ConfigWatcher {
+  int fd = -1;
+  std::unordered_map<std::string, ConfigFile> files;
+  std::vector<std::string> order;
+  std::unordered_map<int, std::string> watch_dirs;
+  std::unordered_map<std::string, bool> dirty;
+  guint debounce_source = 0;
+  // Keys no file sets any more. Their controls follow the compositor, which
+  // only resets them once it has reloaded the config.
+  std::vector<std::string> unset_keys;
+  gint64 last_reload = 0;
+};
+
+static ConfigWatcher config_watcher;
+
+static uint64_t hash_bytes(const std::string &data) {
+  uint64_t hash = 1469598103934665603ULL;
+  for (unsigned char c : data)
+    hash = (hash ^ c) * 1099511628211ULL;
+  return hash;
+}
+
+static std::string trim(const std::string &text) {
+  size_t start = text.find_first_not_of(" \t\r");
+  if (start == std::string::npos)
+    return "";
+  size_t end = text.find_last_not_of(" \t\r");
+  return text.substr(start, end - start + 1);
+}
+
+static std::vector<std::string> resolve_config_source(const std::string &from,
+                                                      std::string pattern) {
+  if (pattern.rfind("~/", 0) == 0)
+    pattern = std::string(g_get_home_dir()) + pattern.substr(1);
+  if (!g_path_is_absolute(pattern.c_str())) {
+    g_autofree char *dir = g_path_get_dirname(from.c_str());
+    pattern = std::string(dir) + "/" + pattern;
+  }
+
+  std::vector<std::string> paths;
+  if (pattern.find_first_of("*?[") == std::string::npos) {
+    paths.push_back(pattern);
+    return paths;
+  }
+  g_autofree char *dir_name = g_path_get_dirname(pattern.c_str());
+  g_autofree char *base_name = g_path_get_basename(pattern.c_str());
+  GPatternSpec *spec = g_pattern_spec_new(base_name);
+  GDir *dir = g_dir_open(dir_name, 0, nullptr);
+  while (const char *entry = dir ? g_dir_read_name(dir) : nullptr) {
+    if (g_pattern_spec_match_string(spec, entry))
+      paths.push_back(std::string(dir_name) + "/" + entry);
+  }
+  if (dir)
+    g_dir_close(dir);
+  g_pattern_spec_free(spec);
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// Collects option assignments and source= lines. Device blocks are per
+// device, so their contents are skipped.
+static void parse_config_file(const std::string &path,
+                              const std::string &contents, ConfigFile &file) {
+  file.values.clear();
+  file.sources.clear();
+  std::vector<std::string> sections;
+  int device_depth = 0;
+
+  std::stringstream stream(contents);
+  std::string line;
+  while (std::getline(stream, line)) {
+    size_t comment = line.find('#');
+    while (comment != std::string::npos && comment + 1 < line.size() &&
+           line[comment + 1] == '#')
+      comment = line.find('#', comment + 2);
+    line = trim(line.substr(0, comment));
+    if (line.empty())
+      continue;
+    // "##" is an escaped "#" in values such as colors.
+    for (size_t escape = line.find("##"); escape != std::string::npos;
+         escape = line.find("##", escape + 1))
+      line.erase(escape, 1);
+
+    if (line == "}") {
+      if (!sections.empty())
+        sections.pop_back();
+      if (device_depth > 0)
+        --device_depth;
+      continue;
+    }
+    if (line.back() == '{') {
+      std::string name = trim(line.substr(0, line.size() - 1));
+      if (device_depth > 0 || name == "device" || name.rfind("device:", 0) == 0)
+        ++device_depth;
+      sections.push_back(name);
+      continue;
+    }
+
+    size_t equals = line.find('=');
+    if (equals == std::string::npos || device_depth > 0)
+      continue;
+    std::string key = trim(line.substr(0, equals));
+    std::string value = trim(line.substr(equals + 1));
+    if (key == "source" && sections.empty()) {
+      for (auto &source : resolve_config_source(path, value))
+        file.sources.push_back(source);
+      continue;
+    }
+
+    std::string full_key;
+    for (const auto &section : sections)
+      full_key += section + ":";
+    file.values[full_key + key] = value;
+  }
+}
+
+static void watch_config_dir(const std::string &path) {
+  g_autofree char *dir = g_path_get_dirname(path.c_str());
+  for (const auto &watch : config_watcher.watch_dirs) {
+    if (watch.second == dir)
+      return;
+  }
+  // Editors that save through a rename replace the file, so watch the
+  // directory rather than the file itself.
+  int wd = inotify_add_watch(config_watcher.fd, dir,
+                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+                                 IN_DELETE | IN_ATTRIB);
+  if (wd >= 0)
+    config_watcher.watch_dirs[wd] = dir;
+}
+
+static void collect_config_order(const std::string &path,
+                                 std::vector<std::string> &order) {
+  if (std::find(order.begin(), order.end(), path) != order.end())
+    return;
+  order.push_back(path);
+  auto it = config_watcher.files.find(path);
+  if (it == config_watcher.files.end())
+    return;
+  for (const auto &source : it->second.sources)
+    collect_config_order(source, order);
+}
+
+static std::string lookup_config_value(const std::string &key) {
+  std::string value;
+  for (const auto &path : config_watcher.order) {
+    auto file = config_watcher.files.find(path);
+    if (file == config_watcher.files.end())
+      continue;
+    auto it = file->second.values.find(key);
+    if (it != file->second.values.end())
+      value = it->second;
+  }
+  return value;
+}
+
+static std::string effective_config_value(const std::string &key) {
+  std::string value = lookup_config_value(key);
+  if (value.size() > 1 && value[0] == '$') {
+    std::string resolved = lookup_config_value(value);
+    if (!resolved.empty())
+      return resolved;
+  }
+  return value;
+}
+
+// Returns the keys whose value in this file changed, or nothing if the
+// content hash is unchanged.
+static std::vector<std::string> reload_config_file(const std::string &path) {
+  std::vector<std::string> changed;
+  std::string contents;
+  gchar *data = nullptr;
+  gsize length = 0;
+  if (g_file_get_contents(path.c_str(), &data, &length, nullptr)) {
+    contents.assign(data, length);
+    g_free(data);
+  }
+
+  ConfigFile &file = config_watcher.files[path];
+  uint64_t hash = hash_bytes(contents);
+  if (hash == file.hash && file.hash != 0)
+    return changed;
+  file.hash = hash;
+
+  std::unordered_map<std::string, std::string> old_values =
+      std::move(file.values);
+  parse_config_file(path, contents, file);
+  for (const auto &entry : file.values) {
+    auto old = old_values.find(entry.first);
+    if (old == old_values.end() || old->second != entry.second)
+      changed.push_back(entry.first);
+  }
+  for (const auto &entry : old_values) {
+    if (!file.values.count(entry.first))
+      changed.push_back(entry.first);
+  }
+
+  watch_config_dir(path);
+  for (const auto &source : file.sources) {
+    if (!config_watcher.files.count(source)) {
+      for (auto &key : reload_config_file(source))
+        changed.push_back(std::move(key));
+    }
+  }
+  return changed;
+}
+
+static void set_binding_from_config(OptionBinding &binding,
+                                    const std::string &value) {
+  bool pending = std::any_of(
+      staged.changes.begin(), staged.changes.end(),
+      [&](const StagedChange &c) { return c.key == binding.key; });
+  if (pending) {
+    binding.snapshot = value;
+    return;
+  }
+  set_option_binding_value(binding, value);
+  binding.snapshot = option_binding_value(binding);
+  // The combo shows "custom" before and after; the points live in the editor.
+  if (binding.key == "input:accel_profile" && value.rfind("custom", 0) == 0)
+    init_accel_curve(value);
+}
+
+static void sync_unset_config_keys() {
+  for (const auto &key : config_watcher.unset_keys) {
+    if (OptionBinding *binding = find_option_binding(key))
+      set_binding_from_config(*binding, option_value(key).s);
+  }
+  refresh_staged_changes();
+}
+
+static void reload_all_option_values();
+
+static void on_config_watcher_event(const std::string &event,
+                                    const std::string &) {
+  if (event != "configreloaded")
+    return;
+  config_watcher.last_reload = g_get_monotonic_time();
+  reload_all_option_values();
+  if (config_watcher.unset_keys.empty())
+    return;
+  sync_unset_config_keys();
+  config_watcher.unset_keys.clear();
+}
+
+static gboolean on_config_debounce(gpointer) {
+  config_watcher.debounce_source = 0;
+  std::vector<std::string> changed;
+  for (const auto &entry : config_watcher.dirty) {
+    for (auto &key : reload_config_file(entry.first))
+      changed.push_back(std::move(key));
+  }
+  config_watcher.dirty.clear();
+  if (changed.empty())
+    return G_SOURCE_REMOVE;
+
+  config_watcher.order.clear();
+  collect_config_order(hyprland_config_path(), config_watcher.order);
+
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  for (auto &binding : option_bindings) {
+    if (!std::binary_search(changed.begin(), changed.end(), binding.key))
+      continue;
+    std::string value = effective_config_value(binding.key);
+    auto &unset = config_watcher.unset_keys;
+    if (value.empty() &&
+        std::find(unset.begin(), unset.end(), binding.key) == unset.end())
+      unset.push_back(binding.key);
+    else if (!value.empty())
+      set_binding_from_config(binding, value);
+  }
+  // Hyprland's own autoreload usually lands before this debounce does. The
+  // keys stay listed in case it comes later, or only on a manual reload.
+  if (!config_watcher.unset_keys.empty() &&
+      g_get_monotonic_time() - config_watcher.last_reload < G_USEC_PER_SEC)
+    sync_unset_config_keys();
+  refresh_staged_changes();
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean on_config_inotify(gint fd, GIOCondition, gpointer) {
+  alignas(inotify_event) char buffer[4096];
+  ssize_t n = read(fd, buffer, sizeof(buffer));
+  for (ssize_t offset = 0; offset < n;) {
+    auto *event = reinterpret_cast<inotify_event *>(buffer + offset);
+    offset += sizeof(inotify_event) + event->len;
+    auto dir = config_watcher.watch_dirs.find(event->wd);
+    if (dir == config_watcher.watch_dirs.end() || event->len == 0)
+      continue;
+    std::string path = dir->second + "/" + event->name;
+    if (config_watcher.files.count(path))
+      config_watcher.dirty[path] = true;
+  }
+
+  // Saves arrive as bursts of write, rename and attribute events.
+  if (!config_watcher.dirty.empty()) {
+    if (config_watcher.debounce_source)
+      g_source_remove(config_watcher.debounce_source);
+    config_watcher.debounce_source =
+        g_timeout_add(200, on_config_debounce, nullptr);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static void start_config_watcher() {
+  config_watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (config_watcher.fd < 0)
+    return;
+  std::string root = hyprland_config_path();
+  reload_config_file(root);
+  collect_config_order(root, config_watcher.order);
+  g_unix_fd_add(config_watcher.fd, G_IO_IN, on_config_inotify, nullptr);
+}
+
+// Sets several options at once. The controls follow, and the writes go out
+// as one batch, or into the change set in staged mode.
+static void apply_option_values(const OptionValues &values) {
+  std::vector<std::string> commands;
+  for (const auto &value : values) {
+    if (OptionBinding *binding = find_option_binding(value.first))
+      set_option_binding_value(*binding, value.second);
+    if (staged_mode)
+      stage_option_change(value.first + " " + value.second);
+    else
+      commands.push_back("keyword " + value.first + " " + value.second);
+  }
+  if (!commands.empty())
+    execute_hyprctl_batch(commands);
+}
+
+// HYPR_CONTROL_SYSROOT points the hardware probe at a directory holding
+// proc/, sys/ and run/ snapshots instead of the live system.
+static std::string sysroot_path(const std::string &path) {
+  const char *root = std::getenv("HYPR_CONTROL_SYSROOT");
+  return root && *root ? root + path : path;
+}
+
+// Calls `line` for each line of `path` from a fixed buffer. Lines longer
+// than the buffer arrive in pieces; nothing the probe reads comes close.
+template <typename LineFn>
+static bool for_each_line(const std::string &path, LineFn line) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  std::array<char, 4096> buffer;
+  size_t used = 0;
+  ssize_t n;
+  while ((n = read(fd, buffer.data() + used, buffer.size() - used)) > 0) {
+    used += n;
+    size_t start = 0;
+    for (size_t i = 0; i < used; ++i) {
+      if (buffer[i] == '\n') {
+        line(std::string_view(buffer.data() + start, i - start));
+        start = i + 1;
+      }
+    }
+    if (start == 0 && used == buffer.size()) {
+      line(std::string_view(buffer.data(), used));
+      start = used;
+    }
+    std::memmove(buffer.data(), buffer.data() + start, used - start);
+    used -= start;
+  }
+  if (used > 0)
+    line(std::string_view(buffer.data(), used));
+  close(fd);
+  return true;
+}
+
+// A capability bitmap as the kernel prints it: hex longs, most significant
+// first.
+struct CapabilityBits {
+  std::array<unsigned long, 32> words = {};
+  size_t count = 0;
+
+  void parse(std::string_view text) {
+    count = 0;
+    unsigned long word = 0;
+    bool digits = false;
+    for (char c : text) {
+      int digit = g_ascii_xdigit_value(c);
+      if (digit >= 0) {
+        word = word * 16 + digit;
+        digits = true;
+      } else if (digits && count < words.size()) {
+        words[count++] = word;
+        word = 0;
+        digits = false;
+      }
+    }
+    if (digits && count < words.size())
+      words[count++] = word;
+  }
+
+  bool test(unsigned bit) const {
+    const unsigned bits = 8 * sizeof(unsigned long);
+    return bit / bits < count &&
+           (words[count - 1 - bit / bits] >> (bit % bits)) & 1;
+  }
+};
+
+enum InputDeviceClass {
+  DEVICE_OTHER,
+  DEVICE_MOUSE,
+  DEVICE_TRACKBALL,
+  DEVICE_TOUCHPAD,
+  DEVICE_CLICKPAD,
+  DEVICE_TOUCHSCREEN
+};
+
+struct ProbedDevice {
+  std::string name;
+  InputDeviceClass kind;
+  int dpi;
+  bool middle_button;
+};
+
+struct InputDeviceBlock {
+  std::string identity;
+  std::string name;
+  unsigned bus = 0;
+  int event = -1;
+  CapabilityBits prop, key, rel, abs;
+};
+
+// What input hardware is attached, read from /proc and sysfs without
+// asking the compositor. Classifications are cached by device identity,
+// so re-probing after a hotplug only looks up new devices in udev.
+struct InputHardware {
+  bool probed = false;
+  std::vector<ProbedDevice> devices;
+  std::unordered_map<std::string, ProbedDevice> cache;
+  GtkWidget *group = nullptr;
+  std::vector<GtkWidget *> rows;
+  std::vector<GtkWidget *> touchpad_widgets;
+  std::vector<GtkWidget *> touchscreen_widgets;
+};
+
+static InputHardware input_hardware;
+
+// udev keeps hwdb matches such as MOUSE_DPI in its database, keyed by the
+// device number sysfs reports for the event node.
+static void read_udev_hints(int event, ProbedDevice &device) {
+  std::string dev;
+  for_each_line(
+      sysroot_path("/sys/class/input/event" + std::to_string(event) + "/dev"),
+      [&](std::string_view line) { dev = std::string(line); });
+  if (dev.empty())
+    return;
+  for_each_line(sysroot_path("/run/udev/data/c" + dev), [&](std::string_view
+                                                                line) {
+    if (line == "E:ID_INPUT_TRACKBALL=1") {
+      device.kind = DEVICE_TRACKBALL;
+    } else if (line.rfind("E:MOUSE_DPI=", 0) == 0) {
+      // "400@125 *800@125 1600@125", the starred entry being the default.
+      std::string_view list = line.substr(12);
+      size_t star = list.find('*');
+      device.dpi = std::atoi(
+          std::string(list.substr(star == std::string_view::npos ? 0
+                                                                  : star + 1))
+              .c_str());
+    }
+  });
+}
+
+static ProbedDevice classify_input_device(const InputDeviceBlock &block) {
+  ProbedDevice device = {block.name, DEVICE_OTHER, 0,
+                         block.key.test(BTN_MIDDLE)};
+  bool absolute = block.abs.test(ABS_X) || block.abs.test(ABS_MT_POSITION_X);
+  bool pen = block.key.test(BTN_TOOL_PEN);
+  if (absolute && !pen && block.prop.test(INPUT_PROP_DIRECT) &&
+      block.key.test(BTN_TOUCH)) {
+    device.kind = DEVICE_TOUCHSCREEN;
+  } else if (absolute && !pen && block.key.test(BTN_TOOL_FINGER)) {
+    device.kind = block.prop.test(INPUT_PROP_BUTTONPAD) ? DEVICE_CLICKPAD
+                                                        : DEVICE_TOUCHPAD;
+  } else if (block.rel.test(REL_X) && block.rel.test(REL_Y) &&
+             block.key.test(BTN_LEFT) &&
+             !block.prop.test(INPUT_PROP_POINTING_STICK)) {
+    device.kind = DEVICE_MOUSE;
+    if (block.event >= 0)
+      read_udev_hints(block.event, device);
+    std::string lower = block.name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower.find("trackball") != std::string::npos)
+      device.kind = DEVICE_TRACKBALL;
+  }
+  return device;
+}
+
+static void probe_input_hardware() {
+  input_hardware.devices.clear();
+  InputDeviceBlock block;
+  auto finish = [&block] {
+    if (!block.identity.empty() && block.bus != BUS_VIRTUAL) {
+      std::string identity = block.identity + " " + block.name;
+      auto it = input_hardware.cache.find(identity);
+      if (it == input_hardware.cache.end())
+        it = input_hardware.cache
+                 .emplace(identity, classify_input_device(block))
+                 .first;
+      if (it->second.kind != DEVICE_OTHER)
+        input_hardware.devices.push_back(it->second);
+    }
+    block = InputDeviceBlock();
+  };
+
+  input_hardware.probed = for_each_line(
+      sysroot_path("/proc/bus/input/devices"), [&](std::string_view line) {
+        if (line.empty()) {
+          finish();
+          return;
+        }
+        if (line.size() < 3)
+          return;
+        std::string_view value = line.substr(3);
+        if (line[0] == 'I') {
+          block.identity = std::string(value);
+          size_t bus = value.find("Bus=");
+          if (bus != std::string_view::npos)
+            block.bus = std::strtoul(block.identity.c_str() + bus + 4,
+                                     nullptr, 16);
+        } else if (line[0] == 'N' && value.rfind("Name=\"", 0) == 0) {
+          block.name = std::string(value.substr(6, value.size() - 7));
+        } else if (line[0] == 'H') {
+          size_t event = value.find("event");
+          if (event != std::string_view::npos)
+            block.event = std::atoi(std::string(value.substr(event + 5))
+                                        .c_str());
+        } else if (line[0] == 'B') {
+          std::pair<const char *, CapabilityBits *> bitmaps[] = {
+              {"PROP=", &block.prop},
+              {"KEY=", &block.key},
+              {"REL=", &block.rel},
+              {"ABS=", &block.abs}};
+          for (const auto &bitmap : bitmaps) {
+            if (value.rfind(bitmap.first, 0) == 0)
+              bitmap.second->parse(value.substr(std::strlen(bitmap.first)));
+          }
+        }
+      });
+  finish();
+}
+
+static bool input_hardware_has(InputDeviceClass kind) {
+  return std::any_of(input_hardware.devices.begin(),
+                     input_hardware.devices.end(),
+                     [kind](const ProbedDevice &d) { return d.kind == kind; });
+}
+
+static std::string format_option_number(double value) {
+  std::ostringstream oss;
+  oss << value;
+  return oss.str();
+}
+
+// Starting values for a device, with the reason shown next to it.
+static OptionValues hardware_suggestions(const ProbedDevice &device,
+                                         std::string &reason) {
+  switch (device.kind) {
+  case DEVICE_MOUSE:
+    // libinput normalizes adaptive acceleration to 1000 DPI, but the flat
+    // profile passes high-resolution motion through unchanged.
+    if (device.dpi > 1000 &&
+        get_string_option("input:accel_profile") == "flat") {
+      reason = "Slows flat acceleration down to 1000 DPI speed";
+      return {{"input:sensitivity",
+               format_option_number(
+                   std::round(20 * (1000.0 / device.dpi - 1)) / 20)}};
+    }
+    return {};
+  case DEVICE_TRACKBALL:
+    reason = "Scroll by holding a button and rolling the ball";
+    return {{"input:scroll_method", "on_button_down"}};
+  case DEVICE_CLICKPAD:
+    reason = "Click with two fingers to right-click";
+    return {{"input:touchpad:clickfinger_behavior", "1"}};
+  case DEVICE_TOUCHPAD:
+    reason = device.middle_button
+                 ? "Use the physical buttons to click"
+                 : "Use the physical buttons; press both for middle click";
+    if (device.middle_button)
+      return {{"input:touchpad:clickfinger_behavior", "0"}};
+    return {{"input:touchpad:clickfinger_behavior", "0"},
+            {"input:touchpad:middle_button_emulation", "true"}};
+  default:
+    return {};
+  }
+}
+
+static bool option_values_pending(const OptionValues &values) {
+  for (const auto &value : values) {
+    OptionBinding *binding = find_option_binding(value.first);
+    if (!binding || option_binding_value(*binding) != value.second)
+      return true;
+  }
+  return false;
+}
+
+static std::string describe_input_device(const ProbedDevice &device) {
+  switch (device.kind) {
+  case DEVICE_MOUSE:
+    return device.dpi > 0 ? "Mouse, " + std::to_string(device.dpi) + " DPI"
+                          : "Mouse";
+  case DEVICE_TRACKBALL:
+    return "Trackball";
+  case DEVICE_CLICKPAD:
+    return "Clickpad";
+  case DEVICE_TOUCHPAD:
+    return "Touchpad with buttons";
+  case DEVICE_TOUCHSCREEN:
+    return "Touchscreen";
+  default:
+    return "Input device";
+  }
+}
+
+static void refresh_input_hardware_rows();
+
+static void on_hardware_suggestion_clicked(GtkButton *, gpointer user_data) {
+  size_t index = GPOINTER_TO_UINT(user_data);
+  if (index >= input_hardware.devices.size())
+    return;
+  std::string reason;
+  apply_option_values(
+      hardware_suggestions(input_hardware.devices[index], reason));
+  refresh_input_hardware_rows();
+}
+
+static void refresh_input_hardware_rows() {
+  for (GtkWidget *row : input_hardware.rows)
+    adw_preferences_group_remove(ADW_PREFERENCES_GROUP(input_hardware.group),
+                                 row);
+  input_hardware.rows.clear();
+
+  for (size_t i = 0; i < input_hardware.devices.size(); ++i) {
+    const ProbedDevice &device = input_hardware.devices[i];
+    std::string reason;
+    OptionValues suggestions = hardware_suggestions(device, reason);
+    bool pending = option_values_pending(suggestions);
+    std::string subtitle = describe_input_device(device);
+    if (pending)
+      subtitle += " · " + reason;
+
+    GtkWidget *row = adw_action_row_new();
+    adw_preferences_row_set_use_markup(ADW_PREFERENCES_ROW(row), FALSE);
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row),
+                                  device.name.c_str());
+    adw_action_row_set_subtitle(ADW_ACTION_ROW(row), subtitle.c_str());
+    if (pending) {
+      GtkWidget *button = gtk_button_new_with_label("Apply");
+      gtk_widget_set_valign(button, GTK_ALIGN_CENTER);
+      g_signal_connect(button, "clicked",
+                       G_CALLBACK(on_hardware_suggestion_clicked),
+                       GUINT_TO_POINTER(i));
+      adw_action_row_add_suffix(ADW_ACTION_ROW(row), button);
+    }
+    adw_preferences_group_add(ADW_PREFERENCES_GROUP(input_hardware.group),
+                              row);
+    input_hardware.rows.push_back(row);
+  }
+  gtk_widget_set_visible(input_hardware.group, !input_hardware.rows.empty());
+
+  // Without a readable /proc, show everything rather than guess.
+  bool touchpad = !input_hardware.probed ||
+                  input_hardware_has(DEVICE_TOUCHPAD) ||
+                  input_hardware_has(DEVICE_CLICKPAD);
+  bool touchscreen =
+      !input_hardware.probed || input_hardware_has(DEVICE_TOUCHSCREEN);
+  for (GtkWidget *widget : input_hardware.touchpad_widgets)
+    gtk_widget_set_visible(widget, touchpad);
+  for (GtkWidget *widget : input_hardware.touchscreen_widgets)
+    gtk_widget_set_visible(widget, touchscreen);
+}
+
+static void on_input_hardware_hotplug() {
+  probe_input_hardware();
+  refresh_input_hardware_rows();
+}
+
+// Runs once every page has bound its controls, so suggestions can be
+// compared with the current values.
+static void start_input_hardware_probe() {
+  on_input_hardware_hotplug();
+  input_hotplug_subscribe(on_input_hardware_hotplug);
+}
+
+// --probe-hardware: prints what the probe finds, so a HYPR_CONTROL_SYSROOT
+// fixture can be checked without a display.
+static int print_input_hardware() {
+  probe_input_hardware();
+  if (!input_hardware.probed) {
+    g_printerr("hypr-control: cannot read %s\n",
+               sysroot_path("/proc/bus/input/devices").c_str());
+    return 1;
+  }
+  for (const auto &device : input_hardware.devices)
+    g_print("%s: %s\n", device.name.c_str(),
+            describe_input_device(device).c_str());
+  return 0;
+}
+
+static GtkWidget *create_input_hardware_group() {
+  input_hardware.group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(input_hardware.group),
+                                  "Detected Hardware");
+  adw_preferences_group_set_description(
+      ADW_PREFERENCES_GROUP(input_hardware.group),
+      "Suggested starting values for the pointing devices that are "
+      "connected");
+  gtk_widget_set_visible(input_hardware.group, FALSE);
+  return input_hardware.group;
+}
+
+// dconf keeps its database in a GVDB file: a hash table of paths whose
+// values are serialized GVariants. It is mapped and read in place, instead
+// of running gsettings once per key.
+struct GvdbHashItem {
+  guint32 hash_value;
+  guint32 parent;
+  guint32 key_start;
+  guint16 key_size;
+  gchar type;
+  gchar unused;
+  guint32 value_start;
+  guint32 value_end;
+};
+
+struct GvdbTable {
+  GMappedFile *file = nullptr;
+  const char *data = nullptr;
+  size_t size = 0;
+  const guint32 *buckets = nullptr;
+  guint32 n_buckets = 0;
+  const GvdbHashItem *items = nullptr;
+  guint32 n_items = 0;
+
+  ~GvdbTable() {
+    if (file)
+      g_mapped_file_unref(file);
+  }
+};
+
+// Only little-endian files are read, which is what dconf writes on every
+// machine Hyprland runs on.
+static bool gvdb_open(GvdbTable &table, const std::string &path) {
+  table.file = g_mapped_file_new(path.c_str(), FALSE, nullptr);
+  if (!table.file)
+    return false;
+  table.data = g_mapped_file_get_contents(table.file);
+  table.size = g_mapped_file_get_length(table.file);
+
+  // "GVariant", version, options, then the extent of the root hash table.
+  guint32 header[6];
+  if (table.size < sizeof(header) || std::memcmp(table.data, "GVariant", 8))
+    return false;
+  std::memcpy(header, table.data, sizeof(header));
+  guint32 start = header[4], end = header[5];
+  if (start > end || end > table.size || start % 4 || end - start < 8)
+    return false;
+
+  const guint32 *root = reinterpret_cast<const guint32 *>(table.data + start);
+  size_t words = (end - start) / 4 - 2;
+  guint32 n_bloom = root[0] & ((1u << 27) - 1);
+  table.n_buckets = root[1];
+  if (n_bloom > words || table.n_buckets > words - n_bloom)
+    return false;
+  table.buckets = root + 2 + n_bloom;
+  table.items =
+      reinterpret_cast<const GvdbHashItem *>(table.buckets + table.n_buckets);
+  table.n_items = (words - n_bloom - table.n_buckets) * 4 /
+                  sizeof(GvdbHashItem);
+  return true;
+}
+
+// Items store only their last path segment; the rest comes from parents.
+static bool gvdb_check_name(const GvdbTable &table, const GvdbHashItem &item,
+                            const char *key, size_t length) {
+  size_t start = item.key_start, size = item.key_size;
+  if (start + size > table.size || size > length)
+    return false;
+  length -= size;
+  if (std::memcmp(table.data + start, key + length, size) != 0)
+    return false;
+  if (length == 0 && item.parent == 0xffffffffu)
+    return true;
+  return item.parent < table.n_items && size > 0 &&
+         gvdb_check_name(table, table.items[item.parent], key, length);
+}
+
+static GVariant *gvdb_lookup(const GvdbTable &table, const char *key) {
+  if (table.n_buckets == 0 || table.n_items == 0)
+    return nullptr;
+  guint32 hash = 5381;
+  size_t length = 0;
+  for (; key[length]; ++length)
+    hash = hash * 33 + static_cast<signed char>(key[length]);
+
+  guint32 bucket = hash % table.n_buckets;
+  guint32 item = table.buckets[bucket];
+  guint32 last = bucket == table.n_buckets - 1
+                     ? table.n_items
+                     : std::min(table.buckets[bucket + 1], table.n_items);
+  for (; item < last; ++item) {
+    const GvdbHashItem &entry = table.items[item];
+    if (entry.hash_value != hash || entry.type != 'v' ||
+        !gvdb_check_name(table, entry, key, length))
+      continue;
+    size_t start = entry.value_start, end = entry.value_end;
+    if (start > end || end > table.size || start % 8)
+      return nullptr;
+    GVariant *boxed = g_variant_ref_sink(g_variant_new_from_data(
+        G_VARIANT_TYPE_VARIANT, table.data + start, end - start, TRUE,
+        nullptr, nullptr));
+    GVariant *value = g_variant_get_variant(boxed);
+    g_variant_unref(boxed);
+    return value;
+  }
+  return nullptr;
+}
+
+// Appends the layout, variant and option lists in Hyprland's form.
+static void import_layouts(OptionValues &values,
+                           const std::vector<std::string> &layouts,
+                           const std::vector<std::string> &variants) {
+  values.push_back({"input:kb_layout", join_list(layouts)});
+  values.push_back({"input:kb_variant", join_list(variants)});
+}
+
+// dconf only stores what the user changed, so GNOME's own defaults are
+// not carried over.
+static bool import_gnome_settings(OptionValues &values) {
+  GvdbTable table;
+  if (!gvdb_open(table, std::string(g_get_user_config_dir()) + "/dconf/user"))
+    return false;
+
+  auto lookup = [&table](const char *key) {
+    std::string path = std::string("/org/gnome/desktop/") + key;
+    return gvdb_lookup(table, path.c_str());
+  };
+  auto import_bool = [&](const char *key, const char *option) {
+    if (GVariant *value = lookup(key)) {
+      if (g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN))
+        values.push_back(
+            {option, g_variant_get_boolean(value) ? "true" : "false"});
+      g_variant_unref(value);
+    }
+  };
+  auto import_string = [&](const char *key) {
+    std::string text;
+    if (GVariant *value = lookup(key)) {
+      if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+        text = g_variant_get_string(value, nullptr);
+      g_variant_unref(value);
+    }
+    return text;
+  };
+  auto import_uint = [&](const char *key) {
+    guint32 number = 0;
+    if (GVariant *value = lookup(key)) {
+      if (g_variant_is_of_type(value, G_VARIANT_TYPE_UINT32))
+        number = g_variant_get_uint32(value);
+      g_variant_unref(value);
+    }
+    return number;
+  };
+
+  if (GVariant *speed = lookup("peripherals/mouse/speed")) {
+    if (g_variant_is_of_type(speed, G_VARIANT_TYPE_DOUBLE))
+      values.push_back({"input:sensitivity",
+                        format_option_number(g_variant_get_double(speed))});
+    g_variant_unref(speed);
+  }
+  std::string profile = import_string("peripherals/mouse/accel-profile");
+  if (profile == "flat" || profile == "adaptive")
+    values.push_back({"input:accel_profile", profile});
+  import_bool("peripherals/mouse/natural-scroll", "input:natural_scroll");
+  import_bool("peripherals/mouse/left-handed", "input:left_handed");
+
+  import_bool("peripherals/touchpad/tap-to-click",
+              "input:touchpad:tap-to-click");
+  import_bool("peripherals/touchpad/tap-and-drag",
+              "input:touchpad:tap-and-drag");
+  import_bool("peripherals/touchpad/tap-and-drag-lock",
+              "input:touchpad:drag_lock");
+  import_bool("peripherals/touchpad/natural-scroll",
+              "input:touchpad:natural_scroll");
+  import_bool("peripherals/touchpad/disable-while-typing",
+              "input:touchpad:disable_while_typing");
+  std::string click = import_string("peripherals/touchpad/click-method");
+  if (click == "fingers" || click == "areas")
+    values.push_back({"input:touchpad:clickfinger_behavior",
+                      click == "fingers" ? "1" : "0"});
+
+  if (guint32 interval = import_uint("peripherals/keyboard/repeat-interval"))
+    values.push_back({"input:repeat_rate",
+                      std::to_string(std::lround(1000.0 / interval))});
+  if (guint32 delay = import_uint("peripherals/keyboard/delay"))
+    values.push_back({"input:repeat_delay", std::to_string(delay)});
+
+  // Sources are ("xkb", "layout+variant") pairs; input methods are skipped.
+  if (GVariant *sources = lookup("input-sources/sources")) {
+    if (g_variant_is_of_type(sources, G_VARIANT_TYPE("a(ss)"))) {
+      std::vector<std::string> layouts, variants;
+      GVariantIter iter;
+      const char *type, *id;
+      g_variant_iter_init(&iter, sources);
+      while (g_variant_iter_next(&iter, "(&s&s)", &type, &id)) {
+        std::string source = id;
+        size_t plus = source.find('+');
+        if (std::strcmp(type, "xkb") != 0 ||
+            std::find(layouts.begin(), layouts.end(),
+                      source.substr(0, plus)) != layouts.end())
+          continue;
+        layouts.push_back(source.substr(0, plus));
+        variants.push_back(plus == std::string::npos ? ""
+                                                     : source.substr(plus + 1));
+      }
+      if (!layouts.empty())
+        import_layouts(values, layouts, variants);
+    }
+    g_variant_unref(sources);
+  }
+  if (GVariant *options = lookup("input-sources/xkb-options")) {
+    if (g_variant_is_of_type(options, G_VARIANT_TYPE_STRING_ARRAY)) {
+      gsize count = 0;
+      const char **list = g_variant_get_strv(options, &count);
+      values.push_back({"input:kb_options",
+                        join_list(std::vector<std::string>(list,
+                                                           list + count))});
+      g_free(list);
+    }
+    g_variant_unref(options);
+  }
+  return true;
+}
+
+// KDE writes groups such as [Libinput][1133][49277][Logitech G Pro], which
+// GKeyFile rejects, so its files are read line by line.
+template <typename EntryFn>
+static bool for_each_kde_entry(const std::string &path, EntryFn entry) {
+  std::string group;
+  return for_each_line(path, [&](std::string_view line) {
+    if (line.empty() || line[0] == '#')
+      return;
+    if (line[0] == '[') {
+      group = std::string(line.substr(1, line.rfind(']') - 1));
+      return;
+    }
+    size_t equals = line.find('=');
+    if (equals == std::string_view::npos)
+      return;
+    // Drop markers such as Key[$e].
+    std::string key = std::string(line.substr(0, equals));
+    key = trim(key.substr(0, key.find('[')));
+    entry(group, key, trim(std::string(line.substr(equals + 1))));
+  });
+}
+
+static bool import_kde_settings(OptionValues &values) {
+  std::string config = g_get_user_config_dir();
+  std::vector<std::string> order;
+  std::unordered_map<std::string, OptionValues> groups;
+  bool found = for_each_kde_entry(
+      config + "/kcminputrc",
+      [&](const std::string &group, const std::string &key,
+          const std::string &value) {
+        if (!groups.count(group))
+          order.push_back(group);
+        groups[group].push_back({key, value});
+      });
+
+  auto boolean = [](const std::string &value) {
+    return parse_config_bool(value) ? "true" : "false";
+  };
+  for (const auto &group : order) {
+    const OptionValues &entries = groups[group];
+    if (group == "Keyboard") {
+      for (const auto &entry : entries) {
+        if (entry.first == "RepeatRate")
+          values.push_back({"input:repeat_rate",
+                            std::to_string(std::lround(
+                                std::atof(entry.second.c_str())))});
+        else if (entry.first == "RepeatDelay")
+          values.push_back({"input:repeat_delay", entry.second});
+        else if (entry.first == "NumLock" && entry.second != "2")
+          values.push_back({"input:numlock_by_default",
+                            entry.second == "0" ? "true" : "false"});
+      }
+      continue;
+    }
+    if (group.rfind("Libinput]", 0) != 0)
+      continue;
+
+    // Per-device groups end in the device name. Touchpads are recognized
+    // from the hardware probe, or from tapping keys for absent devices.
+    std::string name = group.substr(group.rfind("][") + 2);
+    bool touchpad = std::any_of(
+        entries.begin(), entries.end(), [](const auto &entry) {
+          return entry.first.rfind("Tap", 0) == 0;
+        });
+    for (const auto &device : input_hardware.devices) {
+      if (device.name == name)
+        touchpad = device.kind == DEVICE_TOUCHPAD ||
+                   device.kind == DEVICE_CLICKPAD;
+    }
+
+    for (const auto &entry : entries) {
+      const std::string &key = entry.first;
+      const std::string &value = entry.second;
+      if (key == "NaturalScroll")
+        values.push_back({touchpad ? "input:touchpad:natural_scroll"
+                                   : "input:natural_scroll",
+                          boolean(value)});
+      else if (key == "ScrollFactor")
+        values.push_back({touchpad ? "input:touchpad:scroll_factor"
+                                   : "input:scroll_factor",
+                          value});
+      else if (touchpad && key == "TapToClick")
+        values.push_back({"input:touchpad:tap-to-click", boolean(value)});
+      else if (touchpad && key == "TapAndDrag")
+        values.push_back({"input:touchpad:tap-and-drag", boolean(value)});
+      else if (touchpad && key == "TapDragLock")
+        values.push_back({"input:touchpad:drag_lock", boolean(value)});
+      else if (touchpad && key == "DisableWhileTyping")
+        values.push_back(
+            {"input:touchpad:disable_while_typing", boolean(value)});
+      else if (touchpad && key == "MiddleButtonEmulation")
+        values.push_back(
+            {"input:touchpad:middle_button_emulation", boolean(value)});
+      // libinput's click methods: 1 is button areas, 2 is clickfinger.
+      else if (touchpad && key == "ClickMethod" &&
+               (value == "1" || value == "2"))
+        values.push_back({"input:touchpad:clickfinger_behavior",
+                          value == "2" ? "1" : "0"});
+      else if (!touchpad && key == "PointerAcceleration")
+        values.push_back({"input:sensitivity", value});
+      else if (!touchpad && key == "PointerAccelerationProfile" &&
+               (value == "1" || value == "2"))
+        values.push_back(
+            {"input:accel_profile", value == "1" ? "flat" : "adaptive"});
+      else if (!touchpad && key == "LeftHanded")
+        values.push_back({"input:left_handed", boolean(value)});
+    }
+  }
+
+  std::vector<std::string> layouts, variants, options;
+  bool use_layouts = true;
+  found |= for_each_kde_entry(
+      config + "/kxkbrc", [&](const std::string &group, const std::string &key,
+                              const std::string &value) {
+        if (group != "Layout")
+          return;
+        if (key == "LayoutList")
+          layouts = split_list(value);
+        else if (key == "VariantList")
+          variants = split_list(value);
+        else if (key == "Options")
+          options = split_list(value);
+        else if (key == "Use")
+          use_layouts = parse_config_bool(value);
+      });
+  if (use_layouts && !layouts.empty()) {
+    variants.resize(layouts.size());
+    import_layouts(values, layouts, variants);
+    values.push_back({"input:kb_options", join_list(options)});
+  }
+  return found;
+}
+
+struct SettingsImport {
+  const char *name;
+  bool (*read)(OptionValues &values);
+};
+
+static const SettingsImport settings_imports[] = {
+    {"GNOME", import_gnome_settings},
+    {"KDE Plasma", import_kde_settings},
+};
+
+struct ImportPreview {
+  OptionValues read;
+  OptionValues changed;
+  GtkWidget *popover = nullptr;
+};
+
+static ImportPreview import_preview;
+
+static std::string current_option_text(const std::string &key) {
+  if (OptionBinding *binding = find_option_binding(key))
+    return option_binding_value(*binding);
+  if (key.rfind("input:kb_", 0) == 0) {
+    for (const auto &value : keyboard_layout_values()) {
+      if (value.first == key)
+        return value.second;
+    }
+  }
+  return get_string_option(key);
+}
+
+// Layouts go through the layout list so the Keyboard page follows. They
+// are taken from everything read, since an unchanged variant list still
+// has to match the new layouts; the keymap options then ride in the same
+// batch as the rest.
+static void apply_imported_settings() {
+  OptionValues options;
+  bool keymap = false;
+  for (const auto &value : import_preview.changed) {
+    if (value.first.rfind("input:kb_", 0) == 0)
+      keymap = true;
+    else
+      options.push_back(value);
+  }
+  if (keymap) {
+    std::vector<std::string> layouts, variants;
+    bool have_layouts = false;
+    for (const auto &value : import_preview.read) {
+      if (value.first == "input:kb_layout") {
+        layouts = split_list(value.second);
+        have_layouts = true;
+      } else if (value.first == "input:kb_variant") {
+        variants = split_list(value.second);
+      } else if (value.first == "input:kb_options") {
+        xkb_options = split_list(value.second);
+      }
+    }
+    if (have_layouts) {
+      selected_layouts = layouts;
+      for (size_t i = 0; i < layouts.size(); ++i)
+        layout_variants[layouts[i]] = i < variants.size() ? variants[i] : "";
+      refresh_layouts_list();
+    }
+    for (const auto &value : keyboard_layout_values())
+      options.push_back(value);
+  }
+  apply_option_values(options);
+}
+
+static void on_import_response(AdwAlertDialog *, const char *response,
+                               gpointer) {
+  if (std::strcmp(response, "import") == 0)
+    apply_imported_settings();
+  import_preview.read.clear();
+  import_preview.changed.clear();
+}
+
+static void on_import_source_activated(GtkListBox *, GtkListBoxRow *row,
+                                       gpointer) {
+  gtk_popover_popdown(GTK_POPOVER(import_preview.popover));
+  const SettingsImport &source =
+      settings_imports[gtk_list_box_row_get_index(row)];
+
+  gint64 start = g_get_monotonic_time();
+  OptionValues &read = import_preview.read;
+  read.clear();
+  source.read(read);
+  double elapsed = (g_get_monotonic_time() - start) / 1000.0;
+
+  // Later entries win, as they would in the source's own config.
+  OptionValues &changed = import_preview.changed;
+  changed.clear();
+  std::vector<std::string> seen;
+  for (auto it = read.rbegin(); it != read.rend(); ++it) {
+    if (std::find(seen.begin(), seen.end(), it->first) != seen.end())
+      continue;
+    seen.push_back(it->first);
+    if (!option_text_equal(current_option_text(it->first), it->second))
+      changed.insert(changed.begin(), *it);
+  }
+
+  std::ostringstream body;
+  body << std::fixed << std::setprecision(1) << "Read " << read.size()
+       << " settings in " << elapsed << " ms. ";
+  if (changed.empty())
+    body << "They all match the current configuration.";
+  else
+    body << changed.size()
+         << (changed.size() == 1 ? " setting differs"
+                                               : " settings differ")
+         << " and will be applied together.";
+
+  std::string heading = std::string("Import from ") + source.name;
+  AdwDialog *dialog = adw_alert_dialog_new(heading.c_str(), body.str().c_str());
+  if (changed.empty()) {
+    adw_alert_dialog_add_response(ADW_ALERT_DIALOG(dialog), "close", "Close");
+  } else {
+    adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(dialog), "cancel",
+                                   "Cancel", "import", "Import", nullptr);
+    adw_alert_dialog_set_response_appearance(ADW_ALERT_DIALOG(dialog),
+                                             "import", ADW_RESPONSE_SUGGESTED);
+    adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(dialog), "import");
+
+    GtkWidget *list = gtk_list_box_new();
+    gtk_list_box_set_selection_mode(GTK_LIST_BOX(list), GTK_SELECTION_NONE);
+    gtk_widget_add_css_class(list, "boxed-list");
+    for (const auto &value : changed) {
+      std::string old_value = current_option_text(value.first);
+      std::string diff = (old_value.empty() ? "(default)" : old_value) +
+                         " → " +
+                         (value.second.empty() ? "(default)" : value.second);
+      GtkWidget *row = adw_action_row_new();
+      adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row),
+                                    value.first.c_str());
+      adw_action_row_set_subtitle(ADW_ACTION_ROW(row), diff.c_str());
+      gtk_list_box_append(GTK_LIST_BOX(list), row);
+    }
+    GtkWidget *scrolled = gtk_scrolled_window_new();
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled),
+                                   GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+    gtk_scrolled_window_set_propagate_natural_height(
+        GTK_SCROLLED_WINDOW(scrolled), TRUE);
+    gtk_scrolled_window_set_max_content_height(GTK_SCROLLED_WINDOW(scrolled),
+                                               360);
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), list);
+    adw_alert_dialog_set_extra_child(ADW_ALERT_DIALOG(dialog), scrolled);
+  }
+  g_signal_connect(dialog, "response", G_CALLBACK(on_import_response),
+                   nullptr);
+  adw_dialog_present(dialog, main_window);
+}
+
+// Lists the desktops whose settings files exist; hidden when there are
+// none.
+static GtkWidget *create_import_button() {
+  std::string config = g_get_user_config_dir();
+  bool available[] = {
+      g_file_test((config + "/dconf/user").c_str(), G_FILE_TEST_IS_REGULAR),
+      g_file_test((config + "/kcminputrc").c_str(), G_FILE_TEST_IS_REGULAR) ||
+          g_file_test((config + "/kxkbrc").c_str(), G_FILE_TEST_IS_REGULAR)};
+
+  GtkWidget *list = gtk_list_box_new();
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(list), GTK_SELECTION_NONE);
+  gtk_widget_add_css_class(list, "boxed-list");
+  bool any = false;
+  for (size_t i = 0; i < G_N_ELEMENTS(settings_imports); ++i) {
+    GtkWidget *row = adw_action_row_new();
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row),
+                                  settings_imports[i].name);
+    gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(row), TRUE);
+    gtk_widget_set_visible(row, available[i]);
+    gtk_list_box_append(GTK_LIST_BOX(list), row);
+    any = any || available[i];
+  }
+  g_signal_connect(list, "row-activated",
+                   G_CALLBACK(on_import_source_activated), nullptr);
+
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+  GtkWidget *label = gtk_label_new("Import Input Settings From");
+  gtk_widget_add_css_class(label, "heading");
+  gtk_box_append(GTK_BOX(box), label);
+  gtk_box_append(GTK_BOX(box), list);
+  import_preview.popover = gtk_popover_new();
+  gtk_widget_set_size_request(import_preview.popover, 240, -1);
+  gtk_popover_set_child(GTK_POPOVER(import_preview.popover), box);
+
+  GtkWidget *button = gtk_menu_button_new();
+  gtk_menu_button_set_icon_name(GTK_MENU_BUTTON(button),
+                                "document-open-symbolic");
+  gtk_widget_set_tooltip_text(button, "Import Settings");
+  gtk_menu_button_set_popover(GTK_MENU_BUTTON(button), import_preview.popover);
+  gtk_widget_set_visible(button, any);
+  return button;
+}
+
+static GtkWidget *create_mouse_page() {
+  INSTRUMENT_SCOPE(__func__);
+  GtkWidget *page = adw_preferences_page_new();
+  adw_preferences_page_set_title(ADW_PREFERENCES_PAGE(page), "Mouse");
+  adw_preferences_page_set_icon_name(ADW_PREFERENCES_PAGE(page),
+                                     "input-mouse-symbolic");
+  GtkWidget *hardware_group = create_input_hardware_group();
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(hardware_group));
+
+  GtkWidget *general_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(general_group),
+                                  "General");
+
+  GtkWidget *sensitivity_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(sensitivity_row),
+                                "Sensitivity");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(sensitivity_row),
+                              "Mouse cursor speed multiplier");
+  GtkWidget *sensitivity_scale =
+      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, -1.0, 1.0, 0.05);
+  gtk_scale_set_draw_value(GTK_SCALE(sensitivity_scale), TRUE);
+  gtk_scale_set_value_pos(GTK_SCALE(sensitivity_scale), GTK_POS_LEFT);
+  gtk_range_set_value(GTK_RANGE(sensitivity_scale),
+                      get_float_option("input:sensitivity", 0.0));
+  gtk_widget_set_size_request(sensitivity_scale, 180, -1);
+  gtk_widget_set_valign(sensitivity_scale, GTK_ALIGN_CENTER);
+  g_signal_connect(sensitivity_scale, "value-changed",
+                   G_CALLBACK(on_sensitivity_changed), nullptr);
+  bind_option("input:sensitivity", BINDING_RANGE, sensitivity_scale);
+  sensitivity_scale_widget = sensitivity_scale;
+  adw_action_row_add_suffix(ADW_ACTION_ROW(sensitivity_row), sensitivity_scale);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group),
+                            sensitivity_row);
+
+  const char *accel_options[] = {"Default", "Flat", "Adaptive", "Custom",
+                                 nullptr};
+  GtkStringList *accel_list = gtk_string_list_new(accel_options);
+  GtkWidget *accel_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(accel_row),
+                                "Acceleration Profile");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(accel_row),
+                              "Pointer acceleration curve");
+  adw_combo_row_set_model(ADW_COMBO_ROW(accel_row), G_LIST_MODEL(accel_list));
+
+  std::string accel_val = get_string_option("input:accel_profile");
+  if (accel_val == "flat")
+    adw_combo_row_set_selected(ADW_COMBO_ROW(accel_row), 1);
+  else if (accel_val == "adaptive")
+    adw_combo_row_set_selected(ADW_COMBO_ROW(accel_row), 2);
+  else if (accel_val.rfind("custom", 0) == 0)
+    adw_combo_row_set_selected(ADW_COMBO_ROW(accel_row), 3);
+
+  g_signal_connect(accel_row, "notify::selected",
+                   G_CALLBACK(on_accel_profile_changed), nullptr);
+  bind_option("input:accel_profile", BINDING_COMBO,
+              accel_row, {"", "flat", "adaptive", "custom"});
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group), accel_row);
+
+  GtkWidget *no_accel_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(no_accel_row),
+                                "Disable Acceleration");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(no_accel_row),
+                              "Force no pointer acceleration");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(no_accel_row),
+                            get_bool_option("input:force_no_accel", false));
+  g_signal_connect(no_accel_row, "notify::active",
+                   G_CALLBACK(on_force_no_accel_changed), nullptr);
+  bind_option("input:force_no_accel", BINDING_SWITCH, no_accel_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group), no_accel_row);
+
+  GtkWidget *left_handed_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(left_handed_row),
+                                "Left Handed Mode");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(left_handed_row),
+                              "Swap left and right buttons");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(left_handed_row),
+                            get_bool_option("input:left_handed", false));
+  g_signal_connect(left_handed_row, "notify::active",
+                   G_CALLBACK(on_left_handed_changed), nullptr);
+  bind_option("input:left_handed", BINDING_SWITCH, left_handed_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(general_group),
+                            left_handed_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(general_group));
+
+  adw_preferences_page_add(
+      ADW_PREFERENCES_PAGE(page),
+      ADW_PREFERENCES_GROUP(create_accel_curve_group(accel_val)));
+
+  GtkWidget *scroll_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(scroll_group),
+                                  "Scrolling");
+
+  GtkWidget *natural_scroll_mouse_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(natural_scroll_mouse_row),
+                                "Natural Scrolling");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(natural_scroll_mouse_row),
+                              "Invert scroll direction");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(natural_scroll_mouse_row),
+                            get_bool_option("input:natural_scroll", false));
+  g_signal_connect(natural_scroll_mouse_row, "notify::active",
+                   G_CALLBACK(on_natural_scroll_mouse_changed), nullptr);
+  bind_option("input:natural_scroll", BINDING_SWITCH, natural_scroll_mouse_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group),
+                            natural_scroll_mouse_row);
+
+  const char *scroll_options[] = {"Default",        "Two Finger", "Edge",
+                                  "On Button Down", "No Scroll",  nullptr};
+  GtkStringList *scroll_list = gtk_string_list_new(scroll_options);
+  GtkWidget *scroll_method_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(scroll_method_row),
+                                "Scroll Method");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(scroll_method_row),
+                              "How scrolling is triggered");
+  adw_combo_row_set_model(ADW_COMBO_ROW(scroll_method_row),
+                          G_LIST_MODEL(scroll_list));
+
+  std::string scroll_val = get_string_option("input:scroll_method");
+  if (scroll_val == "2fg")
+    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 1);
+  else if (scroll_val == "edge")
+    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 2);
+  else if (scroll_val == "on_button_down")
+    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 3);
+  else if (scroll_val == "no_scroll")
+    adw_combo_row_set_selected(ADW_COMBO_ROW(scroll_method_row), 4);
+
+  g_signal_connect(scroll_method_row, "notify::selected",
+                   G_CALLBACK(on_scroll_method_changed), nullptr);
+  bind_option("input:scroll_method", BINDING_COMBO,
+              scroll_method_row,
+              {"", "2fg", "edge", "on_button_down", "no_scroll"});
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group),
+                            scroll_method_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(scroll_group));
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(create_scroll_pad_group()));
+
+  GtkWidget *focus_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(focus_group),
+                                  "Focus Behavior");
+
+  const char *follow_options[] = {"Disabled", "Always", "Loose", "Strict",
+                                  nullptr};
+  GtkStringList *follow_list = gtk_string_list_new(follow_options);
+  GtkWidget *follow_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(follow_row),
+                                "Follow Mouse");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(follow_row),
+                              "Window focus follows mouse cursor");
+  adw_combo_row_set_model(ADW_COMBO_ROW(follow_row), G_LIST_MODEL(follow_list));
+
+  int follow_val = get_int_option("input:follow_mouse", 1);
+  if (follow_val >= 0 && follow_val <= 3)
+    adw_combo_row_set_selected(ADW_COMBO_ROW(follow_row), follow_val);
+
+  g_signal_connect(follow_row, "notify::selected",
+                   G_CALLBACK(on_follow_mouse_changed), nullptr);
+  bind_option("input:follow_mouse", BINDING_COMBO,
+              follow_row, {"0", "1", "2", "3"});
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(focus_group), follow_row);
+
+  GtkWidget *float_focus_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(float_focus_row),
+                                "Float Switch Override Focus");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(float_focus_row),
+                              "Focus floats on mouse hover");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(float_focus_row),
+      get_int_option("input:float_switch_override_focus", 1) == 2);
+  g_signal_connect(float_focus_row, "notify::active",
+                   G_CALLBACK(on_float_switch_override_changed), nullptr);
+  bind_option("input:float_switch_override_focus", BINDING_SWITCH,
+              float_focus_row, {"0", "2"});
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(focus_group),
+                            float_focus_row);
+
+  GtkWidget *special_fallthrough_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(special_fallthrough_row),
+                                "Special Fallthrough");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(special_fallthrough_row),
+                              "Click through special workspaces");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(special_fallthrough_row),
+      get_bool_option("input:special_fallthrough", false));
+  g_signal_connect(special_fallthrough_row, "notify::active",
+                   G_CALLBACK(on_special_fallthrough_changed), nullptr);
+  bind_option("input:special_fallthrough", BINDING_SWITCH,
+              special_fallthrough_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(focus_group),
+                            special_fallthrough_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(focus_group));
+
+  GtkWidget *cursor_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(cursor_group),
+                                  "Cursor");
+
+  GtkWidget *cursor_timeout_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(cursor_timeout_row),
+                                "Hide Timeout");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(cursor_timeout_row),
+                              "Seconds before cursor hides (0 = never)");
+  GtkWidget *timeout_scale =
+      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0, 60, 1);
+  gtk_scale_set_draw_value(GTK_SCALE(timeout_scale), TRUE);
   gtk_scale_set_value_pos(GTK_SCALE(timeout_scale), GTK_POS_LEFT);
   gtk_range_set_value(GTK_RANGE(timeout_scale),
                       get_int_option("cursor:inactive_timeout", 0));
@@ -810,530 +7102,2996 @@ static GtkWidget *create_mouse_page() {
   gtk_widget_set_valign(timeout_scale, GTK_ALIGN_CENTER);
   g_signal_connect(timeout_scale, "value-changed",
                    G_CALLBACK(on_cursor_timeout_changed), nullptr);
+  bind_option("cursor:inactive_timeout", BINDING_RANGE, timeout_scale);
   adw_action_row_add_suffix(ADW_ACTION_ROW(cursor_timeout_row), timeout_scale);
   adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
                             cursor_timeout_row);
 
-  GtkWidget *cursor_zoom_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(cursor_zoom_row),
-                                "Zoom Factor");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(cursor_zoom_row),
-                              "Cursor size multiplier");
-  GtkWidget *zoom_scale =
-      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 1.0, 4.0, 0.1);
-  gtk_scale_set_draw_value(GTK_SCALE(zoom_scale), TRUE);
-  gtk_scale_set_value_pos(GTK_SCALE(zoom_scale), GTK_POS_LEFT);
-  gtk_range_set_value(GTK_RANGE(zoom_scale),
-                      get_float_option("cursor:zoom_factor", 1.0));
-  gtk_widget_set_size_request(zoom_scale, 180, -1);
-  gtk_widget_set_valign(zoom_scale, GTK_ALIGN_CENTER);
-  g_signal_connect(zoom_scale, "value-changed",
-                   G_CALLBACK(on_cursor_zoom_factor_changed), nullptr);
-  adw_action_row_add_suffix(ADW_ACTION_ROW(cursor_zoom_row), zoom_scale);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
-                            cursor_zoom_row);
+  GtkWidget *cursor_zoom_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(cursor_zoom_row),
+                                "Zoom Factor");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(cursor_zoom_row),
+                              "Cursor size multiplier");
+  GtkWidget *zoom_scale =
+      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 1.0, 4.0, 0.1);
+  gtk_scale_set_draw_value(GTK_SCALE(zoom_scale), TRUE);
+  gtk_scale_set_value_pos(GTK_SCALE(zoom_scale), GTK_POS_LEFT);
+  gtk_range_set_value(GTK_RANGE(zoom_scale),
+                      get_float_option("cursor:zoom_factor", 1.0));
+  gtk_widget_set_size_request(zoom_scale, 180, -1);
+  gtk_widget_set_valign(zoom_scale, GTK_ALIGN_CENTER);
+  g_signal_connect(zoom_scale, "value-changed",
+                   G_CALLBACK(on_cursor_zoom_factor_changed), nullptr);
+  bind_option("cursor:zoom_factor", BINDING_RANGE, zoom_scale);
+  adw_action_row_add_suffix(ADW_ACTION_ROW(cursor_zoom_row), zoom_scale);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
+                            cursor_zoom_row);
+
+  GtkWidget *hide_on_key_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(hide_on_key_row),
+                                "Hide on Key Press");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(hide_on_key_row),
+                              "Hide cursor when typing");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(hide_on_key_row),
+                            get_bool_option("cursor:hide_on_key_press", false));
+  g_signal_connect(hide_on_key_row, "notify::active",
+                   G_CALLBACK(on_cursor_hide_on_key_changed), nullptr);
+  bind_option("cursor:hide_on_key_press", BINDING_SWITCH, hide_on_key_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
+                            hide_on_key_row);
+
+  GtkWidget *hide_on_touch_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(hide_on_touch_row),
+                                "Hide on Touch");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(hide_on_touch_row),
+                              "Hide cursor when touching screen");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(hide_on_touch_row),
+                            get_bool_option("cursor:hide_on_touch", false));
+  g_signal_connect(hide_on_touch_row, "notify::active",
+                   G_CALLBACK(on_cursor_hide_on_touch_changed), nullptr);
+  bind_option("cursor:hide_on_touch", BINDING_SWITCH, hide_on_touch_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
+                            hide_on_touch_row);
+
+  std::string cursor_theme = current_cursor_theme();
+  cursor_picker.theme_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(cursor_picker.theme_row),
+                                "Cursor Theme");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(cursor_picker.theme_row),
+                              cursor_theme.empty() ? "Default"
+                                                   : cursor_theme.c_str());
+  gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(cursor_picker.theme_row),
+                                   TRUE);
+  adw_action_row_add_suffix(ADW_ACTION_ROW(cursor_picker.theme_row),
+                            gtk_image_new_from_icon_name("go-next-symbolic"));
+  g_signal_connect(cursor_picker.theme_row, "activated",
+                   G_CALLBACK(on_cursor_theme_clicked), nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
+                            cursor_picker.theme_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(cursor_group));
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(create_pointer_pad_group()));
+
+  return page;
+}
+
+static GtkWidget *create_touchpad_page() {
+  INSTRUMENT_SCOPE(__func__);
+  GtkWidget *page = adw_preferences_page_new();
+  adw_preferences_page_set_title(ADW_PREFERENCES_PAGE(page), "Touchpad");
+  adw_preferences_page_set_icon_name(ADW_PREFERENCES_PAGE(page),
+                                     "input-touchpad-symbolic");
+
+  GtkWidget *device_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(device_group),
+                                  "Device");
+
+  GtkWidget *touchpad_enabled_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(touchpad_enabled_row),
+                                "Touchpad Enabled");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(touchpad_enabled_row),
+                              "Enable or disable touchpad");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(touchpad_enabled_row),
+                            get_bool_option("input:touchpad:enabled", true));
+  g_signal_connect(touchpad_enabled_row, "notify::active",
+                   G_CALLBACK(on_touchpad_toggle_changed), nullptr);
+  bind_option("input:touchpad:enabled", BINDING_SWITCH, touchpad_enabled_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(device_group),
+                            touchpad_enabled_row);
+
+  GtkWidget *rules_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(rules_row),
+                                "Apply Input Rules");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(rules_row),
+                              "Change settings automatically using the rules "
+                              "in ~/.config/hypr-control/rules.conf");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(rules_row),
+                            get_setting_bool("rules", "enabled", false) &&
+                                running_daemon_pid() > 0);
+  g_signal_connect(rules_row, "notify::active",
+                   G_CALLBACK(on_input_rules_changed), nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(device_group), rules_row);
+
+  GtkWidget *touchscreen_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(touchscreen_row),
+                                "Touchscreen Enabled");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(touchscreen_row),
+                              "Enable or disable touchscreen");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(touchscreen_row),
+                            get_bool_option("input:touchdevice:enabled", true));
+  g_signal_connect(touchscreen_row, "notify::active",
+                   G_CALLBACK(on_touchdevice_toggle_changed), nullptr);
+  bind_option("input:touchdevice:enabled", BINDING_SWITCH, touchscreen_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(device_group),
+                            touchscreen_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(device_group));
+
+  GtkWidget *tap_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(tap_group), "Tapping");
+
+  GtkWidget *tap_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(tap_row), "Tap to Click");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(tap_row),
+                              "Tap the touchpad to click");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(tap_row),
+      get_bool_option("input:touchpad:tap-to-click", true));
+  g_signal_connect(tap_row, "notify::active",
+                   G_CALLBACK(on_tap_to_click_changed), nullptr);
+  bind_option("input:touchpad:tap-to-click", BINDING_SWITCH, tap_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), tap_row);
+
+  GtkWidget *tap_drag_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(tap_drag_row),
+                                "Tap and Drag");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(tap_drag_row),
+                              "Tap and hold to drag");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(tap_drag_row),
+      get_bool_option("input:touchpad:tap-and-drag", true));
+  g_signal_connect(tap_drag_row, "notify::active",
+                   G_CALLBACK(on_tap_and_drag_changed), nullptr);
+  bind_option("input:touchpad:tap-and-drag", BINDING_SWITCH, tap_drag_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), tap_drag_row);
+
+  GtkWidget *drag_lock_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(drag_lock_row),
+                                "Drag Lock");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(drag_lock_row),
+                              "Continue drag after lifting finger");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(drag_lock_row),
+                            get_bool_option("input:touchpad:drag_lock", false));
+  g_signal_connect(drag_lock_row, "notify::active",
+                   G_CALLBACK(on_drag_lock_changed), nullptr);
+  bind_option("input:touchpad:drag_lock", BINDING_SWITCH, drag_lock_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), drag_lock_row);
+
+  const char *click_options[] = {"Button Areas", "Clickfinger", nullptr};
+  GtkStringList *click_list = gtk_string_list_new(click_options);
+  GtkWidget *click_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(click_row), "Click Method");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(click_row),
+                              "How right/middle click is detected");
+  adw_combo_row_set_model(ADW_COMBO_ROW(click_row), G_LIST_MODEL(click_list));
+  adw_combo_row_set_selected(
+      ADW_COMBO_ROW(click_row),
+      get_int_option("input:touchpad:clickfinger_behavior", 1));
+  g_signal_connect(click_row, "notify::selected",
+                   G_CALLBACK(on_clickfinger_behavior_changed), nullptr);
+  bind_option("input:touchpad:clickfinger_behavior", BINDING_COMBO,
+              click_row, {"0", "1"});
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), click_row);
+
+  GtkWidget *middle_emu_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(middle_emu_row),
+                                "Middle Button Emulation");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(middle_emu_row),
+                              "Press left+right for middle click");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(middle_emu_row),
+      get_bool_option("input:touchpad:middle_button_emulation", false));
+  g_signal_connect(middle_emu_row, "notify::active",
+                   G_CALLBACK(on_middle_button_emulation_changed), nullptr);
+  bind_option("input:touchpad:middle_button_emulation", BINDING_SWITCH,
+              middle_emu_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), middle_emu_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(tap_group));
+
+  GtkWidget *scroll_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(scroll_group),
+                                  "Scrolling");
+
+  GtkWidget *natural_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(natural_row),
+                                "Natural Scrolling");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(natural_row),
+                              "Content follows finger direction");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(natural_row),
+      get_bool_option("input:touchpad:natural_scroll", true));
+  g_signal_connect(natural_row, "notify::active",
+                   G_CALLBACK(on_natural_scroll_changed), nullptr);
+  bind_option("input:touchpad:natural_scroll", BINDING_SWITCH, natural_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group), natural_row);
+
+  GtkWidget *scroll_factor_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(scroll_factor_row),
+                                "Scroll Speed");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(scroll_factor_row),
+                              "Scroll distance multiplier");
+  GtkWidget *scroll_scale =
+      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0.1, 3.0, 0.1);
+  gtk_scale_set_draw_value(GTK_SCALE(scroll_scale), TRUE);
+  gtk_scale_set_value_pos(GTK_SCALE(scroll_scale), GTK_POS_LEFT);
+  gtk_range_set_value(GTK_RANGE(scroll_scale),
+                      get_float_option("input:touchpad:scroll_factor", 1.0));
+  gtk_widget_set_size_request(scroll_scale, 180, -1);
+  gtk_widget_set_valign(scroll_scale, GTK_ALIGN_CENTER);
+  g_signal_connect(scroll_scale, "value-changed",
+                   G_CALLBACK(on_scroll_factor_changed), nullptr);
+  bind_option("input:touchpad:scroll_factor", BINDING_RANGE, scroll_scale);
+  scroll_factor_scale_widget = scroll_scale;
+  adw_action_row_add_suffix(ADW_ACTION_ROW(scroll_factor_row), scroll_scale);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group),
+                            scroll_factor_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(scroll_group));
+
+  GtkWidget *behavior_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(behavior_group),
+                                  "Behavior");
+
+  GtkWidget *dwt_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(dwt_row),
+                                "Disable While Typing");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(dwt_row),
+                              "Ignore touchpad while typing");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(dwt_row),
+      get_bool_option("input:touchpad:disable_while_typing", true));
+  g_signal_connect(dwt_row, "notify::active",
+                   G_CALLBACK(on_disable_while_typing_changed), nullptr);
+  bind_option("input:touchpad:disable_while_typing", BINDING_SWITCH, dwt_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(behavior_group), dwt_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(behavior_group));
+
+  GtkWidget *gesture_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(gesture_group),
+                                  "Gestures");
+
+  GtkWidget *swipe_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_row),
+                                "Workspace Swipe");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_row),
+                              "Swipe to change workspaces");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(swipe_row),
+                            get_bool_option("gestures:workspace_swipe", true));
+  g_signal_connect(swipe_row, "notify::active",
+                   G_CALLBACK(on_workspace_swipe_changed), nullptr);
+  bind_option("gestures:workspace_swipe", BINDING_SWITCH, swipe_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group), swipe_row);
+
+  const char *fingers_options[] = {"3 Fingers", "4 Fingers", nullptr};
+  GtkStringList *fingers_list = gtk_string_list_new(fingers_options);
+  GtkWidget *fingers_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(fingers_row),
+                                "Swipe Fingers");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(fingers_row),
+                              "Number of fingers for gesture");
+  adw_combo_row_set_model(ADW_COMBO_ROW(fingers_row),
+                          G_LIST_MODEL(fingers_list));
+  adw_combo_row_set_selected(
+      ADW_COMBO_ROW(fingers_row),
+      get_int_option("gestures:workspace_swipe_fingers", 3) == 4 ? 1 : 0);
+  g_signal_connect(fingers_row, "notify::selected",
+                   G_CALLBACK(on_workspace_swipe_fingers_changed), nullptr);
+  bind_option("gestures:workspace_swipe_fingers", BINDING_COMBO,
+              fingers_row, {"3", "4"});
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group), fingers_row);
+
+  GtkWidget *swipe_dist_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_dist_row),
+                                "Swipe Distance");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_dist_row),
+                              "Pixels needed for workspace switch");
+  GtkWidget *dist_scale =
+      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 100, 500, 10);
+  gtk_scale_set_draw_value(GTK_SCALE(dist_scale), TRUE);
+  gtk_scale_set_value_pos(GTK_SCALE(dist_scale), GTK_POS_LEFT);
+  gtk_range_set_value(GTK_RANGE(dist_scale),
+                      get_int_option("gestures:workspace_swipe_distance", 300));
+  gtk_widget_set_size_request(dist_scale, 180, -1);
+  gtk_widget_set_valign(dist_scale, GTK_ALIGN_CENTER);
+  g_signal_connect(dist_scale, "value-changed",
+                   G_CALLBACK(on_workspace_swipe_distance_changed), nullptr);
+  bind_option("gestures:workspace_swipe_distance", BINDING_RANGE, dist_scale);
+  adw_action_row_add_suffix(ADW_ACTION_ROW(swipe_dist_row), dist_scale);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group),
+                            swipe_dist_row);
+
+  GtkWidget *swipe_invert_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_invert_row),
+                                "Invert Swipe");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_invert_row),
+                              "Reverse swipe direction");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(swipe_invert_row),
+      get_bool_option("gestures:workspace_swipe_invert", true));
+  g_signal_connect(swipe_invert_row, "notify::active",
+                   G_CALLBACK(on_workspace_swipe_invert_changed), nullptr);
+  bind_option("gestures:workspace_swipe_invert", BINDING_SWITCH,
+              swipe_invert_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group),
+                            swipe_invert_row);
+
+  GtkWidget *swipe_forever_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_forever_row),
+                                "Continuous Swipe");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_forever_row),
+                              "Keep swiping through all workspaces");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(swipe_forever_row),
+      get_bool_option("gestures:workspace_swipe_forever", false));
+  g_signal_connect(swipe_forever_row, "notify::active",
+                   G_CALLBACK(on_workspace_swipe_forever_changed), nullptr);
+  bind_option("gestures:workspace_swipe_forever", BINDING_SWITCH,
+              swipe_forever_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group),
+                            swipe_forever_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(gesture_group));
+  GtkWidget *gesture_pad_group = create_gesture_pad_group(dist_scale);
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(gesture_pad_group));
+
+  input_hardware.touchpad_widgets = {touchpad_enabled_row, tap_group,
+                                     scroll_group,         behavior_group,
+                                     gesture_group,        gesture_pad_group};
+  input_hardware.touchscreen_widgets = {touchscreen_row};
+  return page;
+}
+
+struct KeyRepeatTester {
+  SampleRing<uint32_t, 512> intervals;
+  SampleRing<uint32_t, 32> delays;
+  std::array<uint32_t, 16> jitter_histogram = {};
+  guint held_keycode = 0;
+  guint32 last_time = 0;
+  bool repeating = false;
+  guint tick_id = 0;
+
+  GtkWidget *area = nullptr;
+  GtkWidget *label = nullptr;
+  GtkWidget *rate_scale = nullptr;
+  GtkWidget *delay_scale = nullptr;
+};
+
+static KeyRepeatTester key_repeat_tester;
+
+static void update_key_repeat_stats() {
+  KeyRepeatTester &t = key_repeat_tester;
+  if (!t.label)
+    return;
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(0);
+  if (t.rate_scale && t.delay_scale)
+    oss << "Configured: " << gtk_range_get_value(GTK_RANGE(t.rate_scale))
+        << "/s after " << gtk_range_get_value(GTK_RANGE(t.delay_scale))
+        << " ms";
+
+  t.jitter_histogram.fill(0);
+  size_t n = t.intervals.size();
+  if (n > 0) {
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i)
+      sum += t.intervals[i];
+    double mean = sum / n;
+    double variance = 0;
+    for (size_t i = 0; i < n; ++i) {
+      double deviation = t.intervals[i] - mean;
+      variance += deviation * deviation;
+      ++t.jitter_histogram[std::min<size_t>(std::abs(deviation), 15)];
+    }
+
+    double delay = 0;
+    for (size_t i = 0; i < t.delays.size(); ++i)
+      delay += t.delays[i];
+    if (t.delays.size() > 0)
+      delay /= t.delays.size();
+
+    oss << "\nMeasured: " << std::setprecision(1)
+        << (mean > 0 ? 1000.0 / mean : 0) << "/s after "
+        << std::setprecision(0) << delay << " ms · Jitter: "
+        << std::setprecision(1) << std::sqrt(variance / n) << " ms ("
+        << n << " repeats)";
+  } else {
+    oss << "\nHold a key in the box to measure";
+  }
+  gtk_label_set_text(GTK_LABEL(t.label), oss.str().c_str());
+}
+
+static gboolean on_key_repeat_tick(GtkWidget *widget, GdkFrameClock *,
+                                   gpointer) {
+  key_repeat_tester.tick_id = 0;
+  update_key_repeat_stats();
+  gtk_widget_queue_draw(widget);
+  return G_SOURCE_REMOVE;
+}
+
+static void schedule_key_repeat_update() {
+  if (key_repeat_tester.area && key_repeat_tester.tick_id == 0)
+    key_repeat_tester.tick_id = gtk_widget_add_tick_callback(
+        key_repeat_tester.area, on_key_repeat_tick, nullptr, nullptr);
+}
+
+static void reset_key_repeat_tester() {
+  key_repeat_tester.intervals.clear();
+  key_repeat_tester.delays.clear();
+  key_repeat_tester.held_keycode = 0;
+  schedule_key_repeat_update();
+}
+
+static gboolean on_key_repeat_pressed(GtkEventControllerKey *controller,
+                                      guint keyval, guint keycode,
+                                      GdkModifierType, gpointer) {
+  if (keyval == GDK_KEY_Tab || keyval == GDK_KEY_ISO_Left_Tab)
+    return FALSE;
+
+  KeyRepeatTester &t = key_repeat_tester;
+  guint32 time = gtk_event_controller_get_current_event_time(
+      GTK_EVENT_CONTROLLER(controller));
+  if (keycode == t.held_keycode) {
+    uint32_t dt = time - t.last_time;
+    if (t.repeating)
+      t.intervals.push(dt);
+    else
+      t.delays.push(dt);
+    t.repeating = true;
+  } else {
+    t.held_keycode = keycode;
+    t.repeating = false;
+  }
+  t.last_time = time;
+  schedule_key_repeat_update();
+  return TRUE;
+}
+
+static void on_key_repeat_released(GtkEventControllerKey *, guint,
+                                   guint keycode, GdkModifierType, gpointer) {
+  if (keycode == key_repeat_tester.held_keycode)
+    key_repeat_tester.held_keycode = 0;
+}
+
+static void on_key_repeat_area_pressed(GtkGestureClick *, int, double, double,
+                                       gpointer) {
+  gtk_widget_grab_focus(key_repeat_tester.area);
+}
+
+static void draw_key_repeat_area(GtkDrawingArea *area, cairo_t *cr, int width,
+                                 int height, gpointer) {
+  GdkRGBA color;
+  gtk_widget_get_color(GTK_WIDGET(area), &color);
+  bool focused = gtk_widget_has_focus(GTK_WIDGET(area));
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue,
+                        focused ? 0.1 : 0.04);
+  cairo_rectangle(cr, 0, 0, width, height);
+  cairo_fill(cr);
+
+  if (key_repeat_tester.intervals.size() == 0) {
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.5);
+    cairo_move_to(cr, 12, height / 2.0);
+    cairo_show_text(cr, focused ? "Hold down any key"
+                                : "Click here, then hold down any key");
+    return;
+  }
+
+  cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.6);
+  draw_histogram(cr, key_repeat_tester.jitter_histogram.data(),
+                 key_repeat_tester.jitter_histogram.size(), 8, 8, width - 16,
+                 height - 16);
+}
+
+static void on_key_repeat_focus_changed(GtkEventControllerFocus *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  gtk_widget_queue_draw(key_repeat_tester.area);
+}
+
+static GtkWidget *create_key_repeat_tester(GtkWidget *rate_scale,
+                                           GtkWidget *delay_scale) {
+  key_repeat_tester.rate_scale = rate_scale;
+  key_repeat_tester.delay_scale = delay_scale;
+
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+  gtk_widget_set_margin_top(box, 12);
+
+  key_repeat_tester.area = gtk_drawing_area_new();
+  gtk_widget_set_size_request(key_repeat_tester.area, -1, 80);
+  gtk_widget_set_focusable(key_repeat_tester.area, TRUE);
+  gtk_widget_add_css_class(key_repeat_tester.area, "card");
+  gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(key_repeat_tester.area),
+                                 draw_key_repeat_area, nullptr, nullptr);
+
+  GtkEventController *keys = gtk_event_controller_key_new();
+  g_signal_connect(keys, "key-pressed", G_CALLBACK(on_key_repeat_pressed),
+                   nullptr);
+  g_signal_connect(keys, "key-released", G_CALLBACK(on_key_repeat_released),
+                   nullptr);
+  gtk_widget_add_controller(key_repeat_tester.area, keys);
+
+  GtkGesture *click = gtk_gesture_click_new();
+  g_signal_connect(click, "pressed", G_CALLBACK(on_key_repeat_area_pressed),
+                   nullptr);
+  gtk_widget_add_controller(key_repeat_tester.area,
+                            GTK_EVENT_CONTROLLER(click));
+
+  GtkEventController *focus = gtk_event_controller_focus_new();
+  g_signal_connect(focus, "enter", G_CALLBACK(on_key_repeat_focus_changed),
+                   nullptr);
+  g_signal_connect(focus, "leave", G_CALLBACK(on_key_repeat_focus_changed),
+                   nullptr);
+  gtk_widget_add_controller(key_repeat_tester.area, focus);
+  gtk_box_append(GTK_BOX(box), key_repeat_tester.area);
+
+  key_repeat_tester.label = gtk_label_new(nullptr);
+  gtk_label_set_xalign(GTK_LABEL(key_repeat_tester.label), 0);
+  gtk_widget_add_css_class(key_repeat_tester.label, "dim-label");
+  gtk_box_append(GTK_BOX(box), key_repeat_tester.label);
+
+  update_key_repeat_stats();
+  return box;
+}
+
+// The "grp:" entries of the XKB options catalog, e.g. "grp:alt_shift_toggle".
+static void load_xkb_toggle_options() {
+  if (!xkb_toggle_options.empty())
+    return;
+  g_autofree char *contents = nullptr;
+  if (!g_file_get_contents("/usr/share/X11/xkb/rules/evdev.lst", &contents,
+                           nullptr, nullptr))
+    return;
+
+  std::stringstream ss(contents);
+  std::string line;
+  std::string section;
+  while (std::getline(ss, line)) {
+    if (line.rfind("! ", 0) == 0) {
+      section = line.substr(2);
+      continue;
+    }
+    std::stringstream fields(line);
+    std::string name;
+    if (section != "option" || !(fields >> name) ||
+        name.rfind("grp:", 0) != 0)
+      continue;
+    std::string description;
+    std::getline(fields, description);
+    description.erase(0, description.find_first_not_of(" \t"));
+    xkb_toggle_options.emplace_back(name, description);
+  }
+}
+
+static void on_layout_toggle_changed(GObject *row, GParamSpec *, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
+  xkb_options.erase(std::remove_if(xkb_options.begin(), xkb_options.end(),
+                                   [](const std::string &option) {
+                                     return option.rfind("grp:", 0) == 0;
+                                   }),
+                    xkb_options.end());
+  if (selected > 0 && selected <= xkb_toggle_options.size())
+    xkb_options.push_back(xkb_toggle_options[selected - 1].first);
+
+  // The toggle replaces the exec bind; keeping both would switch twice.
+  // In staged mode the bind stays until the toggle itself is applied.
+  if (staged_mode && !option_apply_suppressed) {
+    staged.unbind = selected > 0 ? current_layout_switch_bind : "";
+  } else if (selected > 0 && !current_layout_switch_bind.empty() &&
+             !option_apply_suppressed) {
+    execute_hyprctl_bind("keyword unbind " + current_layout_switch_bind);
+    current_layout_switch_bind = "";
+    refresh_keybinds_list();
+  }
+  for (GtkWidget *keybind_row : layout_keybind_rows)
+    gtk_widget_set_sensitive(keybind_row, selected == 0);
+  apply_keyboard_layouts();
+}
+
+enum LayoutProbeStep { PROBE_IDLE, PROBE_EXEC, PROBE_DIRECT };
+
+// Times a switch through a spawned hyprctl against the same request sent
+// over the socket, and passively times switches typed on the keyboard page,
+// each up to the first activelayout event.
+struct LayoutSwitchProbe {
+  LayoutProbeStep step = PROBE_IDLE;
+  gint64 started = 0;
+  gint64 key_pressed = 0;
+  guint timeout = 0;
+  double exec_ms = -1;
+  double direct_ms = -1;
+  double key_ms = -1;
+  GtkWidget *row = nullptr;
+  GtkWidget *button = nullptr;
+};
+
+static LayoutSwitchProbe layout_probe;
+
+static void update_layout_probe_row(const char *message = nullptr) {
+  if (!layout_probe.row)
+    return;
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(1);
+  if (message) {
+    text << message;
+  } else {
+    const char *separator = "";
+    if (layout_probe.exec_ms >= 0) {
+      text << "hyprctl exec " << layout_probe.exec_ms << " ms";
+      separator = " · ";
+    }
+    if (layout_probe.direct_ms >= 0) {
+      text << separator << "IPC " << layout_probe.direct_ms << " ms";
+      separator = " · ";
+    }
+    if (layout_probe.key_ms >= 0)
+      text << separator << "last key switch " << layout_probe.key_ms << " ms";
+    if (text.tellp() == 0)
+      text << "Switch layouts here, or measure both paths";
+  }
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(layout_probe.row),
+                              text.str().c_str());
+  gtk_widget_set_sensitive(layout_probe.button,
+                           layout_probe.step == PROBE_IDLE);
+}
+
+static gboolean on_layout_probe_timeout(gpointer) {
+  layout_probe.timeout = 0;
+  layout_probe.step = PROBE_IDLE;
+  layout_probe.started = 0;
+  update_layout_probe_row("No layout switch observed");
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean on_layout_probe_settled(gpointer) {
+  layout_probe.timeout = 0;
+  if (layout_probe.step != PROBE_EXEC) {
+    layout_probe.step = PROBE_IDLE;
+    update_layout_probe_row();
+    return G_SOURCE_REMOVE;
+  }
+  layout_probe.step = PROBE_DIRECT;
+  layout_probe.started = g_get_monotonic_time();
+  dispatch_hyprctl("switchxkblayout all next");
+  layout_probe.timeout = g_timeout_add(1000, on_layout_probe_timeout, nullptr);
+  return G_SOURCE_REMOVE;
+}
+
+static void on_layout_probe_event(const std::string &event,
+                                  const std::string &) {
+  if (event != "activelayout")
+    return;
+  gint64 now = g_get_monotonic_time();
+
+  if (layout_probe.step == PROBE_IDLE) {
+    if (layout_probe.key_pressed && now - layout_probe.key_pressed < 500000) {
+      layout_probe.key_ms = (now - layout_probe.key_pressed) / 1000.0;
+      update_layout_probe_row();
+    }
+    layout_probe.key_pressed = 0;
+    return;
+  }
+  // "all" reports one event per keyboard; only the first one counts.
+  if (!layout_probe.started)
+    return;
+  double ms = (now - layout_probe.started) / 1000.0;
+  if (layout_probe.step == PROBE_EXEC)
+    layout_probe.exec_ms = ms;
+  else
+    layout_probe.direct_ms = ms;
+  layout_probe.started = 0;
+  if (layout_probe.timeout)
+    g_source_remove(layout_probe.timeout);
+  dispatch_hyprctl("switchxkblayout all prev");
+  layout_probe.timeout = g_timeout_add(250, on_layout_probe_settled, nullptr);
+}
+
+static void on_measure_layout_switch(GtkButton *, gpointer) {
+  if (selected_layouts.size() < 2) {
+    update_layout_probe_row("Add a second layout to measure switching");
+    return;
+  }
+  const char *argv[] = {"hyprctl", "switchxkblayout", "all", "next", nullptr};
+  layout_probe.step = PROBE_EXEC;
+  layout_probe.started = g_get_monotonic_time();
+  INSTRUMENT_COUNT(COUNT_SPAWNS, 1);
+  if (!g_spawn_async(nullptr, const_cast<char **>(argv), nullptr,
+                     G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL,
+                     nullptr, nullptr, nullptr, nullptr)) {
+    layout_probe.step = PROBE_IDLE;
+    update_layout_probe_row("Could not run hyprctl");
+    return;
+  }
+  layout_probe.timeout = g_timeout_add(1000, on_layout_probe_timeout, nullptr);
+  update_layout_probe_row("Measuring…");
+}
+
+static gboolean on_layout_probe_key_pressed(GtkEventControllerKey *, guint,
+                                            guint, GdkModifierType,
+                                            gpointer) {
+  layout_probe.key_pressed = g_get_monotonic_time();
+  return FALSE;
+}
+
+static void load_keybind_state() {
+  current_layout_switch_bind = "";
+  std::string output = switch_layout_binds(request_output("binds"));
+  if (output.empty())
+    return;
+
+  int modmask = 0;
+  std::string key_code;
+  std::stringstream ss(output);
+  std::string line;
+
+  while (std::getline(ss, line)) {
+    if (line.find("modmask:") != std::string::npos) {
+      try {
+        modmask = std::stoi(line.substr(line.find("modmask:") + 9));
+      } catch (...) {
+      }
+    }
+    if (line.find("key:") != std::string::npos) {
+      key_code = line.substr(line.find("key:") + 5);
+      key_code.erase(0, key_code.find_first_not_of(" \t"));
+    }
+  }
+
+  std::string mod_str;
+  if (modmask == 64)
+    mod_str = "SUPER";
+  else if (modmask == 8)
+    mod_str = "ALT";
+  else if (modmask == 4)
+    mod_str = "CTRL";
+  else if (modmask == 1)
+    mod_str = "SHIFT";
+  else if (modmask == 65)
+    mod_str = "SUPER_SHIFT";
+  else if (modmask == 9)
+    mod_str = "ALT_SHIFT";
+  else if (modmask == 12)
+    mod_str = "CTRL_ALT";
+  else if (modmask == 72)
+    mod_str = "SUPER_ALT";
+
+  if (!mod_str.empty() && !key_code.empty()) {
+    current_layout_switch_bind = mod_str + ", " + key_code;
+  }
+}
+
+static GtkWidget *create_keyboard_page() {
+  INSTRUMENT_SCOPE(__func__);
+  GtkWidget *page = adw_preferences_page_new();
+  adw_preferences_page_set_title(ADW_PREFERENCES_PAGE(page), "Keyboard");
+  adw_preferences_page_set_icon_name(ADW_PREFERENCES_PAGE(page),
+                                     "input-keyboard-symbolic");
+
+  
+  selected_layouts.clear();
+  std::string layouts_str = get_string_option("input:kb_layout");
+  if (!layouts_str.empty()) {
+    std::stringstream ss(layouts_str);
+    std::string segment;
+    while (std::getline(ss, segment, ',')) {
+      segment.erase(0, segment.find_first_not_of(" \t"));
+      selected_layouts.push_back(segment);
+    }
+  }
+  std::vector<std::string> variants =
+      split_list(get_string_option("input:kb_variant"));
+  for (size_t i = 0; i < variants.size() && i < selected_layouts.size(); ++i)
+    layout_variants[selected_layouts[i]] = variants[i];
+  xkb_options = split_list(get_string_option("input:kb_options"));
+
+  
+  load_keybind_state();
+
+  GtkWidget *layout_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(layout_group),
+                                  "Layouts");
+
+  layouts_list_box = gtk_list_box_new();
+  gtk_widget_add_css_class(layouts_list_box, "boxed-list");
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(layouts_list_box),
+                                  GTK_SELECTION_NONE);
+  gtk_widget_set_visible(layouts_list_box, FALSE);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(layout_group),
+                            layouts_list_box);
+  refresh_layouts_list(); 
+
+  GtkWidget *add_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(add_row), "Add Layout");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(add_row),
+                              "Add a new keyboard layout");
+  gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(add_row), TRUE);
+  GtkWidget *add_icon = gtk_image_new_from_icon_name("list-add-symbolic");
+  adw_action_row_add_suffix(ADW_ACTION_ROW(add_row), add_icon);
+  g_signal_connect(add_row, "activated", G_CALLBACK(on_add_layout_clicked),
+                   nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(layout_group), add_row);
+
+  GtkWidget *memory_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(memory_row),
+                                "Remember Layout per Window");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(memory_row),
+                              "Restore each app's layout when it gains focus");
+  adw_switch_row_set_active(
+      ADW_SWITCH_ROW(memory_row),
+      get_setting_bool("layout-memory", "enabled", false) &&
+          running_daemon_pid() > 0);
+  g_signal_connect(memory_row, "notify::active",
+                   G_CALLBACK(on_layout_memory_changed), nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(layout_group), memory_row);
+
+  GtkWidget *status_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(status_row),
+                                "Share State with Status Bars");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(status_row),
+                              "Keep publishing the layout and devices on "
+                              "D-Bus when this window is closed");
+  adw_switch_row_set_active(ADW_SWITCH_ROW(status_row),
+                            get_setting_bool("status", "enabled", false) &&
+                                running_daemon_pid() > 0);
+  g_signal_connect(status_row, "notify::active",
+                   G_CALLBACK(on_input_state_setting_changed), nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(layout_group), status_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(layout_group));
+
+  GtkWidget *keybind_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(keybind_group),
+                                  "Layout Switching");
+  adw_preferences_group_set_description(
+      ADW_PREFERENCES_GROUP(keybind_group),
+      "Set a keybind to cycle through layouts");
+
+  keybinds_list_box = gtk_list_box_new();
+  gtk_widget_add_css_class(keybinds_list_box, "boxed-list");
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(keybinds_list_box),
+                                  GTK_SELECTION_NONE);
+  gtk_widget_set_visible(keybinds_list_box, FALSE);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group),
+                            keybinds_list_box);
+
+  load_xkb_toggle_options();
+  GtkStringList *toggle_list = gtk_string_list_new(nullptr);
+  gtk_string_list_append(toggle_list, "None (use keybind)");
+  guint toggle_selected = 0;
+  for (size_t i = 0; i < xkb_toggle_options.size(); ++i) {
+    gtk_string_list_append(toggle_list, xkb_toggle_options[i].second.c_str());
+    if (std::find(xkb_options.begin(), xkb_options.end(),
+                  xkb_toggle_options[i].first) != xkb_options.end())
+      toggle_selected = i + 1;
+  }
+  GtkWidget *toggle_row = adw_combo_row_new();
+  layout_toggle_row = toggle_row;
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(toggle_row), "XKB Toggle");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(toggle_row),
+                              "Switch inside the keymap, without running "
+                              "hyprctl");
+  adw_combo_row_set_model(ADW_COMBO_ROW(toggle_row),
+                          G_LIST_MODEL(toggle_list));
+  adw_combo_row_set_enable_search(ADW_COMBO_ROW(toggle_row), TRUE);
+  adw_combo_row_set_selected(ADW_COMBO_ROW(toggle_row), toggle_selected);
+  g_signal_connect(toggle_row, "notify::selected",
+                   G_CALLBACK(on_layout_toggle_changed), nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group), toggle_row);
+
+  const char *modifier_options[] = {"Super",    "Alt",         "Ctrl",
+                                    "Shift",    "Super+Shift", "Alt+Shift",
+                                    "Ctrl+Alt", "Super+Alt",   nullptr};
+  GtkStringList *mod_list = gtk_string_list_new(modifier_options);
+  GtkWidget *mod_row = adw_combo_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(mod_row), "Modifier");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(mod_row),
+                              "Key modifier for shortcut");
+  adw_combo_row_set_model(ADW_COMBO_ROW(mod_row), G_LIST_MODEL(mod_list));
+  g_signal_connect(mod_row, "notify::selected", G_CALLBACK(on_modifier_changed),
+                   nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group), mod_row);
+
+  GtkWidget *key_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(key_row), "Key");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(key_row),
+                              "Key to press (e.g., Space, Tab, grave)");
+  layout_switch_key_entry = gtk_entry_new();
+  gtk_entry_set_placeholder_text(GTK_ENTRY(layout_switch_key_entry), "Space");
+  gtk_widget_set_size_request(layout_switch_key_entry, 120, -1);
+  gtk_widget_set_valign(layout_switch_key_entry, GTK_ALIGN_CENTER);
+  adw_action_row_add_suffix(ADW_ACTION_ROW(key_row), layout_switch_key_entry);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group), key_row);
+
+  GtkWidget *apply_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(apply_row),
+                                "Apply Keybind");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(apply_row),
+                              "Set the keyboard layout switch shortcut");
+  gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(apply_row), TRUE);
+  GtkWidget *apply_icon = gtk_image_new_from_icon_name("emblem-ok-symbolic");
+  adw_action_row_add_suffix(ADW_ACTION_ROW(apply_row), apply_icon);
+  g_signal_connect(apply_row, "activated", G_CALLBACK(on_apply_keybind_clicked),
+                   nullptr);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group), apply_row);
+
+  layout_keybind_rows = {mod_row, key_row, apply_row};
+  for (GtkWidget *keybind_row : layout_keybind_rows)
+    gtk_widget_set_sensitive(keybind_row, toggle_selected == 0);
+
+  layout_probe.row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(layout_probe.row),
+                                "Switch Latency");
+  layout_probe.button = gtk_button_new_with_label("Measure");
+  gtk_widget_set_valign(layout_probe.button, GTK_ALIGN_CENTER);
+  g_signal_connect(layout_probe.button, "clicked",
+                   G_CALLBACK(on_measure_layout_switch), nullptr);
+  adw_action_row_add_suffix(ADW_ACTION_ROW(layout_probe.row),
+                            layout_probe.button);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group),
+                            layout_probe.row);
+  update_layout_probe_row();
+
+  GtkEventController *probe_keys = gtk_event_controller_key_new();
+  gtk_event_controller_set_propagation_phase(probe_keys, GTK_PHASE_CAPTURE);
+  g_signal_connect(probe_keys, "key-pressed",
+                   G_CALLBACK(on_layout_probe_key_pressed), nullptr);
+  gtk_widget_add_controller(page, probe_keys);
+
+  keybinds_list_box = gtk_list_box_new();
+  gtk_widget_add_css_class(keybinds_list_box, "boxed-list");
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(keybinds_list_box),
+                                  GTK_SELECTION_NONE);
+  refresh_keybinds_list(); 
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group),
+                            keybinds_list_box);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(keybind_group));
+
+  GtkWidget *repeat_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(repeat_group),
+                                  "Key Repeat");
+
+  GtkWidget *rate_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(rate_row), "Repeat Rate");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(rate_row),
+                              "Keys per second when held");
+  GtkWidget *rate_scale =
+      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 10, 100, 5);
+  gtk_scale_set_draw_value(GTK_SCALE(rate_scale), TRUE);
+  gtk_scale_set_value_pos(GTK_SCALE(rate_scale), GTK_POS_LEFT);
+  gtk_range_set_value(GTK_RANGE(rate_scale),
+                      get_int_option("input:repeat_rate", 25));
+  gtk_widget_set_size_request(rate_scale, 180, -1);
+  gtk_widget_set_valign(rate_scale, GTK_ALIGN_CENTER);
+  g_signal_connect(rate_scale, "value-changed",
+                   G_CALLBACK(on_repeat_rate_changed), nullptr);
+  bind_option("input:repeat_rate", BINDING_RANGE, rate_scale);
+  adw_action_row_add_suffix(ADW_ACTION_ROW(rate_row), rate_scale);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(repeat_group), rate_row);
+
+  GtkWidget *delay_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(delay_row), "Repeat Delay");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(delay_row),
+                              "Milliseconds before repeat starts");
+  GtkWidget *delay_scale =
+      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 100, 1000, 50);
+  gtk_scale_set_draw_value(GTK_SCALE(delay_scale), TRUE);
+  gtk_scale_set_value_pos(GTK_SCALE(delay_scale), GTK_POS_LEFT);
+  gtk_range_set_value(GTK_RANGE(delay_scale),
+                      get_int_option("input:repeat_delay", 600));
+  gtk_widget_set_size_request(delay_scale, 180, -1);
+  gtk_widget_set_valign(delay_scale, GTK_ALIGN_CENTER);
+  g_signal_connect(delay_scale, "value-changed",
+                   G_CALLBACK(on_repeat_delay_changed), nullptr);
+  bind_option("input:repeat_delay", BINDING_RANGE, delay_scale);
+  adw_action_row_add_suffix(ADW_ACTION_ROW(delay_row), delay_scale);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(repeat_group), delay_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(repeat_group),
+                            create_key_repeat_tester(rate_scale, delay_scale));
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(repeat_group));
+
+  GtkWidget *options_group = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(options_group),
+                                  "Options");
+
+  GtkWidget *numlock_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(numlock_row),
+                                "Numlock by Default");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(numlock_row),
+                              "Enable numlock on startup");
+  g_signal_connect(numlock_row, "notify::active",
+                   G_CALLBACK(on_numlock_by_default_changed), nullptr);
+  bind_option("input:numlock_by_default", BINDING_SWITCH, numlock_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(options_group), numlock_row);
+
+  GtkWidget *binds_sym_row = adw_switch_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(binds_sym_row),
+                                "Resolve Binds by Symbol");
+  adw_action_row_set_subtitle(ADW_ACTION_ROW(binds_sym_row),
+                              "Use keysym instead of keycode");
+  g_signal_connect(binds_sym_row, "notify::active",
+                   G_CALLBACK(on_resolve_binds_by_sym_changed), nullptr);
+  bind_option("input:resolve_binds_by_sym", BINDING_SWITCH, binds_sym_row);
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(options_group),
+                            binds_sym_row);
+
+  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
+                           ADW_PREFERENCES_GROUP(options_group));
+
+  return page;
+}
+
+struct MonitorInfo {
+  std::string name;
+  std::string description;
+  int width = 0;
+  int height = 0;
+  double refresh = 0;
+  double scale = 1;
+  int x = 0;
+  int y = 0;
+  int transform = 0;
+  std::vector<std::string> modes;
+};
+
+// `applied` is what Hyprland reports; edits go to `pending` until Apply.
+struct MonitorPage {
+  std::vector<MonitorInfo> applied;
+  std::vector<MonitorInfo> pending;
+  GtkWidget *page = nullptr;
+  GtkWidget *canvas = nullptr;
+  GtkWidget *apply_button = nullptr;
+  GtkWidget *reset_button = nullptr;
+  std::vector<GtkWidget *> groups;
+  std::vector<GtkWidget *> position_rows;
+  int selected = -1;
+  bool dragging = false;
+  double view_scale = 1;
+  double view_x = 0;
+  double view_y = 0;
+  int drag_x = 0;
+  int drag_y = 0;
+  AdwDialog *confirm = nullptr;
+  guint confirm_source = 0;
+  int confirm_remaining = 0;
+  std::string revert_batch;
+};
 
-  GtkWidget *hide_on_key_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(hide_on_key_row),
-                                "Hide on Key Press");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(hide_on_key_row),
-                              "Hide cursor when typing");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(hide_on_key_row),
-                            get_bool_option("cursor:hide_on_key_press", false));
-  g_signal_connect(hide_on_key_row, "notify::active",
-                   G_CALLBACK(on_cursor_hide_on_key_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
-                            hide_on_key_row);
+static MonitorPage monitor_page;
 
-  GtkWidget *hide_on_touch_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(hide_on_touch_row),
-                                "Hide on Touch");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(hide_on_touch_row),
-                              "Hide cursor when touching screen");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(hide_on_touch_row),
-                            get_bool_option("cursor:hide_on_touch", false));
-  g_signal_connect(hide_on_touch_row, "notify::active",
-                   G_CALLBACK(on_cursor_hide_on_touch_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(cursor_group),
-                            hide_on_touch_row);
+// Modes are written and parsed independently of the user's locale, which
+// could otherwise turn the refresh rate into "59,95" and break the rule.
+static std::string monitor_mode(const MonitorInfo &monitor) {
+  std::ostringstream mode;
+  mode.imbue(std::locale::classic());
+  mode << monitor.width << "x" << monitor.height << "@" << std::fixed
+       << std::setprecision(2) << monitor.refresh;
+  return mode.str();
+}
+
+static bool parse_monitor_mode(const std::string &mode, MonitorInfo &monitor) {
+  char *end = nullptr;
+  gint64 width = g_ascii_strtoll(mode.c_str(), &end, 10);
+  if (*end != 'x')
+    return false;
+  gint64 height = g_ascii_strtoll(end + 1, &end, 10);
+  if (*end != '@')
+    return false;
+  double refresh = g_ascii_strtod(end + 1, &end);
+  if (*end != '\0' || width <= 0 || height <= 0)
+    return false;
+  monitor.width = static_cast<int>(width);
+  monitor.height = static_cast<int>(height);
+  monitor.refresh = refresh;
+  return true;
+}
+
+static std::string monitor_rule(const MonitorInfo &monitor) {
+  std::ostringstream rule;
+  rule.imbue(std::locale::classic());
+  rule << monitor.name << "," << monitor_mode(monitor) << "," << monitor.x
+       << "x" << monitor.y << "," << monitor.scale;
+  if (monitor.transform != 0)
+    rule << ",transform," << monitor.transform;
+  return rule.str();
+}
+
+static double monitor_logical_width(const MonitorInfo &monitor) {
+  return (monitor.transform % 2 ? monitor.height : monitor.width) /
+         monitor.scale;
+}
+
+static double monitor_logical_height(const MonitorInfo &monitor) {
+  return (monitor.transform % 2 ? monitor.width : monitor.height) /
+         monitor.scale;
+}
+
+static std::vector<MonitorInfo> parse_monitors(const std::string &output) {
+  std::vector<MonitorInfo> monitors;
+  JsonParser *parser = json_parser_new();
+  if (!json_parser_load_from_data(parser, output.c_str(), output.size(),
+                                  nullptr) ||
+      !JSON_NODE_HOLDS_ARRAY(json_parser_get_root(parser))) {
+    g_object_unref(parser);
+    return monitors;
+  }
+  JsonArray *array = json_node_get_array(json_parser_get_root(parser));
+  for (guint i = 0; i < json_array_get_length(array); ++i) {
+    JsonObject *obj = json_array_get_object_element(array, i);
+    MonitorInfo monitor;
+    monitor.name = json_object_get_string_member_with_default(obj, "name", "");
+    monitor.description =
+        json_object_get_string_member_with_default(obj, "description", "");
+    monitor.width = json_object_get_int_member_with_default(obj, "width", 0);
+    monitor.height = json_object_get_int_member_with_default(obj, "height", 0);
+    monitor.refresh =
+        json_object_get_double_member_with_default(obj, "refreshRate", 60);
+    monitor.scale = json_object_get_double_member_with_default(obj, "scale", 1);
+    monitor.x = json_object_get_int_member_with_default(obj, "x", 0);
+    monitor.y = json_object_get_int_member_with_default(obj, "y", 0);
+    monitor.transform =
+        json_object_get_int_member_with_default(obj, "transform", 0);
+    JsonArray *modes =
+        json_object_has_member(obj, "availableModes")
+            ? json_object_get_array_member(obj, "availableModes")
+            : nullptr;
+    for (guint m = 0; modes && m < json_array_get_length(modes); ++m) {
+      std::string mode = json_array_get_string_element(modes, m);
+      if (mode.size() > 2 && mode.compare(mode.size() - 2, 2, "Hz") == 0)
+        mode.resize(mode.size() - 2);
+      monitor.modes.push_back(mode);
+    }
+    if (!monitor.name.empty() && monitor.scale > 0)
+      monitors.push_back(std::move(monitor));
+  }
+  g_object_unref(parser);
+  return monitors;
+}
+
+static void update_monitor_controls() {
+  bool dirty = false;
+  for (size_t i = 0; i < monitor_page.pending.size(); ++i) {
+    dirty = dirty || monitor_rule(monitor_page.pending[i]) !=
+                         monitor_rule(monitor_page.applied[i]);
+    std::string position = std::to_string(monitor_page.pending[i].x) + ", " +
+                           std::to_string(monitor_page.pending[i].y);
+    adw_action_row_set_subtitle(ADW_ACTION_ROW(monitor_page.position_rows[i]),
+                                position.c_str());
+  }
+  gtk_widget_set_sensitive(monitor_page.apply_button, dirty);
+  gtk_widget_set_sensitive(monitor_page.reset_button, dirty);
+  gtk_widget_queue_draw(monitor_page.canvas);
+}
+
+static void on_monitor_mode_changed(GObject *row, GParamSpec *,
+                                    gpointer user_data) {
+  INSTRUMENT_SCOPE(__func__);
+  MonitorInfo &monitor = monitor_page.pending[GPOINTER_TO_UINT(user_data)];
+  guint selected = adw_combo_row_get_selected(ADW_COMBO_ROW(row));
+  if (selected >= monitor.modes.size() ||
+      !parse_monitor_mode(monitor.modes[selected], monitor))
+    return;
+  update_monitor_controls();
+}
+
+static void on_monitor_scale_changed(GObject *row, GParamSpec *,
+                                     gpointer user_data) {
+  INSTRUMENT_SCOPE(__func__);
+  monitor_page.pending[GPOINTER_TO_UINT(user_data)].scale =
+      adw_spin_row_get_value(ADW_SPIN_ROW(row));
+  update_monitor_controls();
+}
+
+static void on_monitor_rotation_changed(GObject *row, GParamSpec *,
+                                        gpointer user_data) {
+  INSTRUMENT_SCOPE(__func__);
+  MonitorInfo &monitor = monitor_page.pending[GPOINTER_TO_UINT(user_data)];
+  // Keep the flip bit of transforms 4-7.
+  monitor.transform = (monitor.transform & 4) |
+                      adw_combo_row_get_selected(ADW_COMBO_ROW(row));
+  update_monitor_controls();
+}
+
+static void rebuild_monitor_groups() {
+  for (GtkWidget *group : monitor_page.groups)
+    adw_preferences_page_remove(ADW_PREFERENCES_PAGE(monitor_page.page),
+                                ADW_PREFERENCES_GROUP(group));
+  monitor_page.groups.clear();
+  monitor_page.position_rows.clear();
+
+  const char *rotations[] = {"Normal", "90°", "180°", "270°", nullptr};
+  for (size_t i = 0; i < monitor_page.pending.size(); ++i) {
+    const MonitorInfo &monitor = monitor_page.pending[i];
+    gpointer index = GUINT_TO_POINTER(i);
+    GtkWidget *group = adw_preferences_group_new();
+    adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(group),
+                                    monitor.name.c_str());
+    adw_preferences_group_set_description(ADW_PREFERENCES_GROUP(group),
+                                          monitor.description.c_str());
+
+    GtkStringList *mode_list = gtk_string_list_new(nullptr);
+    guint mode_selected = GTK_INVALID_LIST_POSITION;
+    std::string current = monitor_mode(monitor);
+    for (size_t m = 0; m < monitor.modes.size(); ++m) {
+      gtk_string_list_append(mode_list, (monitor.modes[m] + " Hz").c_str());
+      if (monitor.modes[m] == current)
+        mode_selected = m;
+    }
+    GtkWidget *mode_row = adw_combo_row_new();
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(mode_row), "Mode");
+    adw_combo_row_set_model(ADW_COMBO_ROW(mode_row), G_LIST_MODEL(mode_list));
+    adw_combo_row_set_selected(ADW_COMBO_ROW(mode_row), mode_selected);
+    g_signal_connect(mode_row, "notify::selected",
+                     G_CALLBACK(on_monitor_mode_changed), index);
+    adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), mode_row);
+
+    GtkWidget *scale_row = adw_spin_row_new_with_range(0.5, 3, 0.25);
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(scale_row), "Scale");
+    adw_spin_row_set_digits(ADW_SPIN_ROW(scale_row), 2);
+    adw_spin_row_set_value(ADW_SPIN_ROW(scale_row), monitor.scale);
+    g_signal_connect(scale_row, "notify::value",
+                     G_CALLBACK(on_monitor_scale_changed), index);
+    adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), scale_row);
+
+    GtkWidget *rotation_row = adw_combo_row_new();
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(rotation_row),
+                                  "Rotation");
+    adw_combo_row_set_model(ADW_COMBO_ROW(rotation_row),
+                            G_LIST_MODEL(gtk_string_list_new(rotations)));
+    adw_combo_row_set_selected(ADW_COMBO_ROW(rotation_row),
+                               monitor.transform % 4);
+    g_signal_connect(rotation_row, "notify::selected",
+                     G_CALLBACK(on_monitor_rotation_changed), index);
+    adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), rotation_row);
+
+    GtkWidget *position_row = adw_action_row_new();
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(position_row),
+                                  "Position");
+    adw_preferences_group_add(ADW_PREFERENCES_GROUP(group), position_row);
+    monitor_page.position_rows.push_back(position_row);
+
+    adw_preferences_page_add(ADW_PREFERENCES_PAGE(monitor_page.page),
+                             ADW_PREFERENCES_GROUP(group));
+    monitor_page.groups.push_back(group);
+  }
+}
+
+// Unapplied edits survive a refresh for monitors that are still connected.
+static void load_monitors(const std::string &output) {
+  std::vector<MonitorInfo> monitors = parse_monitors(output);
+  std::vector<MonitorInfo> pending = monitors;
+  for (auto &monitor : pending) {
+    for (size_t i = 0; i < monitor_page.pending.size(); ++i) {
+      if (monitor_page.pending[i].name == monitor.name &&
+          monitor_rule(monitor_page.pending[i]) !=
+              monitor_rule(monitor_page.applied[i]))
+        monitor = monitor_page.pending[i];
+    }
+  }
+  monitor_page.applied = std::move(monitors);
+  monitor_page.pending = std::move(pending);
+  monitor_page.selected = -1;
+  monitor_page.dragging = false;
+  rebuild_monitor_groups();
+  update_monitor_controls();
+}
+
+static void refresh_monitors() {
+  worker_pool().submit([] {
+    std::string output = hypr_socket_request("j/monitors");
+    run_on_main([output] { load_monitors(output); });
+  });
+}
+
+static void on_monitor_event(const std::string &event, const std::string &) {
+  if (event.rfind("monitoradded", 0) == 0 ||
+      event.rfind("monitorremoved", 0) == 0 || event == "configreloaded")
+    refresh_monitors();
+}
+
+// Fits the pending layout into the canvas. Frozen while dragging so the
+// other monitors stay put under the pointer.
+static void update_monitor_view(int width, int height) {
+  if (monitor_page.dragging || monitor_page.pending.empty())
+    return;
+  double min_x = 1e9, min_y = 1e9, max_x = -1e9, max_y = -1e9;
+  for (const auto &monitor : monitor_page.pending) {
+    min_x = std::min<double>(min_x, monitor.x);
+    min_y = std::min<double>(min_y, monitor.y);
+    max_x = std::max(max_x, monitor.x + monitor_logical_width(monitor));
+    max_y = std::max(max_y, monitor.y + monitor_logical_height(monitor));
+  }
+  const double margin = 16;
+  monitor_page.view_scale =
+      std::min((width - 2 * margin) / std::max(max_x - min_x, 1.0),
+               (height - 2 * margin) / std::max(max_y - min_y, 1.0));
+  monitor_page.view_x =
+      (width - (max_x - min_x) * monitor_page.view_scale) / 2 -
+      min_x * monitor_page.view_scale;
+  monitor_page.view_y =
+      (height - (max_y - min_y) * monitor_page.view_scale) / 2 -
+      min_y * monitor_page.view_scale;
+}
+
+static void draw_monitor_canvas(GtkDrawingArea *area, cairo_t *cr, int width,
+                                int height, gpointer) {
+  GtkWidget *widget = GTK_WIDGET(area);
+  GdkRGBA color;
+  gtk_widget_get_color(widget, &color);
+  update_monitor_view(width, height);
+
+  if (monitor_page.pending.empty()) {
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.5);
+    draw_key_label(widget, cr, "No monitors found", width / 2.0, height / 2.0,
+                   14);
+    return;
+  }
+
+  double s = monitor_page.view_scale;
+  for (size_t i = 0; i < monitor_page.pending.size(); ++i) {
+    const MonitorInfo &monitor = monitor_page.pending[i];
+    double x = monitor_page.view_x + monitor.x * s;
+    double y = monitor_page.view_y + monitor.y * s;
+    double w = monitor_logical_width(monitor) * s;
+    double h = monitor_logical_height(monitor) * s;
+    bool selected = static_cast<int>(i) == monitor_page.selected;
+
+    cairo_rectangle(cr, x + 1, y + 1, w - 2, h - 2);
+    if (selected)
+      cairo_set_source_rgba(cr, 0.21, 0.52, 0.89, 0.5);
+    else
+      cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.12);
+    cairo_fill_preserve(cr);
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.6);
+    cairo_set_line_width(cr, 1);
+    cairo_stroke(cr);
+
+    cairo_set_source_rgba(cr, color.red, color.green, color.blue, 0.9);
+    draw_key_label(widget, cr, monitor.name, x + w / 2, y + h / 2,
+                   std::clamp(h * 0.15, 8.0, 14.0));
+  }
+}
+
+static void on_monitor_drag_begin(GtkGestureDrag *, double x, double y,
+                                  gpointer) {
+  monitor_page.selected = -1;
+  double s = monitor_page.view_scale;
+  for (size_t i = 0; i < monitor_page.pending.size(); ++i) {
+    const MonitorInfo &monitor = monitor_page.pending[i];
+    double left = monitor_page.view_x + monitor.x * s;
+    double top = monitor_page.view_y + monitor.y * s;
+    if (x >= left && x < left + monitor_logical_width(monitor) * s &&
+        y >= top && y < top + monitor_logical_height(monitor) * s) {
+      monitor_page.selected = i;
+      monitor_page.drag_x = monitor.x;
+      monitor_page.drag_y = monitor.y;
+      monitor_page.dragging = true;
+    }
+  }
+  gtk_widget_queue_draw(monitor_page.canvas);
+}
+
+static void on_monitor_drag_update(GtkGestureDrag *, double dx, double dy,
+                                   gpointer) {
+  if (!monitor_page.dragging)
+    return;
+  MonitorInfo &monitor = monitor_page.pending[monitor_page.selected];
+  monitor.x = monitor_page.drag_x + std::lround(dx / monitor_page.view_scale);
+  monitor.y = monitor_page.drag_y + std::lround(dy / monitor_page.view_scale);
+  update_monitor_controls();
+}
+
+// Snaps each axis to the nearest edge of another monitor within range.
+static int snap_monitor_axis(int value, double size,
+                             const std::vector<double> &edges,
+                             double range) {
+  double best = value;
+  double best_distance = range;
+  for (double edge : edges) {
+    for (double candidate : {edge, edge - size}) {
+      double distance = std::abs(candidate - value);
+      if (distance < best_distance) {
+        best = candidate;
+        best_distance = distance;
+      }
+    }
+  }
+  return std::lround(best);
+}
+
+static void on_monitor_drag_end(GtkGestureDrag *, double, double, gpointer) {
+  if (!monitor_page.dragging)
+    return;
+  monitor_page.dragging = false;
+  MonitorInfo &monitor = monitor_page.pending[monitor_page.selected];
+  std::vector<double> x_edges, y_edges;
+  for (size_t i = 0; i < monitor_page.pending.size(); ++i) {
+    if (static_cast<int>(i) == monitor_page.selected)
+      continue;
+    const MonitorInfo &other = monitor_page.pending[i];
+    x_edges.push_back(other.x);
+    x_edges.push_back(other.x + monitor_logical_width(other));
+    y_edges.push_back(other.y);
+    y_edges.push_back(other.y + monitor_logical_height(other));
+  }
+  double range = 24 / monitor_page.view_scale;
+  monitor.x = snap_monitor_axis(monitor.x, monitor_logical_width(monitor),
+                                x_edges, range);
+  monitor.y = snap_monitor_axis(monitor.y, monitor_logical_height(monitor),
+                                y_edges, range);
+  update_monitor_controls();
+}
+
+static std::string monitor_batch(const std::vector<std::string> &rules) {
+  std::string batch = "[[BATCH]]";
+  for (size_t i = 0; i < rules.size(); ++i)
+    batch += (i > 0 ? ";keyword monitor " : "keyword monitor ") + rules[i];
+  return batch;
+}
+
+static void finish_monitor_confirm(bool keep) {
+  if (monitor_page.confirm_source) {
+    g_source_remove(monitor_page.confirm_source);
+    monitor_page.confirm_source = 0;
+  }
+  if (monitor_page.revert_batch.empty())
+    return;
+  std::string revert = std::move(monitor_page.revert_batch);
+  monitor_page.revert_batch.clear();
+  if (keep) {
+    monitor_page.applied = monitor_page.pending;
+    refresh_monitors();
+  } else {
+    monitor_page.pending = monitor_page.applied;
+    dispatch_hyprctl(revert, [](bool) { refresh_monitors(); });
+  }
+  update_monitor_controls();
+}
+
+static void on_monitor_confirm_response(AdwAlertDialog *, const char *response,
+                                        gpointer) {
+  finish_monitor_confirm(std::strcmp(response, "keep") == 0);
+  monitor_page.confirm = nullptr;
+}
+
+static void update_monitor_confirm_body() {
+  std::string body = "The previous settings will be restored in " +
+                     std::to_string(monitor_page.confirm_remaining) +
+                     " seconds.";
+  adw_alert_dialog_set_body(ADW_ALERT_DIALOG(monitor_page.confirm),
+                            body.c_str());
+}
+
+static gboolean on_monitor_confirm_tick(gpointer) {
+  if (--monitor_page.confirm_remaining > 0) {
+    update_monitor_confirm_body();
+    return G_SOURCE_CONTINUE;
+  }
+  monitor_page.confirm_source = 0;
+  finish_monitor_confirm(false);
+  if (monitor_page.confirm)
+    adw_dialog_force_close(monitor_page.confirm);
+  monitor_page.confirm = nullptr;
+  return G_SOURCE_REMOVE;
+}
+
+static void show_monitor_confirm() {
+  monitor_page.confirm_remaining = 15;
+  monitor_page.confirm =
+      adw_alert_dialog_new("Keep Display Settings?", nullptr);
+  adw_alert_dialog_add_responses(ADW_ALERT_DIALOG(monitor_page.confirm),
+                                 "revert", "Revert", "keep", "Keep Changes",
+                                 nullptr);
+  adw_alert_dialog_set_response_appearance(
+      ADW_ALERT_DIALOG(monitor_page.confirm), "keep",
+      ADW_RESPONSE_SUGGESTED);
+  adw_alert_dialog_set_default_response(ADW_ALERT_DIALOG(monitor_page.confirm),
+                                        "keep");
+  adw_alert_dialog_set_close_response(ADW_ALERT_DIALOG(monitor_page.confirm),
+                                      "revert");
+  g_signal_connect(monitor_page.confirm, "response",
+                   G_CALLBACK(on_monitor_confirm_response), nullptr);
+  update_monitor_confirm_body();
+  monitor_page.confirm_source =
+      g_timeout_add_seconds(1, on_monitor_confirm_tick, nullptr);
+  adw_dialog_present(monitor_page.confirm, main_window);
+}
+
+// Sends one rule per changed output in a single batch, so each output is
+// mode-set at most once, then asks for confirmation before keeping it.
+static void on_apply_monitors_clicked(GtkButton *, gpointer) {
+  std::vector<std::string> rules, revert;
+  for (size_t i = 0; i < monitor_page.pending.size(); ++i) {
+    std::string rule = monitor_rule(monitor_page.pending[i]);
+    std::string previous = monitor_rule(monitor_page.applied[i]);
+    if (rule == previous)
+      continue;
+    rules.push_back(rule);
+    revert.push_back(previous);
+  }
+  if (rules.empty())
+    return;
+
+  monitor_page.revert_batch = monitor_batch(revert);
+  gtk_widget_set_sensitive(monitor_page.apply_button, FALSE);
+  dispatch_hyprctl(monitor_batch(rules), [](bool ok) {
+    if (ok) {
+      show_monitor_confirm();
+    } else {
+      monitor_page.revert_batch.clear();
+      refresh_monitors();
+    }
+  });
+}
+
+static void on_reset_monitors_clicked(GtkButton *, gpointer) {
+  monitor_page.pending = monitor_page.applied;
+  monitor_page.selected = -1;
+  rebuild_monitor_groups();
+  update_monitor_controls();
+}
+
+static GtkWidget *create_monitors_page() {
+  INSTRUMENT_SCOPE(__func__);
+  GtkWidget *page = adw_preferences_page_new();
+  adw_preferences_page_set_title(ADW_PREFERENCES_PAGE(page), "Monitors");
+  adw_preferences_page_set_icon_name(ADW_PREFERENCES_PAGE(page),
+                                     "video-display-symbolic");
+  monitor_page.page = page;
+
+  GtkWidget *arrangement = adw_preferences_group_new();
+  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(arrangement),
+                                  "Arrangement");
+  adw_preferences_group_set_description(
+      ADW_PREFERENCES_GROUP(arrangement),
+      "Drag monitors to position them. Changes apply together.");
+
+  GtkWidget *buttons = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+  monitor_page.reset_button = gtk_button_new_with_label("Reset");
+  g_signal_connect(monitor_page.reset_button, "clicked",
+                   G_CALLBACK(on_reset_monitors_clicked), nullptr);
+  gtk_box_append(GTK_BOX(buttons), monitor_page.reset_button);
+  monitor_page.apply_button = gtk_button_new_with_label("Apply");
+  gtk_widget_add_css_class(monitor_page.apply_button, "suggested-action");
+  g_signal_connect(monitor_page.apply_button, "clicked",
+                   G_CALLBACK(on_apply_monitors_clicked), nullptr);
+  gtk_box_append(GTK_BOX(buttons), monitor_page.apply_button);
+  gtk_widget_set_valign(buttons, GTK_ALIGN_CENTER);
+  adw_preferences_group_set_header_suffix(ADW_PREFERENCES_GROUP(arrangement),
+                                          buttons);
+
+  monitor_page.canvas = gtk_drawing_area_new();
+  gtk_widget_set_size_request(monitor_page.canvas, -1, 220);
+  gtk_widget_add_css_class(monitor_page.canvas, "card");
+  gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(monitor_page.canvas),
+                                 draw_monitor_canvas, nullptr, nullptr);
+  GtkGesture *drag = gtk_gesture_drag_new();
+  g_signal_connect(drag, "drag-begin", G_CALLBACK(on_monitor_drag_begin),
+                   nullptr);
+  g_signal_connect(drag, "drag-update", G_CALLBACK(on_monitor_drag_update),
+                   nullptr);
+  g_signal_connect(drag, "drag-end", G_CALLBACK(on_monitor_drag_end),
+                   nullptr);
+  gtk_widget_add_controller(monitor_page.canvas, GTK_EVENT_CONTROLLER(drag));
+  adw_preferences_group_add(ADW_PREFERENCES_GROUP(arrangement),
+                            monitor_page.canvas);
 
   adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(cursor_group));
+                           ADW_PREFERENCES_GROUP(arrangement));
+
+  update_monitor_controls();
+  refresh_monitors();
+  return page;
+}
+
+struct OptionDescription {
+  std::string key;
+  std::string description;
+  int type = 0;
+  std::string default_value;
+  std::string current_value;
+  std::string range;
+  std::string haystack;
+  bool modified = false;
+};
+
+static const char *option_type_names[] = {"bool",   "int",    "float",
+                                          "string", "string", "color",
+                                          "choice", "gradient", "vector"};
+
+static std::vector<OptionDescription> option_descriptions;
+static std::unordered_map<std::string, size_t> option_description_index;
+static GtkCustomFilter *all_options_filter = nullptr;
+static GtkStringList *all_options_keys = nullptr;
+static std::vector<std::string> all_options_query;
+static std::string all_options_query_text;
+static bool all_options_modified_only = false;
+static bool all_options_loaded = false;
+static GtkWidget *all_options_search_entry = nullptr;
+
+static void search_index_add_all_options();
+
+static std::string normalize_option_value(int type, const std::string &value) {
+  if (type == 0) {
+    bool on = !value.empty() && value != "0" && value != "false";
+    return on ? "true" : "false";
+  }
+  return value;
+}
+
+static bool option_values_differ(int type, const std::string &a,
+                                 const std::string &b) {
+  if (type == 2) {
+    char *end_a = nullptr;
+    char *end_b = nullptr;
+    double da = std::strtod(a.c_str(), &end_a);
+    double db = std::strtod(b.c_str(), &end_b);
+    if (end_a != a.c_str() && end_b != b.c_str())
+      return std::abs(da - db) > 1e-6;
+  }
+  return normalize_option_value(type, a) != normalize_option_value(type, b);
+}
+
+// Parsed on a worker; current values are filled in separately.
+static std::vector<OptionDescription>
+parse_option_descriptions(const std::string &output) {
+  std::vector<OptionDescription> descriptions;
+  JsonParser *parser = json_parser_new();
+  if (output.empty() ||
+      !json_parser_load_from_data(parser, output.c_str(), output.size(),
+                                  nullptr) ||
+      !JSON_NODE_HOLDS_ARRAY(json_parser_get_root(parser))) {
+    g_object_unref(parser);
+    return descriptions;
+  }
+
+  JsonArray *array = json_node_get_array(json_parser_get_root(parser));
+  guint count = json_array_get_length(array);
+  descriptions.reserve(count);
+
+  for (guint i = 0; i < count; ++i) {
+    JsonObject *obj = json_array_get_object_element(array, i);
+    if (!obj)
+      continue;
+
+    OptionDescription desc;
+    desc.key = json_object_get_string_member_with_default(obj, "value", "");
+    if (desc.key.empty())
+      continue;
+    desc.description =
+        json_object_get_string_member_with_default(obj, "description", "");
+    desc.type = json_object_get_int_member_with_default(obj, "type", 3);
+
+    if (json_object_has_member(obj, "data")) {
+      JsonObject *data = json_object_get_object_member(obj, "data");
+      if (data) {
+        if (json_object_has_member(data, "value"))
+          desc.default_value =
+              stringify_json_node(json_object_get_member(data, "value"));
+        else if (json_object_has_member(data, "firstIndex"))
+          desc.default_value =
+              stringify_json_node(json_object_get_member(data, "firstIndex"));
+        if (json_object_has_member(data, "min") &&
+            json_object_has_member(data, "max"))
+          desc.range =
+              stringify_json_node(json_object_get_member(data, "min")) +
+              " – " + stringify_json_node(json_object_get_member(data, "max"));
+        else if (json_object_has_member(data, "choices"))
+          desc.range =
+              stringify_json_node(json_object_get_member(data, "choices"));
+        if (json_object_has_member(data, "current"))
+          desc.current_value =
+              stringify_json_node(json_object_get_member(data, "current"));
+      }
+    }
+
+    desc.haystack = desc.key + " " + desc.description;
+    std::transform(desc.haystack.begin(), desc.haystack.end(),
+                   desc.haystack.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    descriptions.push_back(std::move(desc));
+  }
+  g_object_unref(parser);
+  return descriptions;
+}
+
+struct FetchedOptionValue {
+  std::string key;
+  OptionValueType type;
+  std::string value;
+};
+
+// One batched getoption for every key. Runs on a worker.
+static std::vector<FetchedOptionValue>
+fetch_option_values(const std::vector<std::string> &keys) {
+  std::vector<FetchedOptionValue> values;
+  std::string batch;
+  for (const auto &key : keys) {
+    if (!batch.empty())
+      batch += ";";
+    batch += "j/getoption " + key;
+  }
+  if (batch.empty())
+    return values;
+
+  for (const auto &reply :
+       split_json_objects(hypr_socket_request("[[BATCH]]" + batch))) {
+    JsonParser *parser = json_parser_new();
+    if (json_parser_load_from_data(parser, reply.c_str(), reply.size(),
+                                   nullptr) &&
+        JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser))) {
+      JsonObject *obj = json_node_get_object(json_parser_get_root(parser));
+      const char *key =
+          json_object_get_string_member_with_default(obj, "option", "");
+      for (const char *member : {"int", "float", "str", "custom", "vec2"}) {
+        if (json_object_has_member(obj, member)) {
+          values.push_back(
+              {key,
+               g_str_equal(member, "int")     ? OPTION_INT
+               : g_str_equal(member, "float") ? OPTION_FLOAT
+               : g_str_equal(member, "vec2")  ? OPTION_VEC2
+                                              : OPTION_STRING,
+               stringify_json_node(json_object_get_member(obj, member))});
+          break;
+        }
+      }
+    }
+    g_object_unref(parser);
+  }
+  return values;
+}
+
+static void update_option_modified(OptionDescription &desc) {
+  desc.modified = !desc.current_value.empty() &&
+                  option_values_differ(desc.type, desc.current_value,
+                                       desc.default_value);
+}
+
+// Splicing the same keys back makes the list view rebind the rows, so
+// the value labels and "modified" markers are redrawn.
+static void refresh_all_options_rows(guint position, guint count) {
+  std::vector<const char *> keys;
+  keys.reserve(count + 1);
+  for (guint i = position; i < position + count; ++i)
+    keys.push_back(option_descriptions[i].key.c_str());
+  keys.push_back(nullptr);
+  guint removed = std::min<guint>(
+      count, g_list_model_get_n_items(G_LIST_MODEL(all_options_keys)) -
+                 position);
+  gtk_string_list_splice(all_options_keys, position, removed, keys.data());
+}
+
+static void apply_option_values(const std::vector<FetchedOptionValue> &values) {
+  for (const auto &fetched : values) {
+    auto it = option_description_index.find(fetched.key);
+    if (it == option_description_index.end())
+      continue;
+    option_descriptions[it->second].current_value = fetched.value;
+    option_cache_fill(fetched.key, fetched.type, fetched.value);
+  }
+  for (auto &desc : option_descriptions)
+    update_option_modified(desc);
+}
+
+static void load_option_descriptions() {
+  worker_pool().submit([] {
+    auto descriptions =
+        parse_option_descriptions(hypr_socket_request("j/descriptions"));
+    std::vector<std::string> keys;
+    for (const auto &desc : descriptions)
+      keys.push_back(desc.key);
+    auto values = fetch_option_values(keys);
+    run_on_main([descriptions = std::move(descriptions),
+                 values = std::move(values)]() mutable {
+      option_descriptions = std::move(descriptions);
+      option_description_index.clear();
+      for (size_t i = 0; i < option_descriptions.size(); ++i)
+        option_description_index[option_descriptions[i].key] = i;
+      apply_option_values(values);
+      refresh_all_options_rows(0, option_descriptions.size());
+      search_index_add_all_options();
+    });
+  });
+}
+
+// After a config reload every value may have changed.
+static void reload_all_option_values() {
+  if (option_descriptions.empty())
+    return;
+  std::vector<std::string> keys;
+  for (const auto &desc : option_descriptions)
+    keys.push_back(desc.key);
+  worker_pool().submit([keys] {
+    auto values = fetch_option_values(keys);
+    run_on_main([values] {
+      apply_option_values(values);
+      refresh_all_options_rows(0, option_descriptions.size());
+      gtk_filter_changed(GTK_FILTER(all_options_filter),
+                         GTK_FILTER_CHANGE_DIFFERENT);
+    });
+  });
+}
+
+// Called for the app's own writes once the compositor confirms them.
+static void all_options_value_written(const std::string &key,
+                                      const std::string &value) {
+  auto it = option_description_index.find(key);
+  if (it == option_description_index.end())
+    return;
+  OptionDescription &desc = option_descriptions[it->second];
+  bool was_modified = desc.modified;
+  desc.current_value = value;
+  update_option_modified(desc);
+  refresh_all_options_rows(it->second, 1);
+  if (desc.modified != was_modified)
+    gtk_filter_changed(GTK_FILTER(all_options_filter),
+                       GTK_FILTER_CHANGE_DIFFERENT);
+}
+
+static const OptionDescription *option_description_for_item(gpointer item) {
+  const char *key = gtk_string_object_get_string(GTK_STRING_OBJECT(item));
+  auto it = option_description_index.find(key ? key : "");
+  if (it == option_description_index.end())
+    return nullptr;
+  return &option_descriptions[it->second];
+}
+
+static gboolean all_options_filter_func(gpointer item, gpointer) {
+  const OptionDescription *desc = option_description_for_item(item);
+  if (!desc)
+    return FALSE;
+  if (all_options_modified_only && !desc->modified)
+    return FALSE;
+  for (const auto &token : all_options_query) {
+    if (desc->haystack.find(token) == std::string::npos)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static void on_all_options_search_changed(GtkSearchEntry *entry, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  std::string text = gtk_editable_get_text(GTK_EDITABLE(entry));
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  GtkFilterChange change = GTK_FILTER_CHANGE_DIFFERENT;
+  if (text.rfind(all_options_query_text, 0) == 0)
+    change = GTK_FILTER_CHANGE_MORE_STRICT;
+  else if (all_options_query_text.rfind(text, 0) == 0)
+    change = GTK_FILTER_CHANGE_LESS_STRICT;
+  all_options_query_text = text;
+
+  all_options_query.clear();
+  std::stringstream ss(text);
+  std::string token;
+  while (ss >> token)
+    all_options_query.push_back(token);
+
+  gtk_filter_changed(GTK_FILTER(all_options_filter), change);
+}
+
+static void on_all_options_modified_toggled(GtkToggleButton *button,
+                                            gpointer) {
+  all_options_modified_only = gtk_toggle_button_get_active(button);
+  gtk_filter_changed(GTK_FILTER(all_options_filter),
+                     all_options_modified_only ? GTK_FILTER_CHANGE_MORE_STRICT
+                                               : GTK_FILTER_CHANGE_LESS_STRICT);
+}
+
+static void on_option_item_setup(GtkSignalListItemFactory *, GObject *object,
+                                 gpointer) {
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
+  gtk_widget_set_margin_start(box, 12);
+  gtk_widget_set_margin_end(box, 12);
+  gtk_widget_set_margin_top(box, 6);
+  gtk_widget_set_margin_bottom(box, 6);
+
+  GtkWidget *header = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+  GtkWidget *key_label = gtk_label_new(nullptr);
+  gtk_label_set_xalign(GTK_LABEL(key_label), 0);
+  gtk_label_set_ellipsize(GTK_LABEL(key_label), PANGO_ELLIPSIZE_END);
+  gtk_widget_set_hexpand(key_label, TRUE);
+  gtk_widget_add_css_class(key_label, "heading");
+  gtk_box_append(GTK_BOX(header), key_label);
+
+  GtkWidget *modified_label = gtk_label_new("modified");
+  gtk_widget_add_css_class(modified_label, "accent");
+  gtk_widget_add_css_class(modified_label, "caption");
+  gtk_box_append(GTK_BOX(header), modified_label);
+
+  GtkWidget *value_label = gtk_label_new(nullptr);
+  gtk_label_set_ellipsize(GTK_LABEL(value_label), PANGO_ELLIPSIZE_END);
+  gtk_label_set_max_width_chars(GTK_LABEL(value_label), 24);
+  gtk_widget_add_css_class(value_label, "monospace");
+  gtk_box_append(GTK_BOX(header), value_label);
+  gtk_box_append(GTK_BOX(box), header);
+
+  GtkWidget *description_label = gtk_label_new(nullptr);
+  gtk_label_set_xalign(GTK_LABEL(description_label), 0);
+  gtk_label_set_wrap(GTK_LABEL(description_label), TRUE);
+  gtk_widget_add_css_class(description_label, "dim-label");
+  gtk_box_append(GTK_BOX(box), description_label);
+
+  GtkWidget *meta_label = gtk_label_new(nullptr);
+  gtk_label_set_xalign(GTK_LABEL(meta_label), 0);
+  gtk_widget_add_css_class(meta_label, "caption");
+  gtk_widget_add_css_class(meta_label, "dim-label");
+  gtk_box_append(GTK_BOX(box), meta_label);
+
+  g_object_set_data(G_OBJECT(box), "key-label", key_label);
+  g_object_set_data(G_OBJECT(box), "modified-label", modified_label);
+  g_object_set_data(G_OBJECT(box), "value-label", value_label);
+  g_object_set_data(G_OBJECT(box), "description-label", description_label);
+  g_object_set_data(G_OBJECT(box), "meta-label", meta_label);
+  gtk_list_item_set_child(GTK_LIST_ITEM(object), box);
+}
+
+static void on_option_item_bind(GtkSignalListItemFactory *, GObject *object,
+                                gpointer) {
+  GtkListItem *list_item = GTK_LIST_ITEM(object);
+  GtkWidget *box = gtk_list_item_get_child(list_item);
+  const OptionDescription *desc =
+      option_description_for_item(gtk_list_item_get_item(list_item));
+  if (!box || !desc)
+    return;
+
+  gtk_label_set_text(GTK_LABEL(g_object_get_data(G_OBJECT(box), "key-label")),
+                     desc->key.c_str());
+  gtk_label_set_text(
+      GTK_LABEL(g_object_get_data(G_OBJECT(box), "value-label")),
+      desc->current_value.c_str());
+  gtk_label_set_text(
+      GTK_LABEL(g_object_get_data(G_OBJECT(box), "description-label")),
+      desc->description.c_str());
+  gtk_widget_set_visible(
+      GTK_WIDGET(g_object_get_data(G_OBJECT(box), "modified-label")),
+      desc->modified);
+
+  std::string meta =
+      desc->type >= 0 && desc->type < 9 ? option_type_names[desc->type] : "?";
+  if (!desc->range.empty())
+    meta += " · " + desc->range;
+  meta += " · default " + desc->default_value;
+  gtk_label_set_text(GTK_LABEL(g_object_get_data(G_OBJECT(box), "meta-label")),
+                     meta.c_str());
+}
+
+static void on_all_options_mapped(GtkWidget *, gpointer) {
+  if (all_options_loaded)
+    return;
+  all_options_loaded = true;
+  // The list fills in when the worker's replies have been parsed.
+  load_option_descriptions();
+}
+
+static GtkWidget *create_all_options_page() {
+  INSTRUMENT_SCOPE(__func__);
+  GtkWidget *page = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+
+  GtkWidget *search_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+  gtk_widget_set_margin_start(search_box, 12);
+  gtk_widget_set_margin_end(search_box, 12);
+  gtk_widget_set_margin_top(search_box, 12);
+  gtk_widget_set_margin_bottom(search_box, 6);
+
+  GtkWidget *search_entry = gtk_search_entry_new();
+  all_options_search_entry = search_entry;
+  gtk_search_entry_set_placeholder_text(GTK_SEARCH_ENTRY(search_entry),
+                                        "Search options");
+  gtk_widget_set_hexpand(search_entry, TRUE);
+  g_signal_connect(search_entry, "search-changed",
+                   G_CALLBACK(on_all_options_search_changed), nullptr);
+  gtk_box_append(GTK_BOX(search_box), search_entry);
+
+  GtkWidget *modified_toggle = gtk_toggle_button_new_with_label("Modified");
+  gtk_widget_set_tooltip_text(modified_toggle,
+                              "Only show options changed from their default");
+  g_signal_connect(modified_toggle, "toggled",
+                   G_CALLBACK(on_all_options_modified_toggled), nullptr);
+  gtk_box_append(GTK_BOX(search_box), modified_toggle);
+  gtk_box_append(GTK_BOX(page), search_box);
+
+  all_options_keys = gtk_string_list_new(nullptr);
+  all_options_filter =
+      gtk_custom_filter_new(all_options_filter_func, nullptr, nullptr);
+  GtkFilterListModel *filtered = gtk_filter_list_model_new(
+      G_LIST_MODEL(all_options_keys), GTK_FILTER(all_options_filter));
+  GtkNoSelection *selection = gtk_no_selection_new(G_LIST_MODEL(filtered));
+
+  GtkListItemFactory *factory = gtk_signal_list_item_factory_new();
+  g_signal_connect(factory, "setup", G_CALLBACK(on_option_item_setup),
+                   nullptr);
+  g_signal_connect(factory, "bind", G_CALLBACK(on_option_item_bind), nullptr);
+
+  GtkWidget *list_view =
+      gtk_list_view_new(GTK_SELECTION_MODEL(selection), factory);
+  gtk_list_view_set_show_separators(GTK_LIST_VIEW(list_view), TRUE);
+
+  GtkWidget *scrolled = gtk_scrolled_window_new();
+  gtk_widget_set_vexpand(scrolled, TRUE);
+  gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), list_view);
+  gtk_box_append(GTK_BOX(page), scrolled);
+
+  g_signal_connect(page, "map", G_CALLBACK(on_all_options_mapped), nullptr);
+
+  return page;
+}
+
+static void host_apply(const char *command) {
+  INSTRUMENT_SCOPE(__func__);
+  execute_hyprctl(command);
+}
+
+static char *host_get_option(const char *key) {
+  return g_strdup(get_string_option(key).c_str());
+}
+
+static void host_bind(const char *key, HyprControlBindingKind kind,
+                      GtkWidget *control, const char *const *values) {
+  std::vector<std::string> items;
+  for (int i = 0; values && values[i]; ++i)
+    items.push_back(values[i]);
+  bind_option(key, static_cast<OptionBindingKind>(kind), control,
+              std::move(items));
+  // Pages load after startup, so take the snapshot staging compares to.
+  OptionBinding &binding = option_bindings.back();
+  binding.snapshot = option_binding_value(binding);
+}
+
+static const HyprControlHost page_host = {HYPR_CONTROL_PAGE_ABI, host_apply,
+                                          host_get_option, host_bind};
+
+static const HyprControlPage builtin_pages[] = {
+    {HYPR_CONTROL_PAGE_ABI, "mouse", "Mouse", "input-mouse-symbolic", nullptr,
+     [](const HyprControlHost *) { return create_mouse_page(); }},
+    {HYPR_CONTROL_PAGE_ABI, "touchpad", "Touchpad", "input-touchpad-symbolic",
+     nullptr, [](const HyprControlHost *) { return create_touchpad_page(); }},
+    {HYPR_CONTROL_PAGE_ABI, "keyboard", "Keyboard", "input-keyboard-symbolic",
+     nullptr, [](const HyprControlHost *) { return create_keyboard_page(); }},
+};
+
+// An installed page. Only its sidecar is read at startup; the shared
+// object is opened when the page is first shown.
+struct PageModule {
+  std::string name;
+  std::string title;
+  std::string icon;
+  std::string path;
+  std::vector<std::string> options;
+  bool loaded = false;
+};
+
+static std::vector<PageModule> page_modules;
+
+static std::vector<std::string> page_module_dirs() {
+  std::vector<std::string> dirs;
+  if (const char *path = std::getenv("HYPR_CONTROL_PAGE_PATH")) {
+    g_auto(GStrv) parts = g_strsplit(path, ":", -1);
+    for (int i = 0; parts[i]; ++i) {
+      if (*parts[i])
+        dirs.push_back(parts[i]);
+    }
+  }
+  dirs.push_back(std::string(g_get_user_data_dir()) + "/hypr-control/pages");
+  dirs.push_back(HYPR_CONTROL_PAGE_DIR);
+  return dirs;
+}
+
+static void discover_page_modules() {
+  for (const auto &dir : page_module_dirs()) {
+    GDir *listing = g_dir_open(dir.c_str(), 0, nullptr);
+    if (!listing)
+      continue;
+    const char *entry;
+    while ((entry = g_dir_read_name(listing))) {
+      if (!g_str_has_suffix(entry, ".page"))
+        continue;
+      std::string sidecar = dir + "/" + entry;
+      GKeyFile *file = g_key_file_new();
+      if (!g_key_file_load_from_file(file, sidecar.c_str(), G_KEY_FILE_NONE,
+                                     nullptr)) {
+        g_key_file_free(file);
+        continue;
+      }
+      g_autofree char *name =
+          g_key_file_get_string(file, "Page", "Name", nullptr);
+      g_autofree char *title =
+          g_key_file_get_string(file, "Page", "Title", nullptr);
+      g_autofree char *icon =
+          g_key_file_get_string(file, "Page", "Icon", nullptr);
+      g_autofree char *module =
+          g_key_file_get_string(file, "Page", "Module", nullptr);
+      g_auto(GStrv) options =
+          g_key_file_get_string_list(file, "Page", "Options", nullptr, nullptr);
+      g_key_file_free(file);
+
+      // Earlier directories win, so a user copy overrides a system page.
+      bool taken = !name || !title || !module;
+      for (const auto &page : builtin_pages)
+        taken = taken || (name && std::strcmp(page.name, name) == 0);
+      for (const auto &existing : page_modules)
+        taken = taken || existing.name == name;
+      if (taken)
+        continue;
+
+      PageModule page;
+      page.name = name;
+      page.title = title;
+      page.icon = icon ? icon : "application-x-addon-symbolic";
+      page.path = module[0] == '/' ? module : dir + "/" + module;
+      for (int i = 0; options && options[i]; ++i)
+        page.options.push_back(options[i]);
+      page_modules.push_back(std::move(page));
+    }
+    g_dir_close(listing);
+  }
+}
+
+static GtkWidget *page_module_error(const std::string &title,
+                                    const std::string &message) {
+  GtkWidget *status = adw_status_page_new();
+  adw_status_page_set_icon_name(ADW_STATUS_PAGE(status),
+                                "dialog-error-symbolic");
+  adw_status_page_set_title(ADW_STATUS_PAGE(status),
+                            ("Could not load " + title).c_str());
+  adw_status_page_set_description(ADW_STATUS_PAGE(status), message.c_str());
+  return status;
+}
+
+static GtkWidget *load_page_module(const PageModule &module) {
+  INSTRUMENT_SCOPE(__func__);
+  void *handle = dlopen(module.path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle)
+    return page_module_error(module.title, dlerror());
+  auto entry = reinterpret_cast<HyprControlPageEntry>(
+      dlsym(handle, HYPR_CONTROL_PAGE_SYMBOL));
+  const HyprControlPage *page = entry ? entry() : nullptr;
+  if (!page || page->abi != HYPR_CONTROL_PAGE_ABI || !page->build) {
+    dlclose(handle);
+    return page_module_error(module.title,
+                             module.path + " is not a compatible page module");
+  }
+  // The handle stays open: the page's callbacks live in it.
+  GtkWidget *widget = page->build(&page_host);
+  return widget ? widget
+                : page_module_error(module.title, "The page failed to build");
+}
+
+static void on_page_module_mapped(GtkWidget *container, gpointer user_data) {
+  PageModule &module = page_modules[GPOINTER_TO_UINT(user_data)];
+  if (module.loaded)
+    return;
+  module.loaded = true;
+  adw_bin_set_child(ADW_BIN(container), load_page_module(module));
+}
+
+static void add_page_modules(GtkWidget *view_stack) {
+  discover_page_modules();
+  for (size_t i = 0; i < page_modules.size(); ++i) {
+    const PageModule &module = page_modules[i];
+    GtkWidget *container = adw_bin_new();
+    g_signal_connect(container, "map", G_CALLBACK(on_page_module_mapped),
+                     GUINT_TO_POINTER(i));
+    adw_view_stack_add_titled_with_icon(
+        ADW_VIEW_STACK(view_stack), container, module.name.c_str(),
+        module.title.c_str(), module.icon.c_str());
+  }
+}
+
+struct SearchItem {
+  std::string title;
+  std::string context;
+  std::string key;
+  GtkWidget *row;
+  std::string page;
+};
+
+// Each trie node keeps the items that have a token with this prefix, in
+// ascending order, so a lookup is one walk plus list intersections.
+struct SearchTrieNode {
+  std::vector<std::pair<char, uint32_t>> children;
+  std::vector<uint32_t> items;
+};
+
+struct SearchIndex {
+  std::vector<SearchItem> items;
+  std::vector<SearchTrieNode> nodes = std::vector<SearchTrieNode>(1);
+  GtkWidget *bar = nullptr;
+  GtkWidget *entry = nullptr;
+  GtkWidget *results = nullptr;
+  GtkWidget *view_stack = nullptr;
+};
+
+static SearchIndex search_index;
+
+static const std::pair<const char *, const char *> search_synonyms[] = {
+    {"sensitivity", "speed fast slow"},
+    {"accel", "acceleration"},
+    {"touchpad", "trackpad"},
+    {"natural", "reverse invert"},
+    {"scroll", "wheel"},
+    {"repeat", "typematic"},
+    {"layout", "language keymap"},
+    {"numlock", "num lock"},
+    {"cursor", "pointer"},
+    {"hide", "autohide"},
+    {"swipe", "gesture"},
+    {"workspace", "desktop"},
+    {"tap", "touch"},
+    {"left", "lefty"},
+    {"focus", "hover"},
+};
+
+static std::vector<std::string> search_tokens(const std::string &text) {
+  std::vector<std::string> tokens;
+  std::string token;
+  for (unsigned char c : text) {
+    if (std::isalnum(c)) {
+      token += std::tolower(c);
+    } else if (!token.empty()) {
+      tokens.push_back(std::move(token));
+      token.clear();
+    }
+  }
+  if (!token.empty())
+    tokens.push_back(std::move(token));
+  return tokens;
+}
+
+static uint32_t search_trie_child(uint32_t node, char c, bool create) {
+  for (const auto &child : search_index.nodes[node].children) {
+    if (child.first == c)
+      return child.second;
+  }
+  if (!create)
+    return 0;
+  uint32_t id = search_index.nodes.size();
+  search_index.nodes.emplace_back();
+  search_index.nodes[node].children.emplace_back(c, id);
+  return id;
+}
 
-  return page;
+static void search_index_token(const std::string &token, uint32_t item) {
+  uint32_t node = 0;
+  for (char c : token) {
+    node = search_trie_child(node, c, true);
+    auto &items = search_index.nodes[node].items;
+    if (items.empty() || items.back() != item)
+      items.push_back(item);
+  }
 }
 
-static GtkWidget *create_touchpad_page() {
-  GtkWidget *page = adw_preferences_page_new();
-  adw_preferences_page_set_title(ADW_PREFERENCES_PAGE(page), "Touchpad");
-  adw_preferences_page_set_icon_name(ADW_PREFERENCES_PAGE(page),
-                                     "input-touchpad-symbolic");
+static void search_index_add(SearchItem item) {
+  uint32_t id = search_index.items.size();
+  for (const auto &token :
+       search_tokens(item.title + " " + item.context + " " + item.key)) {
+    search_index_token(token, id);
+    for (const auto &synonym : search_synonyms) {
+      if (token == synonym.first) {
+        for (const auto &extra : search_tokens(synonym.second))
+          search_index_token(extra, id);
+      }
+    }
+  }
+  search_index.items.push_back(std::move(item));
+}
 
-  GtkWidget *device_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(device_group),
-                                  "Device");
+static std::vector<uint32_t> search_index_query(const std::string &text) {
+  std::vector<uint32_t> result;
+  bool first = true;
+  for (const auto &token : search_tokens(text)) {
+    uint32_t node = 0;
+    for (char c : token) {
+      node = search_trie_child(node, c, false);
+      if (node == 0)
+        return {};
+    }
+    const auto &items = search_index.nodes[node].items;
+    if (first) {
+      result = items;
+      first = false;
+    } else {
+      std::vector<uint32_t> both;
+      std::set_intersection(result.begin(), result.end(), items.begin(),
+                            items.end(), std::back_inserter(both));
+      result.swap(both);
+    }
+    if (result.empty())
+      break;
+  }
+  return result;
+}
 
-  GtkWidget *touchpad_enabled_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(touchpad_enabled_row),
-                                "Touchpad Enabled");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(touchpad_enabled_row),
-                              "Enable or disable touchpad");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(touchpad_enabled_row),
-                            get_bool_option("input:touchpad:enabled", true));
-  g_signal_connect(touchpad_enabled_row, "notify::active",
-                   G_CALLBACK(on_touchpad_toggle_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(device_group),
-                            touchpad_enabled_row);
+static void collect_search_rows(GtkWidget *widget, const char *page_title,
+                                const std::unordered_map<GtkWidget *,
+                                                         std::string> &keys) {
+  for (GtkWidget *child = gtk_widget_get_first_child(widget); child;
+       child = gtk_widget_get_next_sibling(child)) {
+    const char *title =
+        ADW_IS_PREFERENCES_ROW(child)
+            ? adw_preferences_row_get_title(ADW_PREFERENCES_ROW(child))
+            : nullptr;
+    if (title && *title) {
+      std::string context = page_title;
+      if (ADW_IS_ACTION_ROW(child)) {
+        const char *subtitle =
+            adw_action_row_get_subtitle(ADW_ACTION_ROW(child));
+        if (subtitle && *subtitle)
+          context += std::string(" · ") + subtitle;
+      }
+      auto key = keys.find(child);
+      search_index_add({title, context,
+                        key != keys.end() ? key->second : std::string(),
+                        child, ""});
+    }
+    collect_search_rows(child, page_title, keys);
+  }
+}
 
-  GtkWidget *touchscreen_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(touchscreen_row),
-                                "Touchscreen Enabled");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(touchscreen_row),
-                              "Enable or disable touchscreen");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(touchscreen_row),
-                            get_bool_option("input:touchdevice:enabled", true));
-  g_signal_connect(touchscreen_row, "notify::active",
-                   G_CALLBACK(on_touchdevice_toggle_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(device_group),
-                            touchscreen_row);
+static void build_search_index(GtkWidget *view_stack) {
+  search_index.view_stack = view_stack;
+  std::unordered_map<GtkWidget *, std::string> keys;
+  for (const auto &binding : option_bindings) {
+    GtkWidget *row =
+        binding.kind == BINDING_RANGE
+            ? gtk_widget_get_ancestor(binding.control, ADW_TYPE_PREFERENCES_ROW)
+            : binding.control;
+    if (row)
+      keys[row] = binding.key;
+  }
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(device_group));
+  for (GtkWidget *child = gtk_widget_get_first_child(view_stack); child;
+       child = gtk_widget_get_next_sibling(child)) {
+    if (!ADW_IS_PREFERENCES_PAGE(child))
+      continue;
+    AdwViewStackPage *page =
+        adw_view_stack_get_page(ADW_VIEW_STACK(view_stack), child);
+    const char *title = page ? adw_view_stack_page_get_title(page) : nullptr;
+    collect_search_rows(child, title ? title : "", keys);
+  }
 
-  GtkWidget *tap_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(tap_group), "Tapping");
+  // Unloaded pages are found through their sidecar metadata.
+  for (const auto &module : page_modules) {
+    search_index_add({module.title, "Page", "", nullptr, module.name});
+    for (const auto &option : module.options)
+      search_index_add({option, module.title, option, nullptr, module.name});
+  }
+}
 
-  GtkWidget *tap_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(tap_row), "Tap to Click");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(tap_row),
-                              "Tap the touchpad to click");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(tap_row),
-      get_bool_option("input:touchpad:tap-to-click", true));
-  g_signal_connect(tap_row, "notify::active",
-                   G_CALLBACK(on_tap_to_click_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), tap_row);
+static void search_index_add_all_options() {
+  for (const auto &desc : option_descriptions)
+    search_index_add({desc.key, "All Options · " + desc.description, desc.key,
+                      nullptr, ""});
+}
 
-  GtkWidget *tap_drag_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(tap_drag_row),
-                                "Tap and Drag");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(tap_drag_row),
-                              "Tap and hold to drag");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(tap_drag_row),
-      get_bool_option("input:touchpad:tap-and-drag", true));
-  g_signal_connect(tap_drag_row, "notify::active",
-                   G_CALLBACK(on_tap_and_drag_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), tap_drag_row);
+static gboolean clear_search_match(gpointer row) {
+  gtk_widget_remove_css_class(GTK_WIDGET(row), "search-match");
+  g_object_unref(row);
+  return G_SOURCE_REMOVE;
+}
 
-  GtkWidget *drag_lock_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(drag_lock_row),
-                                "Drag Lock");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(drag_lock_row),
-                              "Continue drag after lifting finger");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(drag_lock_row),
-                            get_bool_option("input:touchpad:drag_lock", false));
-  g_signal_connect(drag_lock_row, "notify::active",
-                   G_CALLBACK(on_drag_lock_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), drag_lock_row);
+static void jump_to_search_item(const SearchItem &item) {
+  gtk_search_bar_set_search_mode(GTK_SEARCH_BAR(search_index.bar), FALSE);
+  if (!item.row && !item.page.empty()) {
+    adw_view_stack_set_visible_child_name(
+        ADW_VIEW_STACK(search_index.view_stack), item.page.c_str());
+    return;
+  }
+  if (!item.row) {
+    adw_view_stack_set_visible_child_name(
+        ADW_VIEW_STACK(search_index.view_stack), "all");
+    gtk_editable_set_text(GTK_EDITABLE(all_options_search_entry),
+                          item.key.c_str());
+    return;
+  }
 
-  const char *click_options[] = {"Button Areas", "Clickfinger", nullptr};
-  GtkStringList *click_list = gtk_string_list_new(click_options);
-  GtkWidget *click_row = adw_combo_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(click_row), "Click Method");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(click_row),
-                              "How right/middle click is detected");
-  adw_combo_row_set_model(ADW_COMBO_ROW(click_row), G_LIST_MODEL(click_list));
-  adw_combo_row_set_selected(
-      ADW_COMBO_ROW(click_row),
-      get_int_option("input:touchpad:clickfinger_behavior", 1));
-  g_signal_connect(click_row, "notify::selected",
-                   G_CALLBACK(on_clickfinger_behavior_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), click_row);
+  GtkWidget *page =
+      gtk_widget_get_ancestor(item.row, ADW_TYPE_PREFERENCES_PAGE);
+  if (page)
+    adw_view_stack_set_visible_child(ADW_VIEW_STACK(search_index.view_stack),
+                                     page);
+  GtkWidget *row = item.row;
+  // Focus once the page is mapped so its scrolled window follows the row.
+  run_on_main([row] {
+    gtk_widget_grab_focus(row);
+    gtk_widget_add_css_class(row, "search-match");
+    g_timeout_add(1500, clear_search_match, g_object_ref(row));
+  });
+}
 
-  GtkWidget *middle_emu_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(middle_emu_row),
-                                "Middle Button Emulation");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(middle_emu_row),
-                              "Press left+right for middle click");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(middle_emu_row),
-      get_bool_option("input:touchpad:middle_button_emulation", false));
-  g_signal_connect(middle_emu_row, "notify::active",
-                   G_CALLBACK(on_middle_button_emulation_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(tap_group), middle_emu_row);
+static void on_search_result_activated(GtkListBox *, GtkListBoxRow *row,
+                                       gpointer) {
+  guint id = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(row), "item"));
+  if (id < search_index.items.size()) {
+    jump_to_search_item(search_index.items[id]);
+    return;
+  }
+  gtk_search_bar_set_search_mode(GTK_SEARCH_BAR(search_index.bar), FALSE);
+  adw_view_stack_set_visible_child_name(ADW_VIEW_STACK(search_index.view_stack),
+                                        "all");
+  gtk_editable_set_text(
+      GTK_EDITABLE(all_options_search_entry),
+      gtk_editable_get_text(GTK_EDITABLE(search_index.entry)));
+}
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(tap_group));
+static void on_global_search_changed(GtkSearchEntry *entry, gpointer) {
+  INSTRUMENT_SCOPE(__func__);
+  GtkWidget *child;
+  while ((child = gtk_widget_get_first_child(search_index.results)))
+    gtk_list_box_remove(GTK_LIST_BOX(search_index.results), child);
 
-  GtkWidget *scroll_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(scroll_group),
-                                  "Scrolling");
+  std::string text = gtk_editable_get_text(GTK_EDITABLE(entry));
+  if (search_tokens(text).empty()) {
+    gtk_widget_set_visible(search_index.results, FALSE);
+    return;
+  }
 
-  GtkWidget *natural_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(natural_row),
-                                "Natural Scrolling");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(natural_row),
-                              "Content follows finger direction");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(natural_row),
-      get_bool_option("input:touchpad:natural_scroll", true));
-  g_signal_connect(natural_row, "notify::active",
-                   G_CALLBACK(on_natural_scroll_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group), natural_row);
+  std::vector<uint32_t> matches = search_index_query(text);
+  const size_t max_results = 8;
+  for (size_t i = 0; i < matches.size() && i < max_results; ++i) {
+    const SearchItem &item = search_index.items[matches[i]];
+    GtkWidget *row = adw_action_row_new();
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row),
+                                  item.title.c_str());
+    adw_action_row_set_subtitle(ADW_ACTION_ROW(row), item.context.c_str());
+    gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(row), TRUE);
+    g_object_set_data(G_OBJECT(row), "item", GUINT_TO_POINTER(matches[i]));
+    gtk_list_box_append(GTK_LIST_BOX(search_index.results), row);
+  }
 
-  GtkWidget *scroll_factor_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(scroll_factor_row),
-                                "Scroll Speed");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(scroll_factor_row),
-                              "Scroll distance multiplier");
-  GtkWidget *scroll_scale =
-      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0.1, 3.0, 0.1);
-  gtk_scale_set_draw_value(GTK_SCALE(scroll_scale), TRUE);
-  gtk_scale_set_value_pos(GTK_SCALE(scroll_scale), GTK_POS_LEFT);
-  gtk_range_set_value(GTK_RANGE(scroll_scale),
-                      get_float_option("input:touchpad:scroll_factor", 1.0));
-  gtk_widget_set_size_request(scroll_scale, 180, -1);
-  gtk_widget_set_valign(scroll_scale, GTK_ALIGN_CENTER);
-  g_signal_connect(scroll_scale, "value-changed",
-                   G_CALLBACK(on_scroll_factor_changed), nullptr);
-  adw_action_row_add_suffix(ADW_ACTION_ROW(scroll_factor_row), scroll_scale);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(scroll_group),
-                            scroll_factor_row);
+  GtkWidget *all_row = adw_action_row_new();
+  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(all_row),
+                                "Search All Options");
+  gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(all_row), TRUE);
+  g_object_set_data(G_OBJECT(all_row), "item", GUINT_TO_POINTER(G_MAXUINT));
+  adw_action_row_add_suffix(ADW_ACTION_ROW(all_row),
+                            gtk_image_new_from_icon_name("go-next-symbolic"));
+  gtk_list_box_append(GTK_LIST_BOX(search_index.results), all_row);
+  gtk_widget_set_visible(search_index.results, TRUE);
+}
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(scroll_group));
+static void on_global_search_activate(GtkSearchEntry *, gpointer) {
+  GtkListBoxRow *first =
+      gtk_list_box_get_row_at_index(GTK_LIST_BOX(search_index.results), 0);
+  if (first)
+    on_search_result_activated(GTK_LIST_BOX(search_index.results), first,
+                               nullptr);
+}
 
-  GtkWidget *behavior_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(behavior_group),
-                                  "Behavior");
+static GtkWidget *create_search_bar(GtkWidget *key_capture) {
+  search_index.bar = gtk_search_bar_new();
 
-  GtkWidget *dwt_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(dwt_row),
-                                "Disable While Typing");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(dwt_row),
-                              "Ignore touchpad while typing");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(dwt_row),
-      get_bool_option("input:touchpad:disable_while_typing", true));
-  g_signal_connect(dwt_row, "notify::active",
-                   G_CALLBACK(on_disable_while_typing_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(behavior_group), dwt_row);
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+  gtk_widget_set_size_request(box, 360, -1);
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(behavior_group));
+  search_index.entry = gtk_search_entry_new();
+  gtk_search_entry_set_placeholder_text(GTK_SEARCH_ENTRY(search_index.entry),
+                                        "Search settings");
+  g_signal_connect(search_index.entry, "search-changed",
+                   G_CALLBACK(on_global_search_changed), nullptr);
+  g_signal_connect(search_index.entry, "activate",
+                   G_CALLBACK(on_global_search_activate), nullptr);
+  gtk_box_append(GTK_BOX(box), search_index.entry);
 
-  GtkWidget *gesture_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(gesture_group),
-                                  "Gestures");
+  search_index.results = gtk_list_box_new();
+  gtk_widget_add_css_class(search_index.results, "boxed-list");
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(search_index.results),
+                                  GTK_SELECTION_NONE);
+  gtk_widget_set_visible(search_index.results, FALSE);
+  g_signal_connect(search_index.results, "row-activated",
+                   G_CALLBACK(on_search_result_activated), nullptr);
+  gtk_box_append(GTK_BOX(box), search_index.results);
+
+  gtk_search_bar_set_child(GTK_SEARCH_BAR(search_index.bar), box);
+  gtk_search_bar_connect_entry(GTK_SEARCH_BAR(search_index.bar),
+                               GTK_EDITABLE(search_index.entry));
+  gtk_search_bar_set_key_capture_widget(GTK_SEARCH_BAR(search_index.bar),
+                                        key_capture);
+
+  GtkCssProvider *css = gtk_css_provider_new();
+  gtk_css_provider_load_from_string(
+      css, "row.search-match { background-color: alpha(@accent_bg_color, "
+           "0.25); transition: background-color 300ms; }");
+  gtk_style_context_add_provider_for_display(
+      gdk_display_get_default(), GTK_STYLE_PROVIDER(css),
+      GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+  g_object_unref(css);
+
+  return search_index.bar;
+}
 
-  GtkWidget *swipe_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_row),
-                                "Workspace Swipe");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_row),
-                              "Swipe to change workspaces");
-  adw_switch_row_set_active(ADW_SWITCH_ROW(swipe_row),
-                            get_bool_option("gestures:workspace_swipe", true));
-  g_signal_connect(swipe_row, "notify::active",
-                   G_CALLBACK(on_workspace_swipe_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group), swipe_row);
+static GtkWidget *create_search_button() {
+  GtkWidget *button = gtk_toggle_button_new();
+  gtk_button_set_icon_name(GTK_BUTTON(button), "system-search-symbolic");
+  gtk_widget_set_tooltip_text(button, "Search Settings");
+  g_object_bind_property(button, "active", search_index.bar,
+                         "search-mode-enabled", G_BINDING_BIDIRECTIONAL);
+  return button;
+}
 
-  const char *fingers_options[] = {"3 Fingers", "4 Fingers", nullptr};
-  GtkStringList *fingers_list = gtk_string_list_new(fingers_options);
-  GtkWidget *fingers_row = adw_combo_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(fingers_row),
-                                "Swipe Fingers");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(fingers_row),
-                              "Number of fingers for gesture");
-  adw_combo_row_set_model(ADW_COMBO_ROW(fingers_row),
-                          G_LIST_MODEL(fingers_list));
-  adw_combo_row_set_selected(
-      ADW_COMBO_ROW(fingers_row),
-      get_int_option("gestures:workspace_swipe_fingers", 3) == 4 ? 1 : 0);
-  g_signal_connect(fingers_row, "notify::selected",
-                   G_CALLBACK(on_workspace_swipe_fingers_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group), fingers_row);
+static void on_instance_toggled(GtkCheckButton *button, gpointer) {
+  if (!gtk_check_button_get_active(button))
+    return;
+  const char *signature = static_cast<const char *>(
+      g_object_get_data(G_OBJECT(button), "signature"));
+  target_all_instances = signature == nullptr;
+  target_instance = signature ? signature : "";
+}
 
-  GtkWidget *swipe_dist_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_dist_row),
-                                "Swipe Distance");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_dist_row),
-                              "Pixels needed for workspace switch");
-  GtkWidget *dist_scale =
-      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 100, 500, 10);
-  gtk_scale_set_draw_value(GTK_SCALE(dist_scale), TRUE);
-  gtk_scale_set_value_pos(GTK_SCALE(dist_scale), GTK_POS_LEFT);
-  gtk_range_set_value(GTK_RANGE(dist_scale),
-                      get_int_option("gestures:workspace_swipe_distance", 300));
-  gtk_widget_set_size_request(dist_scale, 180, -1);
-  gtk_widget_set_valign(dist_scale, GTK_ALIGN_CENTER);
-  g_signal_connect(dist_scale, "value-changed",
-                   G_CALLBACK(on_workspace_swipe_distance_changed), nullptr);
-  adw_action_row_add_suffix(ADW_ACTION_ROW(swipe_dist_row), dist_scale);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group),
-                            swipe_dist_row);
+static void on_instance_popover_show(GtkWidget *popover, gpointer) {
+  refresh_hypr_instances();
 
-  GtkWidget *swipe_invert_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_invert_row),
-                                "Invert Swipe");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_invert_row),
-                              "Reverse swipe direction");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(swipe_invert_row),
-      get_bool_option("gestures:workspace_swipe_invert", true));
-  g_signal_connect(swipe_invert_row, "notify::active",
-                   G_CALLBACK(on_workspace_swipe_invert_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group),
-                            swipe_invert_row);
+  GtkWidget *list_box = gtk_list_box_new();
+  gtk_list_box_set_selection_mode(GTK_LIST_BOX(list_box), GTK_SELECTION_NONE);
+  gtk_widget_add_css_class(list_box, "boxed-list");
 
-  GtkWidget *swipe_forever_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(swipe_forever_row),
-                                "Continuous Swipe");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(swipe_forever_row),
-                              "Keep swiping through all workspaces");
-  adw_switch_row_set_active(
-      ADW_SWITCH_ROW(swipe_forever_row),
-      get_bool_option("gestures:workspace_swipe_forever", false));
-  g_signal_connect(swipe_forever_row, "notify::active",
-                   G_CALLBACK(on_workspace_swipe_forever_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(gesture_group),
-                            swipe_forever_row);
+  const char *own = std::getenv("HYPRLAND_INSTANCE_SIGNATURE");
+  GtkWidget *group = nullptr;
+  auto add_row = [&](const char *title, const char *subtitle,
+                     const char *signature, bool active,
+                     HyprInstance *instance) {
+    GtkWidget *row = adw_action_row_new();
+    adw_preferences_row_set_title(ADW_PREFERENCES_ROW(row), title);
+    if (subtitle)
+      adw_action_row_set_subtitle(ADW_ACTION_ROW(row), subtitle);
+
+    GtkWidget *check = gtk_check_button_new();
+    if (group)
+      gtk_check_button_set_group(GTK_CHECK_BUTTON(check),
+                                 GTK_CHECK_BUTTON(group));
+    else
+      group = check;
+    g_object_set_data_full(G_OBJECT(check), "signature",
+                           signature ? g_strdup(signature) : nullptr, g_free);
+    gtk_check_button_set_active(GTK_CHECK_BUTTON(check), active);
+    g_signal_connect(check, "toggled", G_CALLBACK(on_instance_toggled),
+                     nullptr);
+    adw_action_row_add_prefix(ADW_ACTION_ROW(row), check);
+    adw_action_row_set_activatable_widget(ADW_ACTION_ROW(row), check);
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(gesture_group));
+    if (instance) {
+      instance->status_icon = gtk_image_new_from_icon_name(
+          instance->failed ? "dialog-warning-symbolic" : nullptr);
+      adw_action_row_add_suffix(ADW_ACTION_ROW(row), instance->status_icon);
+    }
+    gtk_list_box_append(GTK_LIST_BOX(list_box), row);
+  };
+
+  add_row("All Instances", nullptr, nullptr, target_all_instances, nullptr);
+  for (auto &instance : hypr_instances) {
+    instance->status_icon = nullptr;
+    if (!instance->live)
+      continue;
+    bool is_own = own && instance->signature == own;
+    bool active = !target_all_instances &&
+                  (instance->signature == target_instance ||
+                   (target_instance.empty() && is_own));
+    add_row(instance->signature.substr(0, 8).c_str(),
+            is_own ? "This session" : instance->signature.c_str(),
+            instance->signature.c_str(), active, instance.get());
+  }
 
-  return page;
+  gtk_popover_set_child(GTK_POPOVER(popover), list_box);
 }
 
-static void load_keybind_state() {
-  current_layout_switch_bind = "";
-  std::string output =
-      exec_output("hyprctl binds | grep -B 4 'arg: hyprctl switchxkblayout'");
-  if (output.empty())
-    return;
+static GtkWidget *create_instance_button() {
+  refresh_hypr_instances();
+  instance_button = gtk_menu_button_new();
+  gtk_menu_button_set_icon_name(GTK_MENU_BUTTON(instance_button),
+                                "video-display-symbolic");
+  gtk_widget_set_tooltip_text(instance_button, "Hyprland Instances");
 
-  int modmask = 0;
-  std::string key_code;
-  std::stringstream ss(output);
-  std::string line;
+  GtkWidget *popover = gtk_popover_new();
+  gtk_widget_set_size_request(popover, 320, -1);
+  g_signal_connect(popover, "show", G_CALLBACK(on_instance_popover_show),
+                   nullptr);
+  gtk_menu_button_set_popover(GTK_MENU_BUTTON(instance_button), popover);
 
-  while (std::getline(ss, line)) {
-    if (line.find("modmask:") != std::string::npos) {
-      try {
-        modmask = std::stoi(line.substr(line.find("modmask:") + 9));
-      } catch (...) {
-      }
-    }
-    if (line.find("key:") != std::string::npos) {
-      key_code = line.substr(line.find("key:") + 5);
-      key_code.erase(0, key_code.find_first_not_of(" \t"));
-    }
-  }
+  size_t live = std::count_if(
+      hypr_instances.begin(), hypr_instances.end(),
+      [](const std::unique_ptr<HyprInstance> &i) { return i->live; });
+  gtk_widget_set_visible(instance_button, live > 1);
+  return instance_button;
+}
 
-  std::string mod_str;
-  if (modmask == 64)
-    mod_str = "SUPER";
-  else if (modmask == 8)
-    mod_str = "ALT";
-  else if (modmask == 4)
-    mod_str = "CTRL";
-  else if (modmask == 1)
-    mod_str = "SHIFT";
-  else if (modmask == 65)
-    mod_str = "SUPER_SHIFT";
-  else if (modmask == 9)
-    mod_str = "ALT_SHIFT";
-  else if (modmask == 12)
-    mod_str = "CTRL_ALT";
-  else if (modmask == 72)
-    mod_str = "SUPER_ALT";
+#ifdef HYPR_CONTROL_INSTRUMENT
+static GtkWidget *instrument_overlay_label = nullptr;
+static guint instrument_overlay_source = 0;
+
+static std::vector<InstrumentStats> sorted_instrument_stats() {
+  std::vector<InstrumentStats> stats = instrument_stats;
+  std::sort(stats.begin(), stats.end(),
+            [](const InstrumentStats &a, const InstrumentStats &b) {
+              return a.max[COUNT_ALLOCS] > b.max[COUNT_ALLOCS];
+            });
+  return stats;
+}
 
-  if (!mod_str.empty() && !key_code.empty()) {
-    current_layout_switch_bind = mod_str + ", " + key_code;
+static gboolean refresh_instrument_overlay(gpointer) {
+  std::ostringstream oss;
+  oss << std::left << std::setw(36) << "scope" << std::right << std::setw(6)
+      << "calls" << std::setw(7) << "allocs" << std::setw(6) << "max"
+      << std::setw(8) << "bytes" << std::setw(6) << "spawn" << std::setw(5)
+      << "ipc" << std::setw(5) << "sys";
+  for (const auto &s : sorted_instrument_stats()) {
+    oss << "\n"
+        << std::left << std::setw(36) << std::string(s.name).substr(0, 35)
+        << std::right << std::setw(6) << s.calls << std::setw(7)
+        << s.last[COUNT_ALLOCS] << std::setw(6) << s.max[COUNT_ALLOCS]
+        << std::setw(8) << s.last[COUNT_ALLOC_BYTES] << std::setw(6)
+        << s.max[COUNT_SPAWNS] << std::setw(5) << s.max[COUNT_IPC]
+        << std::setw(5) << s.max[COUNT_SYSCALLS];
   }
+  gtk_label_set_text(GTK_LABEL(instrument_overlay_label), oss.str().c_str());
+  return G_SOURCE_CONTINUE;
 }
 
-static GtkWidget *create_keyboard_page() {
-  GtkWidget *page = adw_preferences_page_new();
-  adw_preferences_page_set_title(ADW_PREFERENCES_PAGE(page), "Keyboard");
-  adw_preferences_page_set_icon_name(ADW_PREFERENCES_PAGE(page),
-                                     "input-keyboard-symbolic");
+static gboolean on_toggle_instrument_overlay(GtkWidget *, GVariant *,
+                                             gpointer) {
+  bool visible = !gtk_widget_get_visible(instrument_overlay_label);
+  gtk_widget_set_visible(instrument_overlay_label, visible);
+  if (visible) {
+    refresh_instrument_overlay(nullptr);
+    instrument_overlay_source =
+        g_timeout_add(500, refresh_instrument_overlay, nullptr);
+  } else if (instrument_overlay_source) {
+    g_source_remove(instrument_overlay_source);
+    instrument_overlay_source = 0;
+  }
+  return TRUE;
+}
 
-  
-  selected_layouts.clear();
-  std::string layouts_str = get_string_option("input:kb_layout");
-  if (!layouts_str.empty()) {
-    std::stringstream ss(layouts_str);
-    std::string segment;
-    while (std::getline(ss, segment, ',')) {
-      segment.erase(0, segment.find_first_not_of(" \t"));
-      selected_layouts.push_back(segment);
+// Wraps the page stack in an overlay listing the per-scope counters,
+// toggled with Ctrl+Shift+D.
+static GtkWidget *create_instrument_overlay(GtkWidget *child) {
+  GtkWidget *overlay = gtk_overlay_new();
+  gtk_overlay_set_child(GTK_OVERLAY(overlay), child);
+
+  instrument_overlay_label = gtk_label_new(nullptr);
+  gtk_widget_add_css_class(instrument_overlay_label, "monospace");
+  gtk_widget_add_css_class(instrument_overlay_label, "osd");
+  gtk_widget_set_halign(instrument_overlay_label, GTK_ALIGN_END);
+  gtk_widget_set_valign(instrument_overlay_label, GTK_ALIGN_START);
+  gtk_widget_set_margin_top(instrument_overlay_label, 12);
+  gtk_widget_set_margin_end(instrument_overlay_label, 12);
+  gtk_widget_set_can_target(instrument_overlay_label, FALSE);
+  gtk_widget_set_visible(instrument_overlay_label, FALSE);
+  gtk_overlay_add_overlay(GTK_OVERLAY(overlay), instrument_overlay_label);
+
+  GtkEventController *shortcuts = gtk_shortcut_controller_new();
+  gtk_shortcut_controller_set_scope(GTK_SHORTCUT_CONTROLLER(shortcuts),
+                                    GTK_SHORTCUT_SCOPE_GLOBAL);
+  gtk_shortcut_controller_add_shortcut(
+      GTK_SHORTCUT_CONTROLLER(shortcuts),
+      gtk_shortcut_new(
+          gtk_shortcut_trigger_parse_string("<Control><Shift>d"),
+          gtk_callback_action_new(on_toggle_instrument_overlay, nullptr,
+                                  nullptr)));
+  gtk_widget_add_controller(main_window, shortcuts);
+  return overlay;
+}
+
+// Byte counts depend on option values, and budget runs use the async mode,
+// whose syscalls all happen on workers where no scope sees them. Both are
+// shown in the overlay but not budgeted.
+static bool instrument_counter_budgeted(int counter) {
+  return counter != COUNT_ALLOC_BYTES && counter != COUNT_SYSCALLS;
+}
+
+// A budget is a key file with a group per scope and a key per counter, the
+// most one call may cost. Group "*" covers scopes without their own.
+static bool write_instrument_budget(const std::string &path) {
+  GKeyFile *file = g_key_file_new();
+  for (const auto &s : instrument_stats) {
+    for (int i = 0; i < COUNT_KINDS; ++i) {
+      if (instrument_counter_budgeted(i))
+        g_key_file_set_uint64(file, s.name, instrument_counter_names[i],
+                              s.max[i]);
     }
   }
+  GError *error = nullptr;
+  bool ok = g_key_file_save_to_file(file, path.c_str(), &error);
+  if (!ok) {
+    g_printerr("hypr-control: %s\n", error->message);
+    g_error_free(error);
+  } else {
+    std::printf("recorded budgets for %zu scopes in %s\n",
+                instrument_stats.size(), path.c_str());
+  }
+  g_key_file_free(file);
+  return ok;
+}
 
-  
-  load_keybind_state();
-
-  GtkWidget *layout_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(layout_group),
-                                  "Layouts");
+static bool check_instrument_budget(const std::string &path) {
+  GKeyFile *file = g_key_file_new();
+  GError *error = nullptr;
+  if (!g_key_file_load_from_file(file, path.c_str(), G_KEY_FILE_NONE,
+                                 &error)) {
+    g_printerr("hypr-control: %s: %s\n", path.c_str(), error->message);
+    g_error_free(error);
+    g_key_file_free(file);
+    return false;
+  }
 
-  layouts_list_box = gtk_list_box_new();
-  gtk_widget_add_css_class(layouts_list_box, "boxed-list");
-  gtk_list_box_set_selection_mode(GTK_LIST_BOX(layouts_list_box),
-                                  GTK_SELECTION_NONE);
-  gtk_widget_set_visible(layouts_list_box, FALSE);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(layout_group),
-                            layouts_list_box);
-  refresh_layouts_list(); 
+  int failures = 0;
+  for (const auto &s : sorted_instrument_stats()) {
+    const char *group = g_key_file_has_group(file, s.name) ? s.name : "*";
+    for (int i = 0; i < COUNT_KINDS; ++i) {
+      const char *key = instrument_counter_names[i];
+      if (!instrument_counter_budgeted(i) ||
+          !g_key_file_has_key(file, group, key, nullptr))
+        continue;
+      guint64 budget = g_key_file_get_uint64(file, group, key, nullptr);
+      if (s.max[i] <= budget)
+        continue;
+      std::printf("over budget: %s %s %llu > %llu\n", s.name, key,
+                  static_cast<unsigned long long>(s.max[i]),
+                  static_cast<unsigned long long>(budget));
+      ++failures;
+    }
+  }
+  std::printf("%zu scopes checked against %s, %d over budget\n",
+              instrument_stats.size(), path.c_str(), failures);
+  g_key_file_free(file);
+  return failures == 0;
+}
+#endif
 
-  GtkWidget *add_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(add_row), "Add Layout");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(add_row),
-                              "Add a new keyboard layout");
-  gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(add_row), TRUE);
-  GtkWidget *add_icon = gtk_image_new_from_icon_name("list-add-symbolic");
-  adw_action_row_add_suffix(ADW_ACTION_ROW(add_row), add_icon);
-  g_signal_connect(add_row, "activated", G_CALLBACK(on_add_layout_clicked),
-                   nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(layout_group), add_row);
+struct BenchScenario {
+  const char *name;
+  std::vector<std::function<void()>> steps;
+};
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(layout_group));
+struct BenchResult {
+  std::string scenario;
+  HyprApplyMode mode;
+  size_t frames;
+  double p50;
+  double p99;
+  int dropped;
+  double ack_lag;
+};
 
-  GtkWidget *keybind_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(keybind_group),
-                                  "Layout Switching");
-  adw_preferences_group_set_description(
-      ADW_PREFERENCES_GROUP(keybind_group),
-      "Set a keybind to cycle through layouts");
+// Drives the bound controls one step per frame against the mock compositor
+// and records frame intervals until the last write has been acknowledged.
+struct Bench {
+  bool active = false;
+  ReplayData *mock = nullptr;
+  std::vector<HyprApplyMode> modes;
+  std::vector<BenchScenario> scenarios;
+  size_t mode_index = 0;
+  size_t scenario_index = 0;
+  size_t step = 0;
+  gint64 last_frame = 0;
+  gint64 final_change = 0;
+  double refresh_ms = 0;
+  std::vector<double> frame_times;
+  std::vector<BenchResult> results;
+  std::string budget_path;
+  bool record_budget = false;
+  bool failed = false;
+};
 
-  keybinds_list_box = gtk_list_box_new();
-  gtk_widget_add_css_class(keybinds_list_box, "boxed-list");
-  gtk_list_box_set_selection_mode(GTK_LIST_BOX(keybinds_list_box),
-                                  GTK_SELECTION_NONE);
-  gtk_widget_set_visible(keybinds_list_box, FALSE);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group),
-                            keybinds_list_box);
+static Bench bench;
 
-  const char *modifier_options[] = {"Super",    "Alt",         "Ctrl",
-                                    "Shift",    "Super+Shift", "Alt+Shift",
-                                    "Ctrl+Alt", "Super+Alt",   nullptr};
-  GtkStringList *mod_list = gtk_string_list_new(modifier_options);
-  GtkWidget *mod_row = adw_combo_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(mod_row), "Modifier");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(mod_row),
-                              "Key modifier for shortcut");
-  adw_combo_row_set_model(ADW_COMBO_ROW(mod_row), G_LIST_MODEL(mod_list));
-  g_signal_connect(mod_row, "notify::selected", G_CALLBACK(on_modifier_changed),
-                   nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group), mod_row);
+static const char *apply_mode_name(HyprApplyMode mode) {
+  switch (mode) {
+  case APPLY_SYNC:
+    return "sync";
+  case APPLY_SPAWN:
+    return "spawn";
+  default:
+    return "async";
+  }
+}
 
-  GtkWidget *key_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(key_row), "Key");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(key_row),
-                              "Key to press (e.g., Space, Tab, grave)");
-  layout_switch_key_entry = gtk_entry_new();
-  gtk_entry_set_placeholder_text(GTK_ENTRY(layout_switch_key_entry), "Space");
-  gtk_widget_set_size_request(layout_switch_key_entry, 120, -1);
-  gtk_widget_set_valign(layout_switch_key_entry, GTK_ALIGN_CENTER);
-  adw_action_row_add_suffix(ADW_ACTION_ROW(key_row), layout_switch_key_entry);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group), key_row);
+static std::vector<BenchScenario> bench_scenarios() {
+  BenchScenario drag = {"slider-drag", {}};
+  BenchScenario storm = {"toggle-storm", {}};
+  BenchScenario cycle = {"combo-cycle", {}};
+  const int drag_steps = 60;
+  for (const auto &binding : option_bindings) {
+    if (binding.kind != BINDING_RANGE)
+      continue;
+    GtkAdjustment *adj = gtk_range_get_adjustment(GTK_RANGE(binding.control));
+    double lower = gtk_adjustment_get_lower(adj);
+    double upper = gtk_adjustment_get_upper(adj);
+    for (int i = 0; i <= 2 * drag_steps; ++i) {
+      double t = 1.0 - std::abs(i - drag_steps) / double(drag_steps);
+      GtkWidget *control = binding.control;
+      drag.steps.push_back([control, value = lower + t * (upper - lower)] {
+        gtk_range_set_value(GTK_RANGE(control), value);
+      });
+    }
+  }
 
-  GtkWidget *apply_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(apply_row),
-                                "Apply Keybind");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(apply_row),
-                              "Set the keyboard layout switch shortcut");
-  gtk_list_box_row_set_activatable(GTK_LIST_BOX_ROW(apply_row), TRUE);
-  GtkWidget *apply_icon = gtk_image_new_from_icon_name("emblem-ok-symbolic");
-  adw_action_row_add_suffix(ADW_ACTION_ROW(apply_row), apply_icon);
-  g_signal_connect(apply_row, "activated", G_CALLBACK(on_apply_keybind_clicked),
-                   nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group), apply_row);
+  std::vector<GtkWidget *> switches;
+  for (const auto &binding : option_bindings) {
+    if (binding.kind == BINDING_SWITCH)
+      switches.push_back(binding.control);
+  }
+  for (int i = 0; i < 40; ++i) {
+    storm.steps.push_back([switches] {
+      for (GtkWidget *row : switches)
+        adw_switch_row_set_active(
+            ADW_SWITCH_ROW(row),
+            !adw_switch_row_get_active(ADW_SWITCH_ROW(row)));
+    });
+  }
 
-  keybinds_list_box = gtk_list_box_new();
-  gtk_widget_add_css_class(keybinds_list_box, "boxed-list");
-  gtk_list_box_set_selection_mode(GTK_LIST_BOX(keybinds_list_box),
-                                  GTK_SELECTION_NONE);
-  refresh_keybinds_list(); 
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(keybind_group),
-                            keybinds_list_box);
+  // Each combo steps through all of its items twice, ending where it began.
+  for (const auto &binding : option_bindings) {
+    if (binding.kind != BINDING_COMBO)
+      continue;
+    GtkWidget *control = binding.control;
+    guint items = binding.values.size();
+    guint start = adw_combo_row_get_selected(ADW_COMBO_ROW(control));
+    if (items < 2 || start >= items)
+      continue;
+    for (guint i = 1; i <= 2 * items; ++i) {
+      cycle.steps.push_back([control, item = (start + i) % items] {
+        adw_combo_row_set_selected(ADW_COMBO_ROW(control), item);
+      });
+    }
+  }
+  return {drag, storm, cycle};
+}
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(keybind_group));
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty())
+    return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::lround(p * (values.size() - 1))];
+}
 
-  GtkWidget *repeat_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(repeat_group),
-                                  "Key Repeat");
+static void print_bench_results() {
+  std::printf("%-14s %-6s %7s %8s %8s %8s %11s\n", "scenario", "mode",
+              "frames", "p50 ms", "p99 ms", "dropped", "ack lag ms");
+  for (const auto &result : bench.results) {
+    std::printf("%-14s %-6s %7zu %8.2f %8.2f %8d %11.2f\n",
+                result.scenario.c_str(), apply_mode_name(result.mode),
+                result.frames, result.p50, result.p99, result.dropped,
+                result.ack_lag);
+  }
+  std::printf("refresh interval %.2f ms, mock latency %.1f ms\n",
+              bench.refresh_ms, bench.mock->latency / 1000.0);
+}
 
-  GtkWidget *rate_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(rate_row), "Repeat Rate");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(rate_row),
-                              "Keys per second when held");
-  GtkWidget *rate_scale =
-      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 10, 100, 5);
-  gtk_scale_set_draw_value(GTK_SCALE(rate_scale), TRUE);
-  gtk_scale_set_value_pos(GTK_SCALE(rate_scale), GTK_POS_LEFT);
-  gtk_range_set_value(GTK_RANGE(rate_scale),
-                      get_int_option("input:repeat_rate", 25));
-  gtk_widget_set_size_request(rate_scale, 180, -1);
-  gtk_widget_set_valign(rate_scale, GTK_ALIGN_CENTER);
-  g_signal_connect(rate_scale, "value-changed",
-                   G_CALLBACK(on_repeat_rate_changed), nullptr);
-  adw_action_row_add_suffix(ADW_ACTION_ROW(rate_row), rate_scale);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(repeat_group), rate_row);
+static void finish_bench_scenario(gint64 last_reply) {
+  int dropped = 0;
+  for (double interval : bench.frame_times)
+    dropped += std::max(0L, std::lround(interval / bench.refresh_ms) - 1);
+  bench.results.push_back(
+      {bench.scenarios[bench.scenario_index].name,
+       bench.modes[bench.mode_index], bench.frame_times.size(),
+       percentile(bench.frame_times, 0.5), percentile(bench.frame_times, 0.99),
+       dropped, std::max<gint64>(last_reply - bench.final_change, 0) / 1000.0});
+
+  bench.frame_times.clear();
+  bench.last_frame = 0;
+  bench.step = 0;
+  if (++bench.scenario_index == bench.scenarios.size()) {
+    bench.scenario_index = 0;
+    ++bench.mode_index;
+  }
+}
 
-  GtkWidget *delay_row = adw_action_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(delay_row), "Repeat Delay");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(delay_row),
-                              "Milliseconds before repeat starts");
-  GtkWidget *delay_scale =
-      gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 100, 1000, 50);
-  gtk_scale_set_draw_value(GTK_SCALE(delay_scale), TRUE);
-  gtk_scale_set_value_pos(GTK_SCALE(delay_scale), GTK_POS_LEFT);
-  gtk_range_set_value(GTK_RANGE(delay_scale),
-                      get_int_option("input:repeat_delay", 600));
-  gtk_widget_set_size_request(delay_scale, 180, -1);
-  gtk_widget_set_valign(delay_scale, GTK_ALIGN_CENTER);
-  g_signal_connect(delay_scale, "value-changed",
-                   G_CALLBACK(on_repeat_delay_changed), nullptr);
-  adw_action_row_add_suffix(ADW_ACTION_ROW(delay_row), delay_scale);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(repeat_group), delay_row);
+static gboolean on_bench_tick(GtkWidget *, GdkFrameClock *clock, gpointer) {
+  gint64 frame_time = gdk_frame_clock_get_frame_time(clock);
+  if (bench.refresh_ms == 0) {
+    gint64 interval = 0;
+    gdk_frame_clock_get_refresh_info(clock, frame_time, &interval, nullptr);
+    bench.refresh_ms = interval > 0 ? interval / 1000.0 : 1000.0 / 60;
+  }
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(repeat_group));
+  gint64 last_reply;
+  int in_flight;
+  {
+    std::lock_guard<std::mutex> lock(bench.mock->mutex);
+    last_reply = bench.mock->last_reply;
+    in_flight = bench.mock->in_flight;
+  }
 
-  GtkWidget *options_group = adw_preferences_group_new();
-  adw_preferences_group_set_title(ADW_PREFERENCES_GROUP(options_group),
-                                  "Options");
+  BenchScenario &scenario = bench.scenarios[bench.scenario_index];
+  bool driving = bench.step < scenario.steps.size();
+  if (bench.last_frame && (driving || in_flight > 0))
+    bench.frame_times.push_back((frame_time - bench.last_frame) / 1000.0);
+  bench.last_frame = frame_time;
+
+  if (driving) {
+    hypr_apply_mode = bench.modes[bench.mode_index];
+    scenario.steps[bench.step++]();
+    if (bench.step == scenario.steps.size())
+      bench.final_change = g_get_monotonic_time();
+    return G_SOURCE_CONTINUE;
+  }
 
-  GtkWidget *numlock_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(numlock_row),
-                                "Numlock by Default");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(numlock_row),
-                              "Enable numlock on startup");
-  g_signal_connect(numlock_row, "notify::active",
-                   G_CALLBACK(on_numlock_by_default_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(options_group), numlock_row);
+  // Writes may still sit in the worker queue between two replies, so wait
+  // for the mock to stay idle before taking the last reply as the ack.
+  gint64 now = g_get_monotonic_time();
+  if (in_flight > 0 ||
+      now - std::max(last_reply, bench.final_change) < 300000)
+    return G_SOURCE_CONTINUE;
+
+  finish_bench_scenario(last_reply);
+  if (bench.mode_index < bench.modes.size())
+    return G_SOURCE_CONTINUE;
+
+  hypr_apply_mode = APPLY_ASYNC;
+  print_bench_results();
+#ifdef HYPR_CONTROL_INSTRUMENT
+  if (!bench.budget_path.empty())
+    bench.failed = !(bench.record_budget
+                         ? write_instrument_budget(bench.budget_path)
+                         : check_instrument_budget(bench.budget_path));
+#endif
+  g_application_quit(g_application_get_default());
+  return G_SOURCE_REMOVE;
+}
 
-  GtkWidget *binds_sym_row = adw_switch_row_new();
-  adw_preferences_row_set_title(ADW_PREFERENCES_ROW(binds_sym_row),
-                                "Resolve Binds by Symbol");
-  adw_action_row_set_subtitle(ADW_ACTION_ROW(binds_sym_row),
-                              "Use keysym instead of keycode");
-  g_signal_connect(binds_sym_row, "notify::active",
-                   G_CALLBACK(on_resolve_binds_by_sym_changed), nullptr);
-  adw_preferences_group_add(ADW_PREFERENCES_GROUP(options_group),
-                            binds_sym_row);
+static void start_bench() {
+  staged_mode = false;
+  bench.scenarios = bench_scenarios();
+  gtk_widget_add_tick_callback(main_window, on_bench_tick, nullptr, nullptr);
+}
 
-  adw_preferences_page_add(ADW_PREFERENCES_PAGE(page),
-                           ADW_PREFERENCES_GROUP(options_group));
+// Starts the mock compositor and points this process at it. `mode` is
+// "spawn", "sync", "async" or "all".
+static bool setup_bench(double latency_ms, const std::string &mode) {
+  g_autofree char *hyprctl = g_find_program_in_path("hyprctl");
+  for (HyprApplyMode m : {APPLY_SPAWN, APPLY_SYNC, APPLY_ASYNC}) {
+    if (m == APPLY_SPAWN && !hyprctl) {
+      g_printerr("hypr-control: hyprctl not found, skipping spawn mode\n");
+      continue;
+    }
+    if (mode == "all" || mode == apply_mode_name(m))
+      bench.modes.push_back(m);
+  }
+  if (bench.modes.empty()) {
+    g_printerr("hypr-control: unknown bench mode %s\n", mode.c_str());
+    return false;
+  }
 
-  return page;
+  bench.mock = new ReplayData();
+  bench.mock->latency = std::llround(latency_ms * 1000);
+  std::string runtime_dir = start_replay_sockets(bench.mock, "bench");
+  if (runtime_dir.empty())
+    return false;
+  g_setenv("XDG_RUNTIME_DIR", runtime_dir.c_str(), TRUE);
+  g_setenv("HYPRLAND_INSTANCE_SIGNATURE", "bench", TRUE);
+  bench.active = true;
+  return true;
 }
 
 static void on_activate(GtkApplication *app, gpointer) {
+  prefetch_startup_options();
+
   main_window = adw_application_window_new(app);
   gtk_window_set_title(GTK_WINDOW(main_window), "Hypr Control");
   gtk_window_set_default_size(GTK_WINDOW(main_window), 600, 750);
@@ -1344,23 +10102,34 @@ static void on_activate(GtkApplication *app, gpointer) {
   GtkWidget *title =
       adw_window_title_new("Hypr Control", "Input Device Settings");
   adw_header_bar_set_title_widget(ADW_HEADER_BAR(header), title);
+  adw_header_bar_pack_start(ADW_HEADER_BAR(header),
+                            create_staged_mode_button());
+  adw_header_bar_pack_start(ADW_HEADER_BAR(header), create_import_button());
+  adw_header_bar_pack_end(ADW_HEADER_BAR(header), create_instance_button());
+  GtkWidget *search_bar = create_search_bar(main_window);
+  adw_header_bar_pack_end(ADW_HEADER_BAR(header), create_search_button());
   adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(view), header);
+  adw_toolbar_view_add_top_bar(ADW_TOOLBAR_VIEW(view), search_bar);
 
   GtkWidget *view_stack = adw_view_stack_new();
 
-  GtkWidget *mouse_page = create_mouse_page();
-  adw_view_stack_add_titled_with_icon(ADW_VIEW_STACK(view_stack), mouse_page,
-                                      "mouse", "Mouse", "input-mouse-symbolic");
+  for (const auto &page : builtin_pages) {
+    adw_view_stack_add_titled_with_icon(ADW_VIEW_STACK(view_stack),
+                                        page.build(&page_host), page.name,
+                                        page.title, page.icon_name);
+  }
+
+  GtkWidget *monitors_page = create_monitors_page();
+  adw_view_stack_add_titled_with_icon(ADW_VIEW_STACK(view_stack), monitors_page,
+                                      "monitors", "Monitors",
+                                      "video-display-symbolic");
 
-  GtkWidget *touchpad_page = create_touchpad_page();
-  adw_view_stack_add_titled_with_icon(ADW_VIEW_STACK(view_stack), touchpad_page,
-                                      "touchpad", "Touchpad",
-                                      "input-touchpad-symbolic");
+  add_page_modules(view_stack);
 
-  GtkWidget *keyboard_page = create_keyboard_page();
-  adw_view_stack_add_titled_with_icon(ADW_VIEW_STACK(view_stack), keyboard_page,
-                                      "keyboard", "Keyboard",
-                                      "input-keyboard-symbolic");
+  GtkWidget *all_options_page = create_all_options_page();
+  adw_view_stack_add_titled_with_icon(ADW_VIEW_STACK(view_stack),
+                                      all_options_page, "all", "All Options",
+                                      "preferences-other-symbolic");
 
   GtkWidget *switcher = adw_view_switcher_bar_new();
   adw_view_switcher_bar_set_stack(ADW_VIEW_SWITCHER_BAR(switcher),
@@ -1374,18 +10143,82 @@ static void on_activate(GtkApplication *app, gpointer) {
                                ADW_VIEW_SWITCHER_POLICY_WIDE);
   adw_header_bar_set_title_widget(ADW_HEADER_BAR(header), header_switcher);
 
-  adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(view), view_stack);
+  GtkWidget *content = view_stack;
+#ifdef HYPR_CONTROL_INSTRUMENT
+  content = create_instrument_overlay(view_stack);
+#endif
+  toast_overlay = adw_toast_overlay_new();
+  adw_toast_overlay_set_child(ADW_TOAST_OVERLAY(toast_overlay), content);
+  adw_toolbar_view_set_content(ADW_TOOLBAR_VIEW(view), toast_overlay);
+  adw_toolbar_view_add_bottom_bar(ADW_TOOLBAR_VIEW(view),
+                                  create_staged_changes_bar());
   adw_toolbar_view_add_bottom_bar(ADW_TOOLBAR_VIEW(view), switcher);
+  build_search_index(view_stack);
 
   adw_application_window_set_content(ADW_APPLICATION_WINDOW(main_window), view);
   gtk_window_present(GTK_WINDOW(main_window));
+
+  hypr_event_handlers.push_back(on_option_cache_event);
+  hypr_event_handlers.push_back(on_config_watcher_event);
+  hypr_event_handlers.push_back(on_layout_probe_event);
+  hypr_event_handlers.push_back(on_input_state_event);
+  hypr_event_handlers.push_back(on_monitor_event);
+  start_hypr_event_listener();
+  input_state_start();
+
+  staged_mode = get_setting_bool("app", "staged", false);
+  snapshot_staged_state();
+  start_input_hardware_probe();
+  start_config_watcher();
+  if (bench.active)
+    start_bench();
 }
 
 int main(int argc, char *argv[]) {
-  AdwApplication *app = adw_application_new("com.github.hyprcontrol",
-                                            G_APPLICATION_DEFAULT_FLAGS);
+  if (argc > 1 && std::strcmp(argv[1], "--daemon") == 0)
+    return run_daemon();
+  if (argc > 1 && std::strcmp(argv[1], "--probe-hardware") == 0)
+    return print_input_hardware();
+  if (argc > 2 && std::strcmp(argv[1], "--replay") == 0)
+    return run_replay_server(argv[2],
+                             argc > 3 && std::strcmp(argv[3], "--fast") == 0);
+
+  GApplicationFlags flags = G_APPLICATION_DEFAULT_FLAGS;
+  if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+    double latency_ms = 2;
+    std::string mode = "all";
+    for (int i = 2; i + 1 < argc; i += 2) {
+      if (std::strcmp(argv[i], "--latency") == 0)
+        latency_ms = std::atof(argv[i + 1]);
+      else if (std::strcmp(argv[i], "--mode") == 0)
+        mode = argv[i + 1];
+      else if (std::strcmp(argv[i], "--check-alloc-budget") == 0 ||
+               std::strcmp(argv[i], "--record-alloc-budget") == 0) {
+        bench.budget_path = argv[i + 1];
+        bench.record_budget = argv[i][2] == 'r';
+      }
+    }
+    if (!bench.budget_path.empty()) {
+#ifndef HYPR_CONTROL_INSTRUMENT
+      g_printerr("hypr-control: built without HYPR_CONTROL_INSTRUMENT\n");
+      return 1;
+#endif
+      // Spawn and sync modes cost syscalls by design; budgets are for the
+      // normal path.
+      mode = "async";
+    }
+    if (!setup_bench(latency_ms, mode))
+      return 1;
+    // A separate instance, so a running window isn't activated instead.
+    flags = G_APPLICATION_NON_UNIQUE;
+    argc = 1;
+  }
+
+  AdwApplication *app = adw_application_new("com.github.hyprcontrol", flags);
   g_signal_connect(app, "activate", G_CALLBACK(on_activate), nullptr);
   int status = g_application_run(G_APPLICATION(app), argc, argv);
   g_object_unref(app);
-  return status;
+  if (bench.mock)
+    remove_replay_sockets(bench.mock);
+  return bench.failed ? 1 : status;
 }
@@ -0,0 +1,19 @@
+# Runs `hypr-control --probe-hardware` against a fixture sysroot and
+# compares what it finds with the expected listing.
+#
+#   cmake -DPROGRAM=... -DSYSROOT=... -DEXPECTED=... -P probe-hardware.cmake
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E env HYPR_CONTROL_SYSROOT=${SYSROOT}
+            ${PROGRAM} --probe-hardware
+    OUTPUT_VARIABLE output
+    RESULT_VARIABLE result
+)
+file(READ ${EXPECTED} expected)
+
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "--probe-hardware exited with ${result}")
+endif()
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Expected:\n${expected}\nGot:\n${output}")
+endif()